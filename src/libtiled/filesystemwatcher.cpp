@@ -137,8 +137,11 @@ void FileSystemWatcher::pathsChangedTimeout()
     // If the file was replaced, the watcher is automatically removed and needs
     // to be re-added to keep watching it for changes. This happens commonly
     // with applications that do atomic saving.
+    const QStringList files = mWatcher->files();
+    const QStringList directories = mWatcher->directories();
+
     for (const QString &path : changedPaths) {
-        if (mWatchCount.contains(path) && !mWatcher->files().contains(path)) {
+        if (mWatchCount.contains(path) && !files.contains(path) && !directories.contains(path)) {
             if (QFile::exists(path))
                 mWatcher->addPath(path);
         }
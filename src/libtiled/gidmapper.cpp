@@ -29,10 +29,15 @@
 #include "gidmapper.h"
 
 #include "compression.h"
+#include "layerdatadecoding.h"
 #include "tile.h"
 #include "tiled.h"
 #include "tileset.h"
 
+#include <QtEndian>
+
+#include <algorithm>
+
 using namespace Tiled;
 
 // Bits on the far end of the 32-bit global tile ID are used for tile flags
@@ -42,6 +47,10 @@ const unsigned FlippedAntiDiagonallyFlag = 0x20000000;
 
 const unsigned RotatedHexagonal120Flag   = 0x10000000;
 
+// Limits the memory used by the flat GID lookup table to 4 MB. Higher GIDs
+// are looked up using a binary search.
+const unsigned MaxGidTableSize = 1 << 20;
+
 /**
  * Default constructor. Use \l insert to initialize the gid mapper
  * incrementally.
@@ -64,6 +73,99 @@ GidMapper::GidMapper(const QVector<SharedTileset> &tilesets)
     }
 }
 
+/**
+ * Insert the given \a tileset with \a firstGid as its first global ID.
+ *
+ * Tilesets are usually inserted in order of increasing first GID, in which
+ * case the lookup tables are only extended.
+ */
+void GidMapper::insert(unsigned firstGid, const SharedTileset &tileset)
+{
+    const bool append = mFirstGidToTileset.isEmpty() ||
+            firstGid > mFirstGidToTileset.lastKey();
+
+    mFirstGidToTileset.insert(firstGid, tileset);
+
+    if (append)
+        appendToLookupTables(firstGid, tileset.data());
+    else
+        rebuildLookupTables();
+}
+
+/**
+ * Makes cellToGid() map cells referring to \a alias like cells referring to
+ * \a tileset, which needs to be inserted as well. This allows writing a copy
+ * of a map that has its tilesets replaced, without changing all its cells.
+ */
+void GidMapper::insertAlias(const Tileset *alias, const Tileset *tileset)
+{
+    mAliases.insert(alias, tileset);
+
+    const auto it = mTilesetToFirstGid.constFind(tileset);
+    if (it != mTilesetToFirstGid.constEnd())
+        mTilesetToFirstGid.insert(alias, it.value());
+}
+
+/**
+ * Returns the index in mTilesetRanges of the tileset containing the given
+ * \a gid, or -1 when it lies before the first tileset.
+ *
+ * Expects at least one tileset to be present.
+ */
+int GidMapper::tilesetIndex(unsigned gid) const
+{
+    if (gid < static_cast<unsigned>(mGidToTilesetIndex.size()))
+        return mGidToTilesetIndex.at(static_cast<int>(gid));
+
+    if (gid >= mTilesetRanges.last().firstGid)
+        return mTilesetRanges.size() - 1;
+
+    // The GID lies beyond the size limit of the flat table
+    auto it = std::upper_bound(mTilesetRanges.begin(), mTilesetRanges.end(), gid,
+                               [] (unsigned value, const TilesetRange &range) {
+        return value < range.firstGid;
+    });
+    return static_cast<int>(it - mTilesetRanges.begin()) - 1;
+}
+
+/**
+ * Adds the given \a tileset to the lookup tables. Its \a firstGid needs to
+ * be higher than that of any tileset added before.
+ */
+void GidMapper::appendToLookupTables(unsigned firstGid, Tileset *tileset)
+{
+    Q_ASSERT(mTilesetRanges.isEmpty() || mTilesetRanges.last().firstGid < firstGid);
+
+    // The GIDs up to the new first GID belong to the previously last tileset
+    const int previousIndex = mTilesetRanges.size() - 1;
+    const int tableSize = static_cast<int>(qMin(firstGid, MaxGidTableSize));
+    const int currentSize = mGidToTilesetIndex.size();
+    if (tableSize > currentSize)
+        mGidToTilesetIndex.insert(currentSize, tableSize - currentSize, previousIndex);
+
+    mTilesetRanges.append(TilesetRange { firstGid, tileset });
+
+    // When a tileset is present multiple times, the lowest first GID is used
+    if (!mTilesetToFirstGid.contains(tileset))
+        mTilesetToFirstGid.insert(tileset, firstGid);
+}
+
+void GidMapper::rebuildLookupTables()
+{
+    mTilesetRanges.clear();
+    mGidToTilesetIndex.clear();
+    mTilesetToFirstGid.clear();
+
+    for (auto it = mFirstGidToTileset.cbegin(), end = mFirstGidToTileset.cend(); it != end; ++it)
+        appendToLookupTables(it.key(), it.value().data());
+
+    for (auto it = mAliases.cbegin(), end = mAliases.cend(); it != end; ++it) {
+        const auto firstGid = mTilesetToFirstGid.constFind(it.value());
+        if (firstGid != mTilesetToFirstGid.constEnd())
+            mTilesetToFirstGid.insert(it.key(), firstGid.value());
+    }
+}
+
 /**
  * Returns the cell data matched by the given \a gid. The \a ok parameter
  * indicates whether an error occurred.
@@ -91,16 +193,13 @@ Cell GidMapper::gidToCell(unsigned gid, bool &ok) const
         ok = false;
     } else {
         // Find the tileset containing this tile
-        QMap<unsigned, SharedTileset>::const_iterator i = mFirstGidToTileset.upperBound(gid);
-        if (i == mFirstGidToTileset.begin()) {
+        const int index = tilesetIndex(gid);
+        if (index < 0) {
             // Invalid global tile ID, since it lies before the first tileset
             ok = false;
         } else {
-            --i; // Navigate one tileset back since upper bound finds the next
-            int tileId = gid - i.key();
-            const SharedTileset &tileset = i.value();
-
-            result.setTile(tileset.data(), tileId);
+            const TilesetRange &range = mTilesetRanges.at(index);
+            result.setTile(range.tileset, gid - range.firstGid);
 
             ok = true;
         }
@@ -118,18 +217,12 @@ unsigned GidMapper::cellToGid(const Cell &cell) const
     if (cell.isEmpty())
         return 0;
 
-    const Tileset *tileset = cell.tileset();
-
     // Find the first GID for the tileset
-    QMap<unsigned, SharedTileset>::const_iterator i = mFirstGidToTileset.begin();
-    QMap<unsigned, SharedTileset>::const_iterator i_end = mFirstGidToTileset.end();
-    while (i != i_end && i.value() != tileset)
-        ++i;
-
-    if (i == i_end) // tileset not found
+    const auto it = mTilesetToFirstGid.constFind(cell.tileset());
+    if (it == mTilesetToFirstGid.constEnd()) // tileset not found
         return 0;
 
-    unsigned gid = i.key() + cell.tileId();
+    unsigned gid = it.value() + cell.tileId();
     if (cell.flippedHorizontally())
         gid |= FlippedHorizontallyFlag;
     if (cell.flippedVertically())
@@ -157,16 +250,14 @@ QByteArray GidMapper::encodeLayerData(const TileLayer &tileLayer,
     if (bounds.isEmpty())
         bounds = QRect(0, 0, tileLayer.width(), tileLayer.height());
 
-    QByteArray tileData;
-    tileData.reserve(bounds.width() * bounds.height() * 4);
+    QByteArray tileData(bounds.width() * bounds.height() * 4, Qt::Uninitialized);
+    uchar *data = reinterpret_cast<uchar*>(tileData.data());
 
     for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
         for (int x = bounds.left(); x <= bounds.right(); ++x) {
             const unsigned gid = cellToGid(tileLayer.cellAt(x, y));
-            tileData.append(static_cast<char>(gid));
-            tileData.append(static_cast<char>(gid >> 8));
-            tileData.append(static_cast<char>(gid >> 16));
-            tileData.append(static_cast<char>(gid >> 24));
+            qToLittleEndian<quint32>(gid, data);
+            data += 4;
         }
     }
 
@@ -180,6 +271,19 @@ QByteArray GidMapper::encodeLayerData(const TileLayer &tileLayer,
     return tileData.toBase64();
 }
 
+/**
+ * Decodes Base64 encoded \a input into a newly allocated byte array.
+ */
+template<typename Char>
+static QByteArray fromBase64(const Char *input, int length)
+{
+    QByteArray result(base64DecodedSizeBound(length), Qt::Uninitialized);
+    const int size = decodeBase64(input, length,
+                                  reinterpret_cast<unsigned char*>(result.data()));
+    result.truncate(size);
+    return result;
+}
+
 GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
                                                   const QByteArray &layerData,
                                                   Map::LayerDataFormat format,
@@ -188,7 +292,45 @@ GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
     Q_ASSERT(format != Map::XML);
     Q_ASSERT(format != Map::CSV);
 
-    QByteArray decodedData = QByteArray::fromBase64(layerData);
+    return decodeGids(tileLayer,
+                      fromBase64(layerData.constData(), layerData.size()),
+                      format, bounds);
+}
+
+/**
+ * Overload that decodes the layer data directly from the text read from an
+ * XML file, without converting it to Latin-1 first.
+ */
+GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
+                                                  QStringRef layerData,
+                                                  Map::LayerDataFormat format,
+                                                  QRect bounds) const
+{
+    Q_ASSERT(format != Map::XML);
+    Q_ASSERT(format != Map::CSV);
+
+    const auto text = reinterpret_cast<const unsigned short*>(layerData.unicode());
+    return decodeGids(tileLayer,
+                      fromBase64(text, layerData.size()),
+                      format, bounds);
+}
+
+/**
+ * Reads the cells in \a bounds from the little-endian GIDs in \a decodedData,
+ * after decompressing it when needed.
+ *
+ * The Base64 input is fully decoded before reading the GIDs, even when it is
+ * not compressed. Decoding straight into the cells would need a decoder that
+ * can stop and resume within a group of characters, since whitespace may be
+ * found anywhere in the input. The cells are set one row at a time, so that
+ * TileLayer::setCellRow takes care of allocating chunks and tracking the
+ * used tilesets.
+ */
+GidMapper::DecodeError GidMapper::decodeGids(TileLayer &tileLayer,
+                                             QByteArray decodedData,
+                                             Map::LayerDataFormat format,
+                                             QRect bounds) const
+{
     const int size = bounds.width() * bounds.height() * 4;
 
     if (format == Map::Base64Gzip)
@@ -201,30 +343,32 @@ GidMapper::DecodeError GidMapper::decodeLayerData(TileLayer &tileLayer,
     if (size != decodedData.length())
         return CorruptLayerData;
 
-    const unsigned char *data = reinterpret_cast<const unsigned char*>(decodedData.constData());
-    int x = bounds.x();
-    int y = bounds.y();
-    bool ok;
+    const uchar *data = reinterpret_cast<const uchar*>(decodedData.constData());
+    QVector<Cell> row(bounds.width());
 
-    for (int i = 0; i < size - 3; i += 4) {
-        const unsigned gid = data[i] |
-                             data[i + 1] << 8 |
-                             data[i + 2] << 16 |
-                             data[i + 3] << 24;
+    // Consecutive cells often refer to the same tile
+    unsigned lastGid = 0;
+    Cell lastCell;
+    bool ok;
 
-        const Cell result = gidToCell(gid, ok);
-        if (!ok) {
-            mInvalidTile = gid;
-            return isEmpty() ? TileButNoTilesets : InvalidTile;
+    for (int y = bounds.top(); y <= bounds.bottom(); ++y) {
+        for (Cell &cell : row) {
+            const unsigned gid = qFromLittleEndian<quint32>(data);
+            data += 4;
+
+            if (gid != lastGid) {
+                lastCell = gidToCell(gid, ok);
+                if (!ok) {
+                    mInvalidTile = gid;
+                    return isEmpty() ? TileButNoTilesets : InvalidTile;
+                }
+                lastGid = gid;
+            }
+
+            cell = lastCell;
         }
 
-        tileLayer.setCell(x, y, result);
-
-        x++;
-        if (x > bounds.right()) {
-            x = bounds.x();
-            y++;
-        }
+        tileLayer.setCellRow(bounds.left(), y, row.constData(), row.size());
     }
 
     return NoError;
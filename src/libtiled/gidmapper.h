@@ -31,7 +31,10 @@
 #include "map.h"
 #include "tilelayer.h"
 
+#include <QHash>
 #include <QMap>
+#include <QString>
+#include <QVector>
 
 namespace Tiled {
 
@@ -45,6 +48,7 @@ public:
     GidMapper(const QVector<SharedTileset> &tilesets);
 
     void insert(unsigned firstGid, const SharedTileset &tileset);
+    void insertAlias(const Tileset *alias, const Tileset *tileset);
     void clear();
     bool isEmpty() const;
 
@@ -68,29 +72,51 @@ public:
                                 Map::LayerDataFormat format,
                                 QRect bounds) const;
 
+    DecodeError decodeLayerData(TileLayer &tileLayer,
+                                QStringRef layerData,
+                                Map::LayerDataFormat format,
+                                QRect bounds) const;
+
     unsigned invalidTile() const;
 
 private:
+    struct TilesetRange
+    {
+        unsigned firstGid;
+        Tileset *tileset;
+    };
+
+    DecodeError decodeGids(TileLayer &tileLayer,
+                           QByteArray decodedData,
+                           Map::LayerDataFormat format,
+                           QRect bounds) const;
+
+    int tilesetIndex(unsigned gid) const;
+    void appendToLookupTables(unsigned firstGid, Tileset *tileset);
+    void rebuildLookupTables();
+
     QMap<unsigned, SharedTileset> mFirstGidToTileset;
 
+    // Lookup tables derived from mFirstGidToTileset
+    QVector<TilesetRange> mTilesetRanges;
+    QVector<int> mGidToTilesetIndex;
+    QHash<const Tileset*, unsigned> mTilesetToFirstGid;
+    QHash<const Tileset*, const Tileset*> mAliases;
+
     mutable unsigned mInvalidTile;
 };
 
 
-/**
- * Insert the given \a tileset with \a firstGid as its first global ID.
- */
-inline void GidMapper::insert(unsigned firstGid, const SharedTileset &tileset)
-{
-    mFirstGidToTileset.insert(firstGid, tileset);
-}
-
 /**
  * Clears the gid mapper, so that it can be reused.
  */
 inline void GidMapper::clear()
 {
     mFirstGidToTileset.clear();
+    mTilesetRanges.clear();
+    mGidToTilesetIndex.clear();
+    mTilesetToFirstGid.clear();
+    mAliases.clear();
 }
 
 /**
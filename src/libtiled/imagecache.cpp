@@ -28,6 +28,7 @@
 
 #include "imagecache.h"
 
+#include "filesystemwatcher.h"
 #include "logginginterface.h"
 #include "map.h"
 #include "mapformat.h"
@@ -38,6 +39,14 @@
 #include <QBitmap>
 #include <QCoreApplication>
 #include <QFileInfo>
+#include <QMutex>
+#include <QPointer>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
 
 namespace Tiled {
 
@@ -62,24 +71,193 @@ uint qHash(const TilesheetParameters &key, uint seed) Q_DECL_NOTHROW
     return h;
 }
 
+struct CachedImage
+{
+    LoadedImage loadedImage;
+    qint64 bytes = 0;
+    quint64 lastUsed = 0;
+};
+
 struct CutTiles
 {
     operator const QVector<QPixmap> &() const { return tiles; }
 
     QVector<QPixmap> tiles;
-    QDateTime lastModified;
+    QSize imageSize;
+    qint64 bytes = 0;
+    quint64 lastUsed = 0;
 };
 
 struct LoadedPixmap
 {
-    explicit LoadedPixmap(const LoadedImage &cachedImage);
-
     operator const QPixmap &() const { return pixmap; }
 
     QPixmap pixmap;
-    QDateTime lastModified;
+    qint64 bytes = 0;
+    quint64 lastUsed = 0;
+};
+
+/**
+ * The tiles cut from a tilesheet, before they are turned into pixmaps. Since
+ * it only involves QImage, cutting can be done on a worker thread.
+ */
+struct CutImages
+{
+    QVector<QImage> tiles;
+    QVector<QImage> masks;
+    bool valid = false;
+};
+
+/**
+ * An image being decoded on the global thread pool. The result is only
+ * accessed by the main thread after wait() returned.
+ */
+struct PendingImage
+{
+    TilesheetParameters parameters;
+    bool cut = false;
+    QDateTime lastModified;     // of the file when decoding started
+
+    QImage image;
+    CutImages cutImages;
+
+    void wait();
+    void finish();
+
+private:
+    QMutex mutex;
+    QWaitCondition finished;
+    bool done = false;
+};
+
+void PendingImage::wait()
+{
+    QMutexLocker locker(&mutex);
+    while (!done)
+        finished.wait(&mutex);
+}
+
+void PendingImage::finish()
+{
+    QMutexLocker locker(&mutex);
+    done = true;
+    finished.wakeAll();
+}
+
+static CutImages cutImages(const QImage &image, const TilesheetParameters &p)
+{
+    Q_ASSERT(p.tileWidth > 0 && p.tileHeight > 0);
+
+    const int stopWidth = image.width() - p.tileWidth;
+    const int stopHeight = image.height() - p.tileHeight;
+
+    CutImages result;
+    result.valid = true;
+
+    QImage mask;
+    if (p.transparentColor.isValid())
+        mask = image.createMaskFromColor(p.transparentColor.rgb());
+
+    for (int y = p.margin; y <= stopHeight; y += p.tileHeight + p.spacing) {
+        for (int x = p.margin; x <= stopWidth; x += p.tileWidth + p.spacing) {
+            result.tiles.append(image.copy(x, y, p.tileWidth, p.tileHeight));
+
+            if (!mask.isNull())
+                result.masks.append(mask.copy(x, y, p.tileWidth, p.tileHeight));
+        }
+    }
+
+    return result;
+}
+
+static qint64 imageBytes(const QImage &image)
+{
+    return qint64(image.bytesPerLine()) * image.height();
+}
+
+static qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+/**
+ * Returns whether the entry is only referenced by the cache. Entries that
+ * are shared with tilesets, tiles or layers stay in memory when dropped.
+ */
+static bool isCacheOnly(const CachedImage &cachedImage)
+{
+    return cachedImage.loadedImage.image.isDetached();
+}
+
+static bool isCacheOnly(const LoadedPixmap &loadedPixmap)
+{
+    return loadedPixmap.pixmap.isDetached();
+}
+
+static bool isCacheOnly(const CutTiles &cutTiles)
+{
+    if (!cutTiles.tiles.isDetached())
+        return false;
+
+    return std::all_of(cutTiles.tiles.begin(), cutTiles.tiles.end(),
+                       [] (const QPixmap &tile) { return tile.isDetached(); });
+}
+
+/**
+ * Returns the watcher used to invalidate the entries of changed files,
+ * creating it when necessary. Since it is a QObject, it is only available
+ * on the main thread.
+ */
+static FileSystemWatcher *fileWatcher()
+{
+    static QPointer<FileSystemWatcher> watcher;
+
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app || QThread::currentThread() != app->thread())
+        return nullptr;
+
+    if (!watcher) {
+        watcher = new FileSystemWatcher(app);
+        QObject::connect(watcher.data(), &FileSystemWatcher::fileChanged,
+                         watcher.data(), [] (const QString &fileName) {
+            ImageCache::remove(fileName);
+        });
+    }
+
+    return watcher;
+}
+
+static bool isWatchable(const QString &fileName)
+{
+    return !fileName.startsWith(QLatin1Char(':'));
+}
+
+namespace {
+
+class ImageDecoder : public QRunnable
+{
+public:
+    explicit ImageDecoder(std::shared_ptr<PendingImage> pending)
+        : mPending(std::move(pending))
+    {}
+
+    void run() override
+    {
+        PendingImage &pending = *mPending;
+
+        pending.image = QImage(pending.parameters.fileName);
+        if (pending.cut && !pending.image.isNull())
+            pending.cutImages = cutImages(pending.image, pending.parameters);
+
+        pending.finish();
+    }
+
+private:
+    std::shared_ptr<PendingImage> mPending;
 };
 
+} // anonymous namespace
+
 
 LoadedImage::LoadedImage()
     : LoadedImage(QImage(), QDateTime())
@@ -91,15 +269,17 @@ LoadedImage::LoadedImage(QImage image, const QDateTime &lastModified)
 {}
 
 
-LoadedPixmap::LoadedPixmap(const LoadedImage &cachedImage)
-    : pixmap(QPixmap::fromImage(cachedImage))
-    , lastModified(cachedImage.lastModified)
-{}
-
-
-QHash<QString, LoadedImage> ImageCache::sLoadedImages;
+QHash<QString, CachedImage> ImageCache::sLoadedImages;
 QHash<QString, LoadedPixmap> ImageCache::sLoadedPixmaps;
 QHash<TilesheetParameters, CutTiles> ImageCache::sCutTiles;
+QHash<QString, std::shared_ptr<PendingImage>> ImageCache::sPendingImages;
+QHash<QString, int> ImageCache::sEntryCounts;
+QHash<QString, QDateTime> ImageCache::sFailedFiles;
+
+qint64 ImageCache::sMemoryBudget = 512 * 1024 * 1024;
+qint64 ImageCache::sCachedBytes;
+quint64 ImageCache::sUseCounter;
+ImageCacheStatistics ImageCache::sStatistics;
 
 LoadedImage ImageCache::loadImage(const QString &fileName)
 {
@@ -107,25 +287,33 @@ LoadedImage ImageCache::loadImage(const QString &fileName)
         return {};
 
     auto it = sLoadedImages.find(fileName);
+    if (it != sLoadedImages.end()) {
+        ++sStatistics.hits;
+        it.value().lastUsed = touch();
+        return it.value().loadedImage;
+    }
 
-    QFileInfo info(fileName);
-    bool found = it != sLoadedImages.end();
-    bool old = found && it.value().lastModified < info.lastModified();
+    if (isKnownFailure(fileName)) {
+        ++sStatistics.hits;
+        return {};
+    }
 
-    if (old)
-        remove(fileName);
+    ++sStatistics.misses;
 
-    if (old || !found) {
-        QImage image(fileName);
+    const LoadedImage loadedImage = readImage(fileName);
+    if (loadedImage.image.isNull())
+        return loadedImage;
 
-        // If the image failed to load, try to load and render a map file
-        if (image.isNull())
-            image = renderMap(fileName);
+    CachedImage cachedImage;
+    cachedImage.loadedImage = loadedImage;
+    cachedImage.bytes = imageBytes(loadedImage.image);
+    cachedImage.lastUsed = touch();
 
-        it = sLoadedImages.insert(fileName, LoadedImage(image, info.lastModified()));
-    }
+    evict(cachedImage.bytes);
+    sLoadedImages.insert(fileName, cachedImage);
+    added(fileName, cachedImage.bytes);
 
-    return it.value();
+    return loadedImage;
 }
 
 QPixmap ImageCache::loadPixmap(const QString &fileName)
@@ -134,75 +322,457 @@ QPixmap ImageCache::loadPixmap(const QString &fileName)
         return {};
 
     auto it = sLoadedPixmaps.find(fileName);
+    if (it != sLoadedPixmaps.end()) {
+        ++sStatistics.hits;
+        it.value().lastUsed = touch();
+        return it.value();
+    }
+
+    if (isKnownFailure(fileName)) {
+        ++sStatistics.hits;
+        return {};
+    }
+
+    ++sStatistics.misses;
+
+    // Take over the image when it is cached, to avoid keeping it twice
+    QImage image;
+    auto imageIt = sLoadedImages.find(fileName);
+    if (imageIt != sLoadedImages.end()) {
+        image = imageIt.value().loadedImage.image;
+        removed(fileName, imageIt.value().bytes);
+        sLoadedImages.erase(imageIt);
+    } else {
+        image = readImage(fileName).image;
+    }
+
+    if (image.isNull())
+        return {};
 
-    bool found = it != sLoadedPixmaps.end();
-    bool old = found && it.value().lastModified < QFileInfo(fileName).lastModified();
+    LoadedPixmap loadedPixmap;
+    loadedPixmap.pixmap = QPixmap::fromImage(std::move(image));
+    loadedPixmap.bytes = pixmapBytes(loadedPixmap.pixmap);
+    loadedPixmap.lastUsed = touch();
 
-    if (old)
-        remove(fileName);
-    if (old || !found)
-        it = sLoadedPixmaps.insert(fileName, LoadedPixmap(loadImage(fileName)));
+    evict(loadedPixmap.bytes);
+    sLoadedPixmaps.insert(fileName, loadedPixmap);
+    added(fileName, loadedPixmap.bytes);
 
-    return it.value();
+    return loadedPixmap;
 }
 
-static CutTiles cutTilesImpl(const TilesheetParameters &p)
+/**
+ * Returns the tiles cut from the tilesheet described by \a parameters. When
+ * given, \a imageSize is set to the size of the whole tilesheet, which is
+ * empty when it failed to load.
+ */
+QVector<QPixmap> ImageCache::cutTiles(const TilesheetParameters &parameters,
+                                      QSize *imageSize)
 {
-    Q_ASSERT(p.tileWidth > 0 && p.tileHeight > 0);
+    if (parameters.fileName.isEmpty()) {
+        if (imageSize)
+            *imageSize = QSize();
+        return {};
+    }
 
-    const LoadedImage loadedImage = ImageCache::loadImage(p.fileName);
-    const QImage &image = loadedImage.image;
-    const int stopWidth = image.width() - p.tileWidth;
-    const int stopHeight = image.height() - p.tileHeight;
+    const CutTiles cutTiles = findCutTiles(parameters);
+    if (imageSize)
+        *imageSize = cutTiles.imageSize;
+    return cutTiles;
+}
 
-    CutTiles result;
-    result.lastModified = loadedImage.lastModified;
+/**
+ * Starts decoding the image at \a fileName on the global thread pool. A
+ * following call to loadImage() or loadPixmap() will wait for the result
+ * instead of decoding the image itself.
+ *
+ * Does nothing when the image is already loaded or being decoded.
+ */
+void ImageCache::preloadImage(const QString &fileName)
+{
+    if (fileName.isEmpty())
+        return;
+    if (sLoadedPixmaps.contains(fileName))
+        return;
 
-    for (int y = p.margin; y <= stopHeight; y += p.tileHeight + p.spacing) {
-        for (int x = p.margin; x <= stopWidth; x += p.tileWidth + p.spacing) {
-            const QImage tileImage = image.copy(x, y, p.tileWidth, p.tileHeight);
-            QPixmap tilePixmap = QPixmap::fromImage(tileImage);
+    TilesheetParameters parameters {};
+    parameters.fileName = fileName;
 
-            if (p.transparentColor.isValid()) {
-                const QImage mask = tileImage.createMaskFromColor(p.transparentColor.rgb());
-                tilePixmap.setMask(QBitmap::fromImage(mask));
-            }
+    startDecoding(parameters, false);
+}
+
+/**
+ * Like preloadImage(), but the tiles are also cut on the worker thread, to
+ * be picked up by cutTiles(). Only the conversion to pixmaps
+ * is left to the calling thread.
+ */
+void ImageCache::preloadTilesheet(const TilesheetParameters &parameters)
+{
+    if (parameters.fileName.isEmpty())
+        return;
+    if (parameters.tileWidth <= 0 || parameters.tileHeight <= 0)
+        return;
+    if (sCutTiles.contains(parameters))
+        return;
 
-            result.tiles.append(tilePixmap);
+    startDecoding(parameters, true);
+}
+
+/**
+ * Forgets about the images being decoded for the given files, for example
+ * because the file that referred to them failed to load. Decoders that are
+ * still running finish in the background, but their result is dropped.
+ */
+void ImageCache::cancelPending(const QStringList &fileNames)
+{
+    for (const QString &fileName : fileNames)
+        sPendingImages.remove(fileName);
+}
+
+/**
+ * Removes all entries for the given file from the cache.
+ */
+void ImageCache::remove(const QString &fileName)
+{
+    auto imageIt = sLoadedImages.find(fileName);
+    if (imageIt != sLoadedImages.end()) {
+        removed(fileName, imageIt.value().bytes);
+        sLoadedImages.erase(imageIt);
+    }
+
+    auto pixmapIt = sLoadedPixmaps.find(fileName);
+    if (pixmapIt != sLoadedPixmaps.end()) {
+        removed(fileName, pixmapIt.value().bytes);
+        sLoadedPixmaps.erase(pixmapIt);
+    }
+
+    // Also remove any previously cut tiles
+    for (auto it = sCutTiles.begin(); it != sCutTiles.end(); ) {
+        if (it.key().fileName == fileName) {
+            removed(fileName, it.value().bytes);
+            it = sCutTiles.erase(it);
+        } else {
+            ++it;
         }
     }
 
-    return result;
+    sPendingImages.remove(fileName);
+    sFailedFiles.remove(fileName);
 }
 
-QVector<QPixmap> ImageCache::cutTiles(const TilesheetParameters &parameters)
+/**
+ * Removes all entries from the cache.
+ */
+void ImageCache::clear()
 {
-    if (parameters.fileName.isEmpty())
-        return {};
+    if (FileSystemWatcher *watcher = fileWatcher()) {
+        for (auto it = sEntryCounts.cbegin(); it != sEntryCounts.cend(); ++it)
+            if (isWatchable(it.key()))
+                watcher->removePath(it.key());
+    }
+
+    sLoadedImages.clear();
+    sLoadedPixmaps.clear();
+    sCutTiles.clear();
+    sPendingImages.clear();
+    sEntryCounts.clear();
+    sFailedFiles.clear();
+
+    sCachedBytes = 0;
+}
 
+/**
+ * Returns the amount of memory the cache may use, in bytes.
+ */
+qint64 ImageCache::memoryBudget()
+{
+    return sMemoryBudget;
+}
+
+/**
+ * Sets the amount of memory the cache may use. Least recently used entries
+ * are removed when it uses more than \a bytes.
+ *
+ * Note that pixmaps are implicitly shared, so entries that are still in use
+ * by tilesets and layers are kept, since removing them would not free any
+ * memory.
+ */
+void ImageCache::setMemoryBudget(qint64 bytes)
+{
+    sMemoryBudget = bytes;
+    evict();
+}
+
+ImageCacheStatistics ImageCache::statistics()
+{
+    ImageCacheStatistics statistics = sStatistics;
+    statistics.residentBytes = cacheOnlyBytes();
+    return statistics;
+}
+
+/**
+ * Reads the image at \a fileName without caching it, picking up the result
+ * when it is being decoded in the background. When the decoder also cut the
+ * tiles described by \a parameters, these are assigned to \a cutImages.
+ *
+ * A background result is discarded when the file was modified after its
+ * decoding started.
+ */
+LoadedImage ImageCache::readImage(const QString &fileName,
+                                  const TilesheetParameters *parameters,
+                                  CutImages *cutImages)
+{
+    const QDateTime lastModified = QFileInfo(fileName).lastModified();
+    const auto pending = sPendingImages.take(fileName);
+    QImage image;
+
+    if (pending && pending->lastModified == lastModified) {
+        pending->wait();
+        image = std::move(pending->image);
+
+        if (cutImages && pending->cut && pending->parameters == *parameters)
+            *cutImages = std::move(pending->cutImages);
+    } else {
+        image = QImage(fileName);
+    }
+
+    // If the image failed to load, try to load and render a map file
+    if (image.isNull())
+        image = renderMap(fileName);
+
+    if (image.isNull())
+        sFailedFiles.insert(fileName, lastModified);
+
+    return LoadedImage(std::move(image), lastModified);
+}
+
+CutTiles ImageCache::findCutTiles(const TilesheetParameters &parameters)
+{
     auto it = sCutTiles.find(parameters);
+    if (it != sCutTiles.end()) {
+        ++sStatistics.hits;
+        it.value().lastUsed = touch();
+        return it.value();
+    }
+
+    const QString &fileName = parameters.fileName;
+
+    if (isKnownFailure(fileName)) {
+        ++sStatistics.hits;
+        return {};
+    }
+
+    ++sStatistics.misses;
+
+    QImage image;
+    CutImages images;
+
+    auto imageIt = sLoadedImages.find(fileName);
+    if (imageIt != sLoadedImages.end()) {
+        imageIt.value().lastUsed = touch();
+        image = imageIt.value().loadedImage.image;
+    } else {
+        image = readImage(fileName, &parameters, &images).image;
+    }
+
+    if (image.isNull())
+        return {};
+
+    if (!images.valid)
+        images = cutImages(image, parameters);
 
-    bool found = it != sCutTiles.end();
-    bool old = found && it.value().lastModified < QFileInfo(parameters.fileName).lastModified();
+    CutTiles cutTiles;
+    cutTiles.imageSize = image.size();
+    cutTiles.tiles.reserve(images.tiles.size());
 
-    if (old)
-        remove(parameters.fileName);
-    if (old || !found)
-        it = sCutTiles.insert(parameters, cutTilesImpl(parameters));
+    for (int i = 0; i < images.tiles.size(); ++i) {
+        QPixmap tilePixmap = QPixmap::fromImage(images.tiles.at(i));
 
-    return it.value();
+        if (!images.masks.isEmpty())
+            tilePixmap.setMask(QBitmap::fromImage(images.masks.at(i)));
+
+        cutTiles.bytes += pixmapBytes(tilePixmap);
+        cutTiles.tiles.append(tilePixmap);
+    }
+
+    cutTiles.lastUsed = touch();
+
+    evict(cutTiles.bytes);
+    sCutTiles.insert(parameters, cutTiles);
+    added(fileName, cutTiles.bytes);
+
+    return cutTiles;
 }
 
-void ImageCache::remove(const QString &fileName)
+void ImageCache::startDecoding(const TilesheetParameters &parameters, bool cut)
 {
-    sLoadedImages.remove(fileName);
-    sLoadedPixmaps.remove(fileName);
+    const QString &fileName = parameters.fileName;
 
-    // Also remove any previously cut tiles
-    QMutableHashIterator<TilesheetParameters, CutTiles> it(sCutTiles);
-    while (it.hasNext()) {
-        if (it.next().key().fileName == fileName)
-            it.remove();
+    if (sLoadedImages.contains(fileName) || sPendingImages.contains(fileName))
+        return;
+    if (isKnownFailure(fileName))
+        return;
+
+    auto pending = std::make_shared<PendingImage>();
+    pending->parameters = parameters;
+    pending->cut = cut;
+    pending->lastModified = QFileInfo(fileName).lastModified();
+
+    sPendingImages.insert(fileName, pending);
+    QThreadPool::globalInstance()->start(new ImageDecoder(std::move(pending)));
+}
+
+/**
+ * Returns whether \a fileName failed to load before and was not modified
+ * since then.
+ */
+bool ImageCache::isKnownFailure(const QString &fileName)
+{
+    auto it = sFailedFiles.find(fileName);
+    if (it == sFailedFiles.end())
+        return false;
+
+    if (it.value() == QFileInfo(fileName).lastModified())
+        return true;
+
+    sFailedFiles.erase(it);
+    return false;
+}
+
+/**
+ * Returns the memory used by the entries that are not referenced outside of
+ * the cache.
+ */
+qint64 ImageCache::cacheOnlyBytes()
+{
+    qint64 bytes = 0;
+
+    for (const CachedImage &cachedImage : qAsConst(sLoadedImages))
+        if (isCacheOnly(cachedImage))
+            bytes += cachedImage.bytes;
+    for (const LoadedPixmap &loadedPixmap : qAsConst(sLoadedPixmaps))
+        if (isCacheOnly(loadedPixmap))
+            bytes += loadedPixmap.bytes;
+    for (const CutTiles &cutTiles : qAsConst(sCutTiles))
+        if (isCacheOnly(cutTiles))
+            bytes += cutTiles.bytes;
+
+    return bytes;
+}
+
+quint64 ImageCache::touch()
+{
+    return ++sUseCounter;
+}
+
+/**
+ * Accounts for a new entry for \a fileName, starting to watch the file
+ * when it is the first one.
+ */
+void ImageCache::added(const QString &fileName, qint64 bytes)
+{
+    sCachedBytes += bytes;
+
+    if (sEntryCounts[fileName]++ == 0 && isWatchable(fileName))
+        if (FileSystemWatcher *watcher = fileWatcher())
+            watcher->addPath(fileName);
+}
+
+/**
+ * Accounts for the removal of an entry for \a fileName, no longer watching
+ * the file when it was the last one.
+ */
+void ImageCache::removed(const QString &fileName, qint64 bytes)
+{
+    sCachedBytes -= bytes;
+
+    auto it = sEntryCounts.find(fileName);
+    Q_ASSERT(it != sEntryCounts.end());
+    if (it == sEntryCounts.end())
+        return;
+
+    if (--it.value() == 0) {
+        sEntryCounts.erase(it);
+
+        if (isWatchable(fileName))
+            if (FileSystemWatcher *watcher = fileWatcher())
+                watcher->removePath(fileName);
+    }
+}
+
+/**
+ * Removes the least recently used entries until the cache, including an
+ * entry of \a incomingBytes about to be added, fits within its memory budget.
+ *
+ * Entries that are still in use elsewhere are skipped, since dropping them
+ * would not free any memory and would only cause their file to be decoded
+ * again on the next load. This is also why this is called before adding a
+ * new entry, which the caller is about to use.
+ */
+void ImageCache::evict(qint64 incomingBytes)
+{
+    if (sCachedBytes + incomingBytes <= sMemoryBudget)
+        return;
+
+    enum EntryType { Image, Pixmap, Tiles };
+
+    struct Entry
+    {
+        quint64 lastUsed;
+        qint64 bytes;
+        EntryType type;
+        TilesheetParameters key;
+    };
+
+    QVector<Entry> entries;
+    qint64 residentBytes = 0;
+
+    TilesheetParameters key {};
+
+    for (auto it = sLoadedImages.cbegin(); it != sLoadedImages.cend(); ++it) {
+        if (isCacheOnly(it.value())) {
+            key.fileName = it.key();
+            entries.append(Entry { it.value().lastUsed, it.value().bytes, Image, key });
+            residentBytes += it.value().bytes;
+        }
+    }
+    for (auto it = sLoadedPixmaps.cbegin(); it != sLoadedPixmaps.cend(); ++it) {
+        if (isCacheOnly(it.value())) {
+            key.fileName = it.key();
+            entries.append(Entry { it.value().lastUsed, it.value().bytes, Pixmap, key });
+            residentBytes += it.value().bytes;
+        }
+    }
+    for (auto it = sCutTiles.cbegin(); it != sCutTiles.cend(); ++it) {
+        if (isCacheOnly(it.value())) {
+            entries.append(Entry { it.value().lastUsed, it.value().bytes, Tiles, it.key() });
+            residentBytes += it.value().bytes;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [] (const Entry &a, const Entry &b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    for (const Entry &entry : qAsConst(entries)) {
+        if (residentBytes + incomingBytes <= sMemoryBudget)
+            break;
+
+        switch (entry.type) {
+        case Image:
+            sLoadedImages.remove(entry.key.fileName);
+            break;
+        case Pixmap:
+            sLoadedPixmaps.remove(entry.key.fileName);
+            break;
+        case Tiles:
+            sCutTiles.remove(entry.key);
+            break;
+        }
+
+        removed(entry.key.fileName, entry.bytes);
+        residentBytes -= entry.bytes;
+        ++sStatistics.evictions;
     }
 }
 
@@ -36,6 +36,9 @@
 #include <QImage>
 #include <QPixmap>
 #include <QString>
+#include <QStringList>
+
+#include <memory>
 
 namespace Tiled {
 
@@ -64,25 +67,84 @@ struct LoadedImage
     QDateTime lastModified;
 };
 
+/**
+ * Statistics about the ImageCache, for diagnostic purposes.
+ *
+ * The resident bytes only include the entries that are no longer used
+ * outside of the cache, since only dropping those frees any memory.
+ */
+struct ImageCacheStatistics
+{
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 residentBytes = 0;
+};
+
+struct CachedImage;
+struct CutImages;
 struct CutTiles;
 struct LoadedPixmap;
+struct PendingImage;
 class Map;
 
+/**
+ * Caches the images, pixmaps and cut tiles loaded from files, so that they
+ * can be shared between tilesets, tiles and image layers. Files that failed
+ * to load are remembered as well, until they are modified.
+ *
+ * The cache is bounded by a memory budget. When it is exceeded, the least
+ * recently used entries that are no longer in use elsewhere are dropped.
+ * Entries are invalidated when their file changes on disk, or when remove()
+ * is called.
+ */
 class TILEDSHARED_EXPORT ImageCache
 {
 public:
     static LoadedImage loadImage(const QString &fileName);
     static QPixmap loadPixmap(const QString &fileName);
-    static QVector<QPixmap> cutTiles(const TilesheetParameters &parameters);
+    static QVector<QPixmap> cutTiles(const TilesheetParameters &parameters,
+                                     QSize *imageSize = nullptr);
+
+    static void preloadImage(const QString &fileName);
+    static void preloadTilesheet(const TilesheetParameters &parameters);
+    static void cancelPending(const QStringList &fileNames);
 
     static void remove(const QString &fileName);
+    static void clear();
+
+    static qint64 memoryBudget();
+    static void setMemoryBudget(qint64 bytes);
+
+    static ImageCacheStatistics statistics();
 
 private:
+    static LoadedImage readImage(const QString &fileName,
+                                 const TilesheetParameters *parameters = nullptr,
+                                 CutImages *cutImages = nullptr);
+    static CutTiles findCutTiles(const TilesheetParameters &parameters);
+    static void startDecoding(const TilesheetParameters &parameters, bool cut);
     static QImage renderMap(const QString &fileName);
 
-    static QHash<QString, LoadedImage> sLoadedImages;
+    static bool isKnownFailure(const QString &fileName);
+    static qint64 cacheOnlyBytes();
+
+    static quint64 touch();
+    static void added(const QString &fileName, qint64 bytes);
+    static void removed(const QString &fileName, qint64 bytes);
+    static void evict(qint64 incomingBytes = 0);
+
+    static QHash<QString, CachedImage> sLoadedImages;
     static QHash<QString, LoadedPixmap> sLoadedPixmaps;
     static QHash<TilesheetParameters, CutTiles> sCutTiles;
+    static QHash<QString, std::shared_ptr<PendingImage>> sPendingImages;
+    static QHash<QString, int> sEntryCounts;
+    static QHash<QString, QDateTime> sFailedFiles;
+
+    static qint64 sMemoryBudget;
+    static qint64 sCachedBytes;
+    static quint64 sUseCounter;
+    static ImageCacheStatistics sStatistics;
 };
 
 } // namespace Tiled
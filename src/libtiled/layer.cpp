@@ -60,9 +60,17 @@ Layer::Layer(TypeFlag type, const QString &name, int x, int y) :
 {
 }
 
+void Layer::setId(int id)
+{
+    mId = id;
+
+    if (mMap)
+        mMap->invalidateLayerIndex();
+}
+
 void Layer::resetIds()
 {
-    mId = 0;        // reset out own ID
+    setId(0);       // reset out own ID
 
     switch (layerType()) {
     case ObjectGroupType:
@@ -225,6 +233,28 @@ Layer *Layer::initializeClone(Layer *clone) const
     return clone;
 }
 
+void Layer::setMap(Map *map)
+{
+    // The ID indexes of both maps are affected
+    if (mMap) {
+        mMap->invalidateLayerIndex();
+        if (isObjectGroup()) {
+            mMap->invalidateObjectIndex();
+            mMap->invalidateTemplateIndex();
+        }
+    }
+
+    mMap = map;
+
+    if (mMap) {
+        mMap->invalidateLayerIndex();
+        if (isObjectGroup()) {
+            mMap->invalidateObjectIndex();
+            mMap->invalidateTemplateIndex();
+        }
+    }
+}
+
 TileLayer *Layer::asTileLayer()
 {
     return isTileLayer() ? static_cast<TileLayer*>(this) : nullptr;
@@ -71,7 +71,7 @@ public:
      * stays the same regardless of whether the layer is moved or renamed.
      */
     int id() const { return mId; }
-    void setId(int id) { mId = id; }
+    void setId(int id);
     void resetIds();
 
     const QColor &tintColor() const { return mTintColor; }
@@ -246,7 +246,7 @@ protected:
      * Sets the map this layer is part of. Should only be called from the
      * Map class.
      */
-    virtual void setMap(Map *map) { mMap = map; }
+    virtual void setMap(Map *map);
     void setParentLayer(GroupLayer *groupLayer) { mParentLayer = groupLayer; }
 
     Layer *initializeClone(Layer *clone) const;
@@ -0,0 +1,269 @@
+/*
+ * layerdatadecoding.cpp
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "layerdatadecoding.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILED_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Tiled {
+
+static inline int base64Value(unsigned c)
+{
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == '+')
+        return 62;
+    if (c == '/')
+        return 63;
+    return -1;
+}
+
+#ifdef TILED_USE_SSE2
+
+static inline __m128i load16(const char *input)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+}
+
+static inline __m128i load16(const unsigned short *input)
+{
+    // Values outside of Latin-1 saturate to characters outside of the Base64
+    // alphabet
+    const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+    const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 8));
+    return _mm_packus_epi16(low, high);
+}
+
+static inline __m128i inRange(__m128i chars, char first, char last)
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)),
+                         _mm_cmplt_epi8(chars, _mm_set1_epi8(last + 1)));
+}
+
+/**
+ * Decodes 16 Base64 characters into 12 bytes. Returns false without writing
+ * anything when any of the characters is not part of the Base64 alphabet.
+ */
+static inline bool decodeBase64Block(__m128i chars, unsigned char *output)
+{
+    const __m128i upper = inRange(chars, 'A', 'Z');
+    const __m128i lower = inRange(chars, 'a', 'z');
+    const __m128i digit = inRange(chars, '0', '9');
+    const __m128i plus = _mm_cmpeq_epi8(chars, _mm_set1_epi8('+'));
+    const __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                       _mm_or_si128(_mm_or_si128(digit, plus), slash));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    // Translate the characters to their 6-bit values
+    __m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(plus, _mm_set1_epi8(62 - '+')));
+    offset = _mm_or_si128(offset, _mm_and_si128(slash, _mm_set1_epi8(63 - '/')));
+    const __m128i values = _mm_add_epi8(chars, offset);
+
+    // Merge pairs of 6-bit values into 12 bits, then pairs of those into 24
+    const __m128i pairs = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values, _mm_set1_epi16(0x00FF)), 6),
+                                       _mm_srli_epi16(values, 8));
+    const __m128i quads = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), 12),
+                                       _mm_srli_epi32(pairs, 16));
+
+    // Swap the first and third byte of each 24-bit value to big-endian order
+    const __m128i swapped = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(quads, _mm_set1_epi32(0xFF)), 16),
+                                                      _mm_and_si128(quads, _mm_set1_epi32(0xFF00))),
+                                         _mm_and_si128(_mm_srli_epi32(quads, 16), _mm_set1_epi32(0xFF)));
+
+    alignas(16) unsigned char bytes[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(bytes), swapped);
+
+    std::memcpy(output, bytes, 3);
+    std::memcpy(output + 3, bytes + 4, 3);
+    std::memcpy(output + 6, bytes + 8, 3);
+    std::memcpy(output + 9, bytes + 12, 3);
+
+    return true;
+}
+
+#endif // TILED_USE_SSE2
+
+template<typename Char>
+static int decodeBase64Impl(const Char *input, int length, unsigned char *output)
+{
+    unsigned char *out = output;
+    unsigned buffer = 0;
+    int bits = 0;
+    int i = 0;
+
+    while (i < length) {
+#ifdef TILED_USE_SSE2
+        // Decode blocks of 16 characters while in sync with the 4 character
+        // groups and no characters need to be skipped
+        if (bits == 0) {
+            while (i + 16 <= length && decodeBase64Block(load16(input + i), out)) {
+                i += 16;
+                out += 12;
+            }
+            if (i >= length)
+                break;
+        }
+#endif
+
+        const int value = base64Value(static_cast<unsigned>(input[i]));
+        ++i;
+
+        if (value == -1)
+            continue;
+
+        buffer = (buffer << 6) | static_cast<unsigned>(value);
+        bits += 6;
+
+        if (bits >= 8) {
+            bits -= 8;
+            *out++ = static_cast<unsigned char>(buffer >> bits);
+            buffer &= (1u << bits) - 1;
+        }
+    }
+
+    return static_cast<int>(out - output);
+}
+
+int decodeBase64(const char *input, int length, unsigned char *output)
+{
+    return decodeBase64Impl(input, length, output);
+}
+
+int decodeBase64(const unsigned short *input, int length, unsigned char *output)
+{
+    return decodeBase64Impl(input, length, output);
+}
+
+static inline bool isSpace(unsigned c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r') || c == 0x85 || c == 0xA0;
+}
+
+static inline int countTrailingZeros(unsigned value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(value);
+#endif
+}
+
+/**
+ * Reads \a count values into \a values. Returns the number of values that
+ * were read, which is less than \a count in case of an error.
+ */
+int CsvGidParser::read(unsigned *values, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        if (atEnd()) {
+            mError = UnexpectedEnd;
+            return i;
+        }
+
+        if (!readValue(values[i]))
+            return i;
+    }
+
+    return count;
+}
+
+bool CsvGidParser::readValue(unsigned &value)
+{
+#ifdef TILED_USE_SSE2
+    // Fast path for up to 7 digits directly followed by a comma
+    if (mPosition + 8 <= mLength) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mText + mPosition));
+        const __m128i digitValues = _mm_sub_epi16(chars, _mm_set1_epi16('0'));
+        const __m128i isDigit = _mm_and_si128(_mm_cmpgt_epi16(digitValues, _mm_set1_epi16(-1)),
+                                              _mm_cmplt_epi16(digitValues, _mm_set1_epi16(10)));
+        const __m128i isComma = _mm_cmpeq_epi16(chars, _mm_set1_epi16(',')) ;
+
+        // Two mask bits per character
+        const unsigned digitMask = static_cast<unsigned>(_mm_movemask_epi8(isDigit));
+        const unsigned commaMask = static_cast<unsigned>(_mm_movemask_epi8(isComma));
+        const int digitCount = countTrailingZeros(~digitMask | 0x10000) / 2;
+
+        if (digitCount < 8 && (commaMask >> (digitCount * 2)) & 1) {
+            const unsigned short *digits = mText + mPosition;
+            unsigned result = 0;
+            for (int i = 0; i < digitCount; ++i)
+                result = result * 10 + (digits[i] - '0');
+
+            value = result;
+            mPosition += digitCount + 1;
+            return true;
+        }
+    }
+#endif
+
+    unsigned result = 0;
+
+    while (mPosition < mLength) {
+        const unsigned short c = mText[mPosition];
+        ++mPosition;
+
+        if (c == ',')
+            break;
+        if (isSpace(c))
+            continue;
+
+        if (c >= '0' && c <= '9') {
+            result = result * 10 + (c - '0');
+        } else {
+            mError = InvalidCharacter;
+            mErrorCharacter = c;
+            return false;
+        }
+    }
+
+    value = result;
+    return true;
+}
+
+} // namespace Tiled
@@ -0,0 +1,101 @@
+/*
+ * layerdatadecoding.h
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "tiled_global.h"
+
+namespace Tiled {
+
+/**
+ * Returns the maximum number of bytes decodeBase64() may write for an input
+ * of the given \a length.
+ */
+inline int base64DecodedSizeBound(int length)
+{
+    return (length / 4) * 3 + 3;
+}
+
+/**
+ * Decodes Base64 encoded \a input of the given \a length into \a output,
+ * which needs to provide room for at least base64DecodedSizeBound() bytes.
+ * Returns the number of bytes written.
+ *
+ * Like QByteArray::fromBase64, characters that are not part of the Base64
+ * alphabet (whitespace and padding) are skipped. Runs of valid characters
+ * are decoded 16 at a time when SSE2 is available.
+ */
+int TILEDSHARED_EXPORT decodeBase64(const char *input, int length,
+                                    unsigned char *output);
+
+/**
+ * Overload that decodes Base64 directly from UTF-16 text, which avoids a
+ * conversion of the text read from XML to Latin-1.
+ */
+int TILEDSHARED_EXPORT decodeBase64(const unsigned short *input, int length,
+                                    unsigned char *output);
+
+/**
+ * Reads the comma separated global tile IDs of the CSV layer data format
+ * from UTF-16 text.
+ *
+ * Whitespace around the values is ignored and empty values are read as 0.
+ * When SSE2 is available, the common case of a value directly followed by
+ * a comma is recognized for up to 8 characters at a time.
+ */
+class TILEDSHARED_EXPORT CsvGidParser
+{
+public:
+    enum Error {
+        NoError,
+        UnexpectedEnd,
+        InvalidCharacter
+    };
+
+    CsvGidParser(const unsigned short *text, int length)
+        : mText(text)
+        , mLength(length)
+    {}
+
+    int read(unsigned *values, int count);
+
+    bool atEnd() const { return mPosition >= mLength; }
+    Error error() const { return mError; }
+    unsigned short errorCharacter() const { return mErrorCharacter; }
+
+private:
+    bool readValue(unsigned &value);
+
+    const unsigned short * const mText;
+    const int mLength;
+    int mPosition = 0;
+    Error mError = NoError;
+    unsigned short mErrorCharacter = 0;
+};
+
+} // namespace Tiled
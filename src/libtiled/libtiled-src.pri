@@ -12,6 +12,7 @@ SOURCES += $$PWD/compression.cpp \
     $$PWD/imagereference.cpp \
     $$PWD/isometricrenderer.cpp \
     $$PWD/layer.cpp \
+    $$PWD/layerdatadecoding.cpp \
     $$PWD/logginginterface.cpp \
     $$PWD/map.cpp \
     $$PWD/mapformat.cpp \
@@ -30,6 +31,7 @@ SOURCES += $$PWD/compression.cpp \
     $$PWD/plugin.cpp \
     $$PWD/pluginmanager.cpp \
     $$PWD/properties.cpp \
+    $$PWD/regionbuilder.cpp \
     $$PWD/savefile.cpp \
     $$PWD/staggeredrenderer.cpp \
     $$PWD/templatemanager.cpp \
@@ -56,6 +58,7 @@ HEADERS += $$PWD/compression.h \
     $$PWD/imagereference.h \
     $$PWD/isometricrenderer.h \
     $$PWD/layer.h \
+    $$PWD/layerdatadecoding.h \
     $$PWD/logginginterface.h \
     $$PWD/map.h \
     $$PWD/mapformat.h \
@@ -74,6 +77,7 @@ HEADERS += $$PWD/compression.h \
     $$PWD/plugin.h \
     $$PWD/pluginmanager.h \
     $$PWD/properties.h \
+    $$PWD/regionbuilder.h \
     $$PWD/savefile.h \
     $$PWD/staggeredrenderer.h \
     $$PWD/templatemanager.h \
@@ -381,21 +381,39 @@ QList<MapObject*> Map::replaceObjectTemplate(const ObjectTemplate *oldObjectTemp
 {
     Q_ASSERT(oldObjectTemplate != newObjectTemplate);
 
-    QList<MapObject*> changedObjects;
-
-    for (auto layer : objectGroups()) {
-        for (auto o : static_cast<ObjectGroup*>(layer)->objects()) {
-            if (o->objectTemplate() == oldObjectTemplate) {
-                o->setObjectTemplate(newObjectTemplate);
-                o->syncWithTemplate();
-                changedObjects.append(o);
-            }
-        }
+    const QList<MapObject*> changedObjects = templateInstances(oldObjectTemplate);
+
+    for (MapObject *o : changedObjects) {
+        o->setObjectTemplate(newObjectTemplate);
+        o->syncWithTemplate();
     }
 
     return changedObjects;
 }
 
+/**
+ * Returns the objects on this map that are instances of the given
+ * \a objectTemplate, in no particular order.
+ */
+QList<MapObject*> Map::templateInstances(const ObjectTemplate *objectTemplate) const
+{
+    if (mTemplateIndexDirty)
+        rebuildTemplateIndex();
+
+    return mTemplateInstances.value(objectTemplate).values();
+}
+
+/**
+ * Returns the templates that have instances on this map.
+ */
+QList<const ObjectTemplate*> Map::usedTemplates() const
+{
+    if (mTemplateIndexDirty)
+        rebuildTemplateIndex();
+
+    return mTemplateInstances.keys();
+}
+
 void Map::initializeObjectIds(ObjectGroup &objectGroup)
 {
     for (MapObject *o : objectGroup) {
@@ -404,24 +422,152 @@ void Map::initializeObjectIds(ObjectGroup &objectGroup)
     }
 }
 
+/**
+ * Returns the layer with the given \a layerId, or nullptr if no such layer
+ * exists. When multiple layers share the same ID, the first one is returned.
+ */
 Layer *Map::findLayerById(int layerId) const
 {
-    for (Layer *layer : allLayers()) {
-        if (layer->id() == layerId)
-            return layer;
+    if (mLayerIndexDirty) {
+        mLayersById.clear();
+
+        for (Layer *layer : allLayers())
+            if (!mLayersById.contains(layer->id()))
+                mLayersById.insert(layer->id(), layer);
+
+        mLayerIndexDirty = false;
     }
-    return nullptr;
+
+    return mLayersById.value(layerId);
 }
 
+/**
+ * Returns the object with the given \a objectId, or nullptr if no such
+ * object exists. When multiple objects share the same ID, the first one is
+ * returned.
+ */
 MapObject *Map::findObjectById(int objectId) const
 {
+    if (mObjectIndexDirty)
+        rebuildObjectIndex();
+
+    return mObjectsById.value(objectId);
+}
+
+/**
+ * Keeps the object index up to date when \a object was added to one of the
+ * object groups of this map, or when its ID was changed.
+ */
+void Map::objectAdded(MapObject *object)
+{
+    if (!mTemplateIndexDirty && object->objectTemplate())
+        mTemplateInstances[object->objectTemplate()].insert(object);
+
+    if (mObjectIndexDirty)
+        return;
+
+    auto it = mObjectsById.find(object->id());
+    if (it == mObjectsById.end())
+        mObjectsById.insert(object->id(), object);
+    else if (it.value() != object)
+        invalidateObjectIndex();    // which one is found depends on the order
+}
+
+/**
+ * Keeps the object index up to date when \a object is about to be removed
+ * from this map, or when its ID is about to change.
+ */
+void Map::objectRemoved(MapObject *object)
+{
+    if (!mTemplateIndexDirty && object->objectTemplate()) {
+        auto it = mTemplateInstances.find(object->objectTemplate());
+        if (it != mTemplateInstances.end()) {
+            it->remove(object);
+            if (it->isEmpty())
+                mTemplateInstances.erase(it);
+        }
+    }
+
+    if (mObjectIndexDirty)
+        return;
+
+    auto it = mObjectsById.find(object->id());
+    if (it != mObjectsById.end() && it.value() == object) {
+        if (mHasDuplicateObjectIds)
+            invalidateObjectIndex();    // another object may need to take its place
+        else
+            mObjectsById.erase(it);
+    }
+}
+
+/**
+ * Keeps the template index up to date when \a object, which is part of this
+ * map, stopped being an instance of \a oldObjectTemplate.
+ */
+void Map::objectTemplateChanged(MapObject *object,
+                                const ObjectTemplate *oldObjectTemplate)
+{
+    if (mTemplateIndexDirty)
+        return;
+
+    if (oldObjectTemplate) {
+        auto it = mTemplateInstances.find(oldObjectTemplate);
+        if (it != mTemplateInstances.end()) {
+            it->remove(object);
+            if (it->isEmpty())
+                mTemplateInstances.erase(it);
+        }
+    }
+
+    if (object->objectTemplate())
+        mTemplateInstances[object->objectTemplate()].insert(object);
+}
+
+void Map::invalidateObjectIndex()
+{
+    mObjectIndexDirty = true;
+    mObjectsById.clear();
+}
+
+void Map::invalidateLayerIndex()
+{
+    mLayerIndexDirty = true;
+    mLayersById.clear();
+}
+
+void Map::invalidateTemplateIndex()
+{
+    mTemplateIndexDirty = true;
+    mTemplateInstances.clear();
+}
+
+void Map::rebuildObjectIndex() const
+{
+    mObjectsById.clear();
+    mHasDuplicateObjectIds = false;
+
     for (Layer *layer : objectGroups()) {
         for (MapObject *mapObject : static_cast<ObjectGroup*>(layer)->objects()) {
-            if (mapObject->id() == objectId)
-                return mapObject;
+            if (mObjectsById.contains(mapObject->id()))
+                mHasDuplicateObjectIds = true;
+            else
+                mObjectsById.insert(mapObject->id(), mapObject);
         }
     }
-    return nullptr;
+
+    mObjectIndexDirty = false;
+}
+
+void Map::rebuildTemplateIndex() const
+{
+    mTemplateInstances.clear();
+
+    for (Layer *layer : objectGroups())
+        for (MapObject *mapObject : static_cast<ObjectGroup*>(layer)->objects())
+            if (const ObjectTemplate *objectTemplate = mapObject->objectTemplate())
+                mTemplateInstances[objectTemplate].insert(mapObject);
+
+    mTemplateIndexDirty = false;
 }
 
 QRegion Map::tileRegion() const
@@ -35,8 +35,10 @@
 #include "tileset.h"
 
 #include <QColor>
+#include <QHash>
 #include <QList>
 #include <QMargins>
+#include <QSet>
 #include <QSharedPointer>
 #include <QSize>
 #include <QVector>
@@ -241,6 +243,9 @@ public:
     QList<MapObject*> replaceObjectTemplate(const ObjectTemplate *oldObjectTemplate,
                                             const ObjectTemplate *newObjectTemplate);
 
+    QList<MapObject*> templateInstances(const ObjectTemplate *objectTemplate) const;
+    QList<const ObjectTemplate*> usedTemplates() const;
+
     const QColor &backgroundColor() const;
     void setBackgroundColor(QColor color);
 
@@ -272,11 +277,24 @@ public:
 
 private:
     friend class GroupLayer;    // so it can call adoptLayer
+    friend class Layer;         // so it can invalidate the ID indexes
+    friend class MapObject;
+    friend class ObjectGroup;
 
     void adoptLayer(Layer &layer);
 
     void recomputeDrawMargins() const;
 
+    void objectAdded(MapObject *object);
+    void objectRemoved(MapObject *object);
+    void objectTemplateChanged(MapObject *object,
+                               const ObjectTemplate *oldObjectTemplate);
+    void invalidateObjectIndex();
+    void invalidateLayerIndex();
+    void invalidateTemplateIndex();
+    void rebuildObjectIndex() const;
+    void rebuildTemplateIndex() const;
+
     Orientation mOrientation = Orthogonal;
     RenderOrder mRenderOrder = RightDown;
     int mCompressionLevel = -1;
@@ -297,6 +315,17 @@ private:
     LayerDataFormat mLayerDataFormat = Base64Zlib;
     int mNextLayerId = 1;
     int mNextObjectId = 1;
+
+    // Indexes for looking up layers and objects by their ID, built on demand
+    mutable QHash<int, Layer*> mLayersById;
+    mutable QHash<int, MapObject*> mObjectsById;
+    mutable bool mLayerIndexDirty = true;
+    mutable bool mObjectIndexDirty = true;
+    mutable bool mHasDuplicateObjectIds = false;
+
+    // Index of the objects instantiating each template, built on demand
+    mutable QHash<const ObjectTemplate*, QSet<MapObject*>> mTemplateInstances;
+    mutable bool mTemplateIndexDirty = true;
 };
 
 
@@ -215,6 +215,32 @@ QRectF MapObject::screenBounds(const MapRenderer &renderer) const
     return QRectF();
 }
 
+/**
+ * Sets the id of this object.
+ */
+void MapObject::setId(int id)
+{
+    Map *map = this->map();
+
+    if (map)
+        map->objectRemoved(this);
+
+    mId = id;
+
+    if (map)
+        map->objectAdded(this);
+}
+
+void MapObject::setObjectTemplate(const ObjectTemplate *objectTemplate)
+{
+    const ObjectTemplate *oldObjectTemplate = mObjectTemplate;
+    mObjectTemplate = objectTemplate;
+
+    if (oldObjectTemplate != objectTemplate)
+        if (Map *map = this->map())
+            map->objectTemplateChanged(this, oldObjectTemplate);
+}
+
 Map *MapObject::map() const
 {
     return mObjectGroup ? mObjectGroup->map() : nullptr;
@@ -247,12 +247,6 @@ private:
 inline int MapObject::id() const
 { return mId; }
 
-/**
- * Sets the id of this object.
- */
-inline void MapObject::setId(int id)
-{ mId = id; }
-
 /**
  * Sets the id back to 0. Mostly used when a new id should be assigned
  * after the object has been cloned.
@@ -452,9 +446,6 @@ inline void MapObject::setCell(const Cell &cell)
 inline const ObjectTemplate *MapObject::objectTemplate() const
 { return mObjectTemplate; }
 
-inline void MapObject::setObjectTemplate(const ObjectTemplate *objectTemplate)
-{ mObjectTemplate = objectTemplate; }
-
 /**
  * Returns the object group this object belongs to.
  */
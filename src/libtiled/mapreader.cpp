@@ -33,18 +33,23 @@
 #include "compression.h"
 #include "gidmapper.h"
 #include "grouplayer.h"
+#include "imagecache.h"
 #include "imagelayer.h"
+#include "layerdatadecoding.h"
 #include "objectgroup.h"
 #include "objecttemplate.h"
 #include "map.h"
 #include "mapobject.h"
 #include "templatemanager.h"
 #include "tile.h"
+#include "tiled.h"
 #include "tilelayer.h"
 #include "tilesetmanager.h"
 #include "terrain.h"
 #include "wangset.h"
 
+#include "qtcompat_p.h"
+
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
@@ -89,6 +94,7 @@ private:
     SharedTileset readTileset();
     void readTilesetEditorSettings(Tileset &tileset);
     void readTilesetTile(Tileset &tileset);
+    void createTileImages(Tileset &tileset);
     void readTilesetGrid(Tileset &tileset);
     void readTilesetImage(Tileset &tileset);
     void readTilesetTerrainTypes(Tileset &tileset);
@@ -106,7 +112,7 @@ private:
                            QStringRef encoding,
                            QRect bounds);
     void decodeBinaryLayerData(TileLayer &tileLayer,
-                               const QByteArray &data,
+                               QStringRef data,
                                Map::LayerDataFormat format,
                                QRect bounds);
     void decodeCSVLayerData(TileLayer &tileLayer,
@@ -146,9 +152,41 @@ private:
     GidMapper mGidMapper;
     bool mReadingExternalTileset;
 
+    // Tile images are created once the whole tileset was read, so that
+    // they can be decoded in parallel
+    QVector<QPair<Tile*, ImageReference>> mTileImages;
+
+    // Images that started decoding in the background during this read
+    QStringList mPreloadedFiles;
+
     QXmlStreamReader xml;
 };
 
+/**
+ * Cancels the background decoding of the images preloaded while reading a
+ * file, unless the file was read successfully.
+ */
+class PendingImagesGuard
+{
+public:
+    explicit PendingImagesGuard(QStringList &preloadedFiles)
+        : mPreloadedFiles(preloadedFiles)
+    {}
+
+    ~PendingImagesGuard()
+    {
+        if (!mSucceeded)
+            ImageCache::cancelPending(mPreloadedFiles);
+        mPreloadedFiles.clear();
+    }
+
+    void setSucceeded(bool succeeded) { mSucceeded = succeeded; }
+
+private:
+    QStringList &mPreloadedFiles;
+    bool mSucceeded = false;
+};
+
 } // namespace Internal
 } // namespace Tiled
 
@@ -157,6 +195,7 @@ std::unique_ptr<Map> MapReaderPrivate::readMap(QIODevice *device, const QString
     mError.clear();
     mPath.setPath(path);
     std::unique_ptr<Map> map;
+    PendingImagesGuard pendingImagesGuard(mPreloadedFiles);
 
     xml.setDevice(device);
 
@@ -167,6 +206,7 @@ std::unique_ptr<Map> MapReaderPrivate::readMap(QIODevice *device, const QString
     }
 
     mGidMapper.clear();
+    pendingImagesGuard.setSucceeded(map != nullptr);
     return map;
 }
 
@@ -175,6 +215,7 @@ SharedTileset MapReaderPrivate::readTileset(QIODevice *device, const QString &pa
     mError.clear();
     mPath.setPath(path);
     SharedTileset tileset;
+    PendingImagesGuard pendingImagesGuard(mPreloadedFiles);
     mReadingExternalTileset = true;
 
     xml.setDevice(device);
@@ -185,6 +226,7 @@ SharedTileset MapReaderPrivate::readTileset(QIODevice *device, const QString &pa
         xml.raiseError(tr("Not a tileset file."));
 
     mReadingExternalTileset = false;
+    pendingImagesGuard.setSucceeded(!xml.hasError());
     return tileset;
 }
 
@@ -427,6 +469,11 @@ SharedTileset MapReaderPrivate::readTileset()
                     readUnknownElement();
                 }
             }
+
+            if (tileset)
+                createTileImages(*tileset);
+            else
+                mTileImages.clear();
         }
     } else { // External tileset
         const QString absoluteSource = p->resolveReference(source, mPath);
@@ -506,12 +553,13 @@ void MapReaderPrivate::readTilesetTile(Tileset &tileset)
         } else if (xml.name() == QLatin1String("image")) {
             ImageReference imageReference = readImage();
             if (imageReference.hasImage()) {
-                QPixmap image = imageReference.create();
-                if (image.isNull()) {
-                    if (imageReference.source.isEmpty())
-                        xml.raiseError(tr("Error reading embedded image for tile %1").arg(id));
+                if (imageReference.source.isLocalFile()) {
+                    const QString fileName = imageReference.source.toLocalFile();
+                    ImageCache::preloadImage(fileName);
+                    mPreloadedFiles.append(fileName);
                 }
-                tileset.setTileImage(tile, image, imageReference.source);
+
+                mTileImages.append(qMakePair(tile, imageReference));
             }
         } else if (xml.name() == QLatin1String("objectgroup")) {
             std::unique_ptr<ObjectGroup> objectGroup = readObjectGroup();
@@ -558,6 +606,23 @@ void MapReaderPrivate::readTilesetTile(Tileset &tileset)
     }
 }
 
+void MapReaderPrivate::createTileImages(Tileset &tileset)
+{
+    for (const auto &tileImage : qAsConst(mTileImages)) {
+        Tile *tile = tileImage.first;
+        const ImageReference &imageReference = tileImage.second;
+
+        QPixmap image = imageReference.create();
+        if (image.isNull()) {
+            if (imageReference.source.isEmpty())
+                xml.raiseError(tr("Error reading embedded image for tile %1").arg(tile->id()));
+        }
+        tileset.setTileImage(tile, image, imageReference.source);
+    }
+
+    mTileImages.clear();
+}
+
 void MapReaderPrivate::readTilesetGrid(Tileset &tileset)
 {
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("grid"));
@@ -582,6 +647,8 @@ void MapReaderPrivate::readTilesetImage(Tileset &tileset)
     Q_ASSERT(xml.isStartElement() && xml.name() == QLatin1String("image"));
 
     tileset.setImageReference(readImage());
+    tileset.preloadImage();
+    mPreloadedFiles.append(urlToLocalFileOrQrc(tileset.imageSource()));
 }
 
 ImageReference MapReaderPrivate::readImage()
@@ -902,7 +969,7 @@ void MapReaderPrivate::readTileLayerRect(TileLayer &tileLayer,
         } else if (xml.isCharacters() && !xml.isWhitespace()) {
             if (encoding == QLatin1String("base64")) {
                 decodeBinaryLayerData(tileLayer,
-                                      xml.text().toLatin1(),
+                                      xml.text(),
                                       layerDataFormat,
                                       bounds);
             } else if (encoding == QLatin1String("csv")) {
@@ -913,7 +980,7 @@ void MapReaderPrivate::readTileLayerRect(TileLayer &tileLayer,
 }
 
 void MapReaderPrivate::decodeBinaryLayerData(TileLayer &tileLayer,
-                                             const QByteArray &data,
+                                             QStringRef data,
                                              Map::LayerDataFormat format,
                                              QRect bounds)
 {
@@ -940,41 +1007,40 @@ void MapReaderPrivate::decodeCSVLayerData(TileLayer &tileLayer,
                                           QStringRef text,
                                           QRect bounds)
 {
-    int currentIndex = 0;
+    CsvGidParser parser(reinterpret_cast<const unsigned short*>(text.unicode()),
+                        text.length());
+
+    QVector<unsigned> gids(bounds.width());
+    QVector<Cell> row(bounds.width());
 
     for (int y = bounds.top(); y <= bounds.bottom(); y++) {
-        for (int x = bounds.left(); x <= bounds.right(); x++) {
-            // Check if the stream ended early.
-            if (currentIndex >= text.length()) {
-                xml.raiseError(tr("Corrupt layer data for layer '%1'")
-                               .arg(tileLayer.name()));
-                return;
-            }
+        const int count = parser.read(gids.data(), gids.size());
 
-            // Get the next entry.
-            unsigned int gid = 0;
-            while (currentIndex < text.length()) {
-                auto currentChar = text.at(currentIndex);
-                currentIndex++;
-                if (currentChar == QLatin1Char(','))
-                    break;
-                if (currentChar.isSpace())
-                    continue;
-                int value = currentChar.digitValue();
-                if (value != -1)
-                    gid = gid * 10 + value;
-                else {
-                    xml.raiseError(
-                            tr("Unable to parse tile at (%1,%2) on layer '%3': \"%4\"")
-                                   .arg(x + 1).arg(y + 1).arg(tileLayer.name()).arg(currentChar));
-                    return;
-                }
-            }
+        switch (parser.error()) {
+        case CsvGidParser::NoError:
+            break;
+        case CsvGidParser::UnexpectedEnd:
+            xml.raiseError(tr("Corrupt layer data for layer '%1'")
+                           .arg(tileLayer.name()));
+            return;
+        case CsvGidParser::InvalidCharacter:
+            xml.raiseError(
+                    tr("Unable to parse tile at (%1,%2) on layer '%3': \"%4\"")
+                           .arg(bounds.left() + count + 1).arg(y + 1).arg(tileLayer.name())
+                           .arg(QChar(parser.errorCharacter())));
+            return;
+        }
 
-            tileLayer.setCell(x, y, cellForGid(gid));
+        for (int i = 0; i < count; ++i) {
+            row[i] = cellForGid(gids.at(i));
+            if (xml.hasError())
+                return;
         }
+
+        tileLayer.setCellRow(bounds.left(), y, row.constData(), row.size());
     }
-    if (currentIndex < text.length()) {
+
+    if (!parser.atEnd()) {
         // We didn't consume all the data.
         xml.raiseError(tr("Corrupt layer data for layer '%1'")
                        .arg(tileLayer.name()));
@@ -48,9 +48,14 @@
 
 using namespace Tiled;
 
+static bool isTintColor(const QColor &color)
+{
+    return color.isValid() && color != QColor(255, 255, 255, 255);
+}
+
 static QPixmap tinted(const QPixmap &pixmap, const QColor &color)
 {
-    if (!color.isValid() || color == QColor(255, 255, 255, 255))
+    if (!isTintColor(color))
         return pixmap;
 
     QPixmap resultImage = pixmap;
@@ -256,7 +261,15 @@ CellRenderer::CellRenderer(QPainter *painter, const MapRenderer *renderer, const
     : mPainter(painter)
     , mRenderer(renderer)
     , mTile(nullptr)
+    , mAtlasTileset(nullptr)
     , mIsOpenGL(hasOpenGLEngine(painter))
+    // Tinting the whole atlas for each batch would be wasteful, collision
+    // shapes are painted per tile and smooth scaling would bleed pixels of
+    // neighboring tiles into the drawn ones.
+    , mUseAtlas(renderer->testFlag(UseTileAtlas)
+                && !renderer->testFlag(ShowTileCollisionShapes)
+                && !isTintColor(tintColor)
+                && !painter->testRenderHint(QPainter::SmoothPixmapTransform))
     , mCellType(cellType)
     , mTintColor(tintColor)
 {
@@ -271,6 +284,10 @@ CellRenderer::CellRenderer(QPainter *painter, const MapRenderer *renderer, const
  * flush when finished doing drawCell calls. This function is also called by
  * the destructor so usually an explicit call is not needed.
  *
+ * When the UseTileAtlas flag is set, tiles are drawn from the atlas image of
+ * their tileset, so that consecutive tiles from the same tileset end up in
+ * the same batch.
+ *
  * This call expects `painter.translate(pos)` to correspond to the Origin point.
  */
 void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &size, Origin origin)
@@ -290,13 +307,20 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
         return;
     }
 
+    const Tileset *atlasTileset = nullptr;
+    if (mUseAtlas && !tile->imageRect().isNull() && !tile->tileset()->atlasImage().isNull())
+        atlasTileset = tile->tileset();
+
+    const bool sameBatch = mTile == tile || (atlasTileset && atlasTileset == mAtlasTileset);
+
     // The USHRT_MAX limit is rather arbitrary but avoids a crash in
     // drawPixmapFragments for a large number of fragments.
-    if (mTile != tile || mFragments.size() == USHRT_MAX)
+    if (!sameBatch || mFragments.size() == USHRT_MAX)
         flush();
 
-    const QPixmap &image = tile->image();
-    const QSizeF imageSize = image.size();
+    const QPixmap &image = atlasTileset ? atlasTileset->atlasImage() : tile->image();
+    const QRect sourceRect = atlasTileset ? tile->imageRect() : image.rect();
+    const QSizeF imageSize = sourceRect.size();
     if (imageSize.isEmpty())
         return;
 
@@ -311,8 +335,8 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
     // Calculate the position as if the origin is TopLeft, and correct it later.
     fragment.x = pos.x() + (offset.x() * scale.width()) + sizeHalf.x();
     fragment.y = pos.y() + (offset.y() * scale.height()) + sizeHalf.y();
-    fragment.sourceLeft = 0;
-    fragment.sourceTop = 0;
+    fragment.sourceLeft = sourceRect.x();
+    fragment.sourceTop = sourceRect.y();
     fragment.width = imageSize.width();
     fragment.height = imageSize.height();
     fragment.scaleX = flippedHorizontally ? -1 : 1;
@@ -350,6 +374,7 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
 
     if (mIsOpenGL || (fragment.scaleX > 0 && fragment.scaleY > 0)) {
         mTile = tile;
+        mAtlasTileset = atlasTileset;
         mFragments.append(fragment);
         return;
     }
@@ -367,7 +392,8 @@ void CellRenderer::render(const Cell &cell, const QPointF &pos, const QSizeF &si
 
     const QRectF target(fragment.width * -0.5, fragment.height * -0.5,
                         fragment.width, fragment.height);
-    const QRectF source(0, 0, fragment.width, fragment.height);
+    const QRectF source(fragment.sourceLeft, fragment.sourceTop,
+                        fragment.width, fragment.height);
 
     mPainter->setTransform(transform);
     mPainter->drawPixmap(target, tinted(image, mTintColor), source);
@@ -393,17 +419,25 @@ void CellRenderer::flush()
     if (!mTile)
         return;
 
-    mPainter->drawPixmapFragments(mFragments.constData(),
-                                  mFragments.size(),
-                                  tinted(mTile->image(), mTintColor));
-
-    if (mRenderer->flags().testFlag(ShowTileCollisionShapes)
-            && mTile->objectGroup()
-            && !mTile->objectGroup()->objects().isEmpty()) {
-        paintTileCollisionShapes();
+    if (mAtlasTileset) {
+        // Atlas batches are never tinted and never show collision shapes
+        mPainter->drawPixmapFragments(mFragments.constData(),
+                                      mFragments.size(),
+                                      mAtlasTileset->atlasImage());
+    } else {
+        mPainter->drawPixmapFragments(mFragments.constData(),
+                                      mFragments.size(),
+                                      tinted(mTile->image(), mTintColor));
+
+        if (mRenderer->flags().testFlag(ShowTileCollisionShapes)
+                && mTile->objectGroup()
+                && !mTile->objectGroup()->objects().isEmpty()) {
+            paintTileCollisionShapes();
+        }
     }
 
     mTile = nullptr;
+    mAtlasTileset = nullptr;
     mFragments.resize(0);
 }
 
@@ -43,11 +43,13 @@ class Map;
 class MapObject;
 class Tile;
 class TileLayer;
+class Tileset;
 class ImageLayer;
 
 enum RenderFlag {
     ShowTileObjectOutlines = 0x1,
-    ShowTileCollisionShapes = 0x2
+    ShowTileCollisionShapes = 0x2,
+    UseTileAtlas = 0x4
 };
 
 Q_DECLARE_FLAGS(RenderFlags, RenderFlag)
@@ -328,8 +330,10 @@ private:
     QPainter * const mPainter;
     const MapRenderer * const mRenderer;
     const Tile *mTile;
+    const Tileset *mAtlasTileset;
     QVector<QPainter::PixmapFragment> mFragments;
     const bool mIsOpenGL;
+    const bool mUseAtlas;
     const CellType mCellType;
     const QColor mTintColor;
 };
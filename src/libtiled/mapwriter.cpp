@@ -49,6 +49,11 @@
 #include <QBuffer>
 #include <QCoreApplication>
 #include <QDir>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include <QXmlStreamWriter>
 
 using namespace Tiled;
@@ -79,6 +84,8 @@ public:
     bool mDtdEnabled { false };
     bool mMinimize { false };
     QSize mChunkSize { CHUNK_SIZE, CHUNK_SIZE };
+    int mThreadCount { QThread::idealThreadCount() };
+    QHash<const Tileset*, const Tileset*> mTilesetAliases;
 
 private:
     void writeMap(QXmlStreamWriter &w, const Map &map);
@@ -87,6 +94,9 @@ private:
     void writeLayers(QXmlStreamWriter &w, const QList<Layer *> &layers);
     void writeTileLayer(QXmlStreamWriter &w, const TileLayer &tileLayer);
     void writeTileLayerData(QXmlStreamWriter &w, const TileLayer &tileLayer, QRect bounds);
+    void writeChunks(QXmlStreamWriter &w, const TileLayer &tileLayer,
+                     const QVector<QRect> &chunks);
+    QString encodeTileLayerData(const TileLayer &tileLayer, QRect bounds) const;
     void writeLayerAttributes(QXmlStreamWriter &w, const Layer &layer);
     void writeObjectGroup(QXmlStreamWriter &w, const ObjectGroup &objectGroup);
     void writeObject(QXmlStreamWriter &w, const MapObject &mapObject);
@@ -101,6 +111,77 @@ private:
     bool mUseAbsolutePaths { false };
 };
 
+/**
+ * Shared state between the thread writing the chunks of a tile layer and the
+ * threads encoding them.
+ */
+class ChunkEncodingQueue
+{
+public:
+    ChunkEncodingQueue(const MapWriterPrivate &writer,
+                       const TileLayer &tileLayer,
+                       const QVector<QRect> &chunks)
+        : mWriter(writer)
+        , mTileLayer(tileLayer)
+        , mChunks(chunks)
+        , mEncoded(chunks.size())
+        , mDone(chunks.size(), false)
+    {}
+
+    /**
+     * Encodes chunks until none are left.
+     */
+    void encodeChunks()
+    {
+        int index;
+        while ((index = mNext.fetchAndAddRelaxed(1)) < mChunks.size()) {
+            QString data = mWriter.encodeTileLayerData(mTileLayer, mChunks.at(index));
+
+            QMutexLocker locker(&mMutex);
+            mEncoded[index].swap(data);
+            mDone[index] = true;
+            mChunkEncoded.wakeAll();
+        }
+    }
+
+    /**
+     * Waits until the chunk at \a index was encoded and takes its data.
+     */
+    QString takeEncodedChunk(int index)
+    {
+        QMutexLocker locker(&mMutex);
+        while (!mDone.at(index))
+            mChunkEncoded.wait(&mMutex);
+
+        QString data;
+        data.swap(mEncoded[index]);
+        return data;
+    }
+
+private:
+    const MapWriterPrivate &mWriter;
+    const TileLayer &mTileLayer;
+    const QVector<QRect> &mChunks;
+    QVector<QString> mEncoded;
+    QVector<bool> mDone;
+    QAtomicInt mNext { 0 };
+    QMutex mMutex;
+    QWaitCondition mChunkEncoded;
+};
+
+class ChunkEncoder : public QRunnable
+{
+public:
+    explicit ChunkEncoder(ChunkEncodingQueue &queue)
+        : mQueue(queue)
+    {}
+
+    void run() override { mQueue.encodeChunks(); }
+
+private:
+    ChunkEncodingQueue &mQueue;
+};
+
 } // namespace Internal
 } // namespace Tiled
 
@@ -264,6 +345,9 @@ void MapWriterPrivate::writeMap(QXmlStreamWriter &w, const Map &map)
         firstGid += tileset->nextTileId();
     }
 
+    for (auto it = mTilesetAliases.cbegin(); it != mTilesetAliases.cend(); ++it)
+        mGidMapper.insertAlias(it.key(), it.value());
+
     writeLayers(w, map.layers());
 
     w.writeEndElement();
@@ -613,18 +697,7 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
         w.writeAttribute(QStringLiteral("compression"), compression);
 
     if (tileLayer.map()->infinite()) {
-        const auto chunks = tileLayer.sortedChunksToWrite(mChunkSize);
-        for (const QRect &rect : chunks) {
-            w.writeStartElement(QStringLiteral("chunk"));
-            w.writeAttribute(QStringLiteral("x"), QString::number(rect.x()));
-            w.writeAttribute(QStringLiteral("y"), QString::number(rect.y()));
-            w.writeAttribute(QStringLiteral("width"), QString::number(rect.width()));
-            w.writeAttribute(QStringLiteral("height"), QString::number(rect.height()));
-
-            writeTileLayerData(w, tileLayer, rect);
-
-            w.writeEndElement(); // </chunk>
-        }
+        writeChunks(w, tileLayer, tileLayer.sortedChunksToWrite(mChunkSize));
     } else {
         writeTileLayerData(w, tileLayer,
                            QRect(0, 0, tileLayer.width(), tileLayer.height()));
@@ -634,6 +707,45 @@ void MapWriterPrivate::writeTileLayer(QXmlStreamWriter &w,
     w.writeEndElement(); // </layer>
 }
 
+/**
+ * Writes the given \a chunks of the tile layer. Unless the layer data format
+ * is XML, the chunks are encoded in parallel and written in order as soon as
+ * they are available.
+ */
+void MapWriterPrivate::writeChunks(QXmlStreamWriter &w,
+                                   const TileLayer &tileLayer,
+                                   const QVector<QRect> &chunks)
+{
+    const int threadCount = qMin(mThreadCount, chunks.size());
+    const bool parallel = threadCount > 1 && mLayerDataFormat != Map::XML;
+
+    ChunkEncodingQueue queue(*this, tileLayer, chunks);
+    QThreadPool threadPool;
+
+    if (parallel) {
+        threadPool.setMaxThreadCount(threadCount);
+        for (int i = 0; i < threadCount; ++i)
+            threadPool.start(new ChunkEncoder(queue));
+    }
+
+    for (int i = 0; i < chunks.size(); ++i) {
+        const QRect &rect = chunks.at(i);
+
+        w.writeStartElement(QStringLiteral("chunk"));
+        w.writeAttribute(QStringLiteral("x"), QString::number(rect.x()));
+        w.writeAttribute(QStringLiteral("y"), QString::number(rect.y()));
+        w.writeAttribute(QStringLiteral("width"), QString::number(rect.width()));
+        w.writeAttribute(QStringLiteral("height"), QString::number(rect.height()));
+
+        if (parallel)
+            w.writeCharacters(queue.takeEncodedChunk(i));
+        else
+            writeTileLayerData(w, tileLayer, rect);
+
+        w.writeEndElement(); // </chunk>
+    }
+}
+
 void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
                                           const TileLayer &tileLayer,
                                           QRect bounds)
@@ -648,9 +760,25 @@ void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
                 w.writeEndElement();
             }
         }
-    } else if (mLayerDataFormat == Map::CSV) {
-        QString chunkData;
+    } else {
+        w.writeCharacters(encodeTileLayerData(tileLayer, bounds));
+    }
+}
+
+/**
+ * Returns the CSV or Base64 encoded layer data within the given \a bounds.
+ *
+ * Only reads from the writer and the layer, so it may be called from
+ * multiple threads at once.
+ */
+QString MapWriterPrivate::encodeTileLayerData(const TileLayer &tileLayer,
+                                              QRect bounds) const
+{
+    Q_ASSERT(mLayerDataFormat != Map::XML);
 
+    QString chunkData;
+
+    if (mLayerDataFormat == Map::CSV) {
         if (!mMinimize)
             chunkData.append(QLatin1Char('\n'));
 
@@ -664,22 +792,22 @@ void MapWriterPrivate::writeTileLayerData(QXmlStreamWriter &w,
             if (!mMinimize)
                 chunkData.append(QLatin1Char('\n'));
         }
-
-        w.writeCharacters(chunkData);
     } else {
-        QByteArray chunkData = mGidMapper.encodeLayerData(tileLayer,
-                                                          mLayerDataFormat,
-                                                          bounds,
-                                                          mCompressionlevel);
+        const QByteArray encoded = mGidMapper.encodeLayerData(tileLayer,
+                                                              mLayerDataFormat,
+                                                              bounds,
+                                                              mCompressionlevel);
 
         if (!mMinimize)
-            w.writeCharacters(QLatin1String("\n   "));
+            chunkData.append(QLatin1String("\n   "));
 
-        w.writeCharacters(QString::fromLatin1(chunkData));
+        chunkData.append(QLatin1String(encoded));
 
         if (!mMinimize)
-            w.writeCharacters(QLatin1String("\n  "));
+            chunkData.append(QLatin1String("\n  "));
     }
+
+    return chunkData;
 }
 
 void MapWriterPrivate::writeLayerAttributes(QXmlStreamWriter &w,
@@ -1094,3 +1222,18 @@ bool MapWriter::minimizeOutput() const
 {
     return d->mMinimize;
 }
+
+void MapWriter::setThreadCount(int threadCount)
+{
+    d->mThreadCount = qMax(1, threadCount);
+}
+
+int MapWriter::threadCount() const
+{
+    return d->mThreadCount;
+}
+
+void MapWriter::setTilesetAliases(const QHash<const Tileset*, const Tileset*> &aliases)
+{
+    d->mTilesetAliases = aliases;
+}
@@ -32,6 +32,7 @@
 #include "map.h"
 #include "tiled_global.h"
 
+#include <QHash>
 #include <QString>
 
 #include <memory>
@@ -118,6 +119,24 @@ public:
     void setMinimizeOutput(bool enabled);
     bool minimizeOutput() const;
 
+    /**
+     * Sets the number of threads used to encode the chunks of infinite
+     * maps. Defaults to QThread::idealThreadCount(). A value of 1 encodes
+     * all chunks on the calling thread.
+     */
+    void setThreadCount(int threadCount);
+    int threadCount() const;
+
+    /**
+     * Sets tilesets to write in place of the ones the cells of the map refer
+     * to. Each key is a tileset referred to by cells, and its value is the
+     * tileset in the map that should be used instead.
+     *
+     * Used for writing a snapshot of a map, of which the tilesets were copied
+     * without also updating all the cells.
+     */
+    void setTilesetAliases(const QHash<const Tileset*, const Tileset*> &aliases);
+
 private:
     Q_DISABLE_COPY(MapWriter)
 
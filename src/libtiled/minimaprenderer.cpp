@@ -67,6 +67,7 @@ MiniMapRenderer::MiniMapRenderer(const Map *map)
     }
 
     mRenderer->setFlag(ShowTileObjectOutlines, false);
+    mRenderer->setFlag(UseTileAtlas);
 }
 
 MiniMapRenderer::~MiniMapRenderer()
@@ -149,18 +150,59 @@ static void extendMapRect(QRect &mapBoundingRect, const MapRenderer &renderer)
 
 void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags) const
 {
-    if (!mMap)
-        return;
-    if (image.isNull())
-        return;
+    renderToImage(image, renderFlags, nullptr);
+}
 
-    const bool drawObjects = renderFlags.testFlag(RenderFlag::DrawMapObjects);
-    const bool drawTileLayers = renderFlags.testFlag(RenderFlag::DrawTileLayers);
-    const bool drawImageLayers = renderFlags.testFlag(RenderFlag::DrawImageLayers);
-    const bool drawTileGrid = renderFlags.testFlag(RenderFlag::DrawGrid);
-    const bool visibleLayersOnly = renderFlags.testFlag(RenderFlag::IgnoreInvisibleLayer);
+/**
+ * Renders only the parts of the map within \a mapRegion, leaving the rest of
+ * the \a image untouched. The region is given in pixel coordinates of the
+ * map, in which layer offsets are already applied.
+ *
+ * Should be called with the same image size and flags as used for
+ * rendering the whole map, since otherwise the parts won't line up.
+ */
+void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags,
+                                    const QRegion &mapRegion) const
+{
+    // The map bounds depend on all tiles in this case
+    if (renderFlags.testFlag(IncludeOverhangingTiles))
+        renderToImage(image, renderFlags, nullptr);
+    else if (!mapRegion.isEmpty())
+        renderToImage(image, renderFlags, &mapRegion);
+}
 
-    QRect mapBoundingRect = mRenderer->mapBoundingRect();
+/**
+ * Returns the whole pixels of the image covering the given \a mapRegion.
+ */
+static QRegion imageRegion(const QTransform &transform, const QRegion &mapRegion)
+{
+    QRegion region;
+#if QT_VERSION < 0x050800
+    const auto rects = mapRegion.rects();
+    for (const QRect &rect : rects)
+#else
+    for (const QRect &rect : mapRegion)
+#endif
+        region |= transform.mapRect(QRectF(rect)).toAlignedRect().adjusted(-1, -1, 1, 1);
+    return region;
+}
+
+static QColor backgroundColor(const Map &map, MiniMapRenderer::RenderFlags renderFlags)
+{
+    if (renderFlags.testFlag(MiniMapRenderer::DrawBackground) && map.backgroundColor().isValid())
+        return map.backgroundColor();
+    return Qt::transparent;
+}
+
+/**
+ * Returns the transform from map pixel coordinates to the pixels of a
+ * minimap image of the given \a imageSize. Also returns the bounding rect of
+ * the map and the scale at which it is rendered.
+ */
+QTransform MiniMapRenderer::imageTransform(QSize imageSize, RenderFlags renderFlags,
+                                           QRect &mapBoundingRect, qreal &scale) const
+{
+    mapBoundingRect = mRenderer->mapBoundingRect();
 
     if (renderFlags.testFlag(IncludeOverhangingTiles))
         extendMapRect(mapBoundingRect, *mRenderer);
@@ -171,26 +213,76 @@ void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags) cons
     mapSize.setHeight(mapSize.height() + margins.top() + margins.bottom());
 
     // Determine the largest possible scale
-    const qreal scale = qMin(static_cast<qreal>(image.width()) / mapSize.width(),
-                             static_cast<qreal>(image.height()) / mapSize.height());
-
-    if (renderFlags.testFlag(DrawBackground) && mMap->backgroundColor().isValid())
-        image.fill(mMap->backgroundColor());
-    else
-        image.fill(Qt::transparent);
-
-    QPainter painter(&image);
-    painter.setRenderHints(QPainter::SmoothPixmapTransform, renderFlags.testFlag(SmoothPixmapTransform));
+    scale = qMin(static_cast<qreal>(imageSize.width()) / mapSize.width(),
+                 static_cast<qreal>(imageSize.height()) / mapSize.height());
 
     // Center the map in the requested size
     const QSize scaledMapSize = mapSize * scale;
-    const QPointF centerOffset((image.width() - scaledMapSize.width()) / 2,
-                               (image.height() - scaledMapSize.height()) / 2);
+    const QPointF centerOffset((imageSize.width() - scaledMapSize.width()) / 2,
+                               (imageSize.height() - scaledMapSize.height()) / 2);
+
+    QTransform transform;
+    transform.translate(centerOffset.x(), centerOffset.y());
+    transform.scale(scale, scale);
+    transform.translate(margins.left(), margins.top());
+    transform.translate(-mapBoundingRect.left(), -mapBoundingRect.top());
+    return transform;
+}
 
-    painter.translate(centerOffset);
-    painter.scale(scale, scale);
-    painter.translate(margins.left(), margins.top());
-    painter.translate(-mapBoundingRect.topLeft());
+void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags,
+                                    const QRegion *mapRegion) const
+{
+    if (!mMap)
+        return;
+    if (image.isNull())
+        return;
+
+    QRect mapBoundingRect;
+    qreal scale;
+    const QTransform transform = imageTransform(image.size(), renderFlags,
+                                                mapBoundingRect, scale);
+    const QColor background = backgroundColor(*mMap, renderFlags);
+
+    QPainter painter;
+    QRectF exposed;
+
+    if (mapRegion) {
+        const QRegion region = imageRegion(transform, *mapRegion) & image.rect();
+        if (region.isEmpty())
+            return;
+
+        painter.begin(&image);
+        painter.setClipRegion(region);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(region.boundingRect(), background);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+        exposed = transform.inverted().mapRect(QRectF(region.boundingRect()));
+    } else {
+        image.fill(background);
+        painter.begin(&image);
+    }
+
+    painter.setTransform(transform);
+    paint(painter, renderFlags, mapBoundingRect, scale, exposed);
+}
+
+/**
+ * Draws the map using the given \a painter, which has been set up with the
+ * transform returned by imageTransform(). Only the parts of the map within
+ * \a exposed are drawn, unless it is null.
+ */
+void MiniMapRenderer::paint(QPainter &painter, RenderFlags renderFlags,
+                            const QRect &mapBoundingRect, qreal scale,
+                            const QRectF &exposed) const
+{
+    const bool drawObjects = renderFlags.testFlag(RenderFlag::DrawMapObjects);
+    const bool drawTileLayers = renderFlags.testFlag(RenderFlag::DrawTileLayers);
+    const bool drawImageLayers = renderFlags.testFlag(RenderFlag::DrawImageLayers);
+    const bool drawTileGrid = renderFlags.testFlag(RenderFlag::DrawGrid);
+    const bool visibleLayersOnly = renderFlags.testFlag(RenderFlag::IgnoreInvisibleLayer);
+
+    painter.setRenderHints(QPainter::SmoothPixmapTransform, renderFlags.testFlag(SmoothPixmapTransform));
 
     mRenderer->setPainterScale(scale);
 
@@ -208,7 +300,8 @@ void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags) cons
         case Layer::TileLayerType: {
             if (drawTileLayers) {
                 const TileLayer *tileLayer = static_cast<const TileLayer*>(layer);
-                mRenderer->drawTileLayer(&painter, tileLayer);
+                mRenderer->drawTileLayer(&painter, tileLayer,
+                                         exposed.isNull() ? exposed : exposed.translated(-offset));
             }
             break;
         }
@@ -221,8 +314,19 @@ void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags) cons
                 if (objectGroup->drawOrder() == ObjectGroup::TopDownOrder)
                     std::stable_sort(objects.begin(), objects.end(), objectLessThan);
 
+                // Allow for object outlines extending beyond their bounds
+                const qreal margin = 4 / scale;
+                QRectF objectsExposed;
+                if (!exposed.isNull())
+                    objectsExposed = exposed.translated(-offset).adjusted(-margin, -margin, margin, margin);
+
                 for (const MapObject *object : qAsConst(objects)) {
                     if (object->isVisible()) {
+                        if (!objectsExposed.isNull() && object->rotation() == qreal(0) &&
+                                !mRenderer->boundingRect(object).intersects(objectsExposed)) {
+                            continue;
+                        }
+
                         if (object->rotation() != qreal(0)) {
                             QPointF origin = mRenderer->pixelToScreenCoords(object->position());
                             painter.save();
@@ -258,7 +362,7 @@ void MiniMapRenderer::renderToImage(QImage &image, RenderFlags renderFlags) cons
     }
 
     if (drawTileGrid)
-        mRenderer->drawGrid(&painter, mapBoundingRect, mGridColor);
+        mRenderer->drawGrid(&painter, exposed.isNull() ? QRectF(mapBoundingRect) : exposed, mGridColor);
 
     if (drawObjects && mRenderObjectLabelCallback) {
         for (const Layer *layer : mMap->objectGroups()) {
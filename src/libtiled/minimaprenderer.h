@@ -33,6 +33,8 @@
 #include "tiled_global.h"
 
 #include <QImage>
+#include <QRegion>
+#include <QTransform>
 
 #include <functional>
 
@@ -71,8 +73,19 @@ public:
     QImage render(QSize size, RenderFlags renderFlags) const;
 
     void renderToImage(QImage &image, RenderFlags renderFlags) const;
+    void renderToImage(QImage &image, RenderFlags renderFlags,
+                       const QRegion &mapRegion) const;
 
 private:
+    QTransform imageTransform(QSize imageSize, RenderFlags renderFlags,
+                              QRect &mapBoundingRect, qreal &scale) const;
+
+    void renderToImage(QImage &image, RenderFlags renderFlags,
+                       const QRegion *mapRegion) const;
+    void paint(QPainter &painter, RenderFlags renderFlags,
+               const QRect &mapBoundingRect, qreal scale,
+               const QRectF &exposed) const;
+
     const Map *mMap;
     MapRenderer *mRenderer;
 #if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
@@ -36,6 +36,7 @@
 namespace Tiled {
 
 ObjectTypes Object::mObjectTypes;
+QHash<QString, Properties> Object::mObjectTypeProperties;
 
 Object::~Object()
 {}
@@ -83,13 +84,8 @@ QVariant Object::resolvedProperty(const QString &name) const
         return QVariant();
     }
 
-    if (!objectType.isEmpty()) {
-        for (const ObjectType &type : qAsConst(mObjectTypes)) {
-            if (type.name == objectType)
-                if (type.defaultProperties.contains(name))
-                    return type.defaultProperties.value(name);
-        }
-    }
+    if (!objectType.isEmpty())
+        return objectTypeProperties(objectType).value(name);
 
     return QVariant();
 }
@@ -118,13 +114,9 @@ QVariantMap Object::resolvedProperties() const
         break;
     }
 
-    if (!objectType.isEmpty()) {
-        for (const ObjectType &type : qAsConst(mObjectTypes)) {
-            if (type.name == objectType)
-                Tiled::mergeProperties(allProperties, type.defaultProperties);
-        }
-    }
-    
+    if (!objectType.isEmpty())
+        allProperties = objectTypeProperties(objectType);
+
     if (typeId() == Object::MapObjectType) {
         auto mapObject = static_cast<const MapObject*>(this);
 
@@ -143,6 +135,31 @@ QVariantMap Object::resolvedProperties() const
 void Object::setObjectTypes(const ObjectTypes &objectTypes)
 {
     mObjectTypes = objectTypes;
+    mObjectTypeProperties.clear();
+
+    // When several types share a name, the first one takes precedence
+    for (int i = objectTypes.size() - 1; i >= 0; --i) {
+        const ObjectType &type = objectTypes.at(i);
+        if (type.name.isEmpty())
+            continue;
+
+        Tiled::mergeProperties(mObjectTypeProperties[type.name], type.defaultProperties);
+    }
+}
+
+/**
+ * Returns the default properties of the object type with the given \a name,
+ * or an empty map when there is no such type.
+ */
+const Properties &Object::objectTypeProperties(const QString &name)
+{
+    static const Properties noProperties;
+
+    auto it = mObjectTypeProperties.constFind(name);
+    if (it == mObjectTypeProperties.constEnd())
+        return noProperties;
+
+    return it.value();
 }
 
 } // namespace Tiled
@@ -31,6 +31,8 @@
 #include "properties.h"
 #include "objecttypes.h"
 
+#include <QHash>
+
 namespace Tiled {
 
 /**
@@ -137,11 +139,14 @@ public:
     static const ObjectTypes &objectTypes()
     { return mObjectTypes; }
 
+    static const Properties &objectTypeProperties(const QString &name);
+
 private:
     const TypeId mTypeId;
     Properties mProperties;
 
     static ObjectTypes mObjectTypes;
+    static QHash<QString, Properties> mObjectTypeProperties;
 };
 
 
@@ -71,8 +71,13 @@ void ObjectGroup::insertObject(int index, MapObject *object)
 {
     mObjects.insert(index, object);
     object->setObjectGroup(this);
-    if (mMap && object->id() == 0)
-        object->setId(mMap->takeNextObjectId());
+
+    if (mMap) {
+        if (object->id() == 0)
+            object->setId(mMap->takeNextObjectId());
+
+        mMap->objectAdded(object);
+    }
 }
 
 int ObjectGroup::removeObject(MapObject *object)
@@ -88,6 +93,10 @@ int ObjectGroup::removeObject(MapObject *object)
 void ObjectGroup::removeObjectAt(int index)
 {
     MapObject *object = mObjects.takeAt(index);
+
+    if (mMap)
+        mMap->objectRemoved(object);
+
     object->setObjectGroup(nullptr);
 }
 
@@ -111,6 +120,10 @@ void ObjectGroup::moveObjects(int from, int to, int count)
 
     for (int i = 0; i < count; ++i)
         mObjects.insert(to + i, movingObjects.at(i));
+
+    // The order determines which object is found when IDs are not unique
+    if (mMap)
+        mMap->invalidateObjectIndex();
 }
 
 QRectF ObjectGroup::objectsBoundingRect() const
@@ -0,0 +1,94 @@
+/*
+ * regionbuilder.cpp
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of libtiled.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *    1. Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *    2. Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE CONTRIBUTORS ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "regionbuilder.h"
+
+#include <algorithm>
+
+using namespace Tiled;
+
+void RegionBuilder::addRect(const QRect &rect)
+{
+    for (int y = rect.top(); y <= rect.bottom(); ++y)
+        addSpan(y, rect.left(), rect.right());
+}
+
+QRegion RegionBuilder::region()
+{
+    std::sort(mSpans.begin(), mSpans.end(), [] (const Span &a, const Span &b) {
+        return a.y < b.y || (a.y == b.y && a.left < b.left);
+    });
+
+    // QRegion::setRects expects the rectangles to be sorted by y and then by
+    // x, with the rectangles starting at the same y having the same height
+    // and not touching each other horizontally. Identical consecutive rows
+    // are merged into a single band, which is what QRegion would do.
+    QVector<QRect> rects;
+    QVector<QRect> row;
+    int bandStart = 0;
+
+    auto finishRow = [&] (int y) {
+        const int bandSize = rects.size() - bandStart;
+        const bool extendsBand = bandSize == row.size() && bandSize > 0
+                && rects.at(bandStart).bottom() == y - 1
+                && std::equal(row.cbegin(), row.cend(), rects.cbegin() + bandStart,
+                              [] (const QRect &a, const QRect &b) {
+            return a.left() == b.left() && a.right() == b.right();
+        });
+
+        if (extendsBand) {
+            for (int i = bandStart; i < rects.size(); ++i)
+                rects[i].setBottom(y);
+        } else {
+            bandStart = rects.size();
+            rects += row;
+        }
+
+        row.clear();
+    };
+
+    for (int i = 0; i < mSpans.size(); ++i) {
+        const Span &span = mSpans.at(i);
+
+        if (!row.isEmpty() && row.last().top() != span.y)
+            finishRow(row.last().top());
+
+        // Merge overlapping and touching spans
+        if (!row.isEmpty() && span.left <= row.last().right() + 1)
+            row.last().setRight(std::max(row.last().right(), span.right));
+        else
+            row.append(QRect(QPoint(span.left, span.y), QPoint(span.right, span.y)));
+    }
+
+    if (!row.isEmpty())
+        finishRow(row.last().top());
+
+    QRegion region;
+    region.setRects(rects.constData(), rects.size());
+    return region;
+}
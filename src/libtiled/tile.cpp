@@ -142,8 +142,13 @@ void Tile::swapObjectGroup(std::unique_ptr<ObjectGroup> &objectGroup)
  */
 void Tile::setFrames(const QVector<Frame> &frames)
 {
+    const bool wasAnimated = isAnimated();
+
     resetAnimation();
     mFrames = frames;
+
+    if (mTileset && wasAnimated != isAnimated())
+        mTileset->mAnimatedTilesDirty = true;
 }
 
 /**
@@ -196,6 +201,7 @@ Tile *Tile::clone(Tileset *tileset) const
     Tile *c = new Tile(mImage, mId, tileset);
     c->setProperties(properties());
 
+    c->mImageRect = mImageRect;
     c->mImageSource = mImageSource;
     c->mImageStatus = mImageStatus;
     c->mType = mType;
@@ -108,6 +108,9 @@ public:
     const QPixmap &image() const;
     void setImage(const QPixmap &image);
 
+    const QRect &imageRect() const;
+    void setImageRect(const QRect &imageRect);
+
     const Tile *currentFrameTile() const;
 
     const QUrl &imageSource() const;
@@ -153,6 +156,7 @@ private:
     int mId;
     Tileset *mTileset;
     QPixmap mImage;
+    QRect mImageRect;
     QUrl mImageSource;
     LoadingStatus mImageStatus;
     QString mType;
@@ -197,9 +201,28 @@ inline const QPixmap &Tile::image() const
 inline void Tile::setImage(const QPixmap &image)
 {
     mImage = image;
+    mImageRect = QRect();
     mImageStatus = image.isNull() ? LoadingError : LoadingReady;
 }
 
+/**
+ * Returns the area of Tileset::atlasImage() that this tile's image was cut
+ * from. Returns a null rect for tiles that don't come from a tileset image.
+ */
+inline const QRect &Tile::imageRect() const
+{
+    return mImageRect;
+}
+
+/**
+ * Sets the area of Tileset::atlasImage() that corresponds to this tile's
+ * image. Needs to be called after setImage(), which resets it.
+ */
+inline void Tile::setImageRect(const QRect &imageRect)
+{
+    mImageRect = imageRect;
+}
+
 /**
  * Returns the URL of the external image that represents this tile.
  * When this tile doesn't refer to an external image, an empty URL is
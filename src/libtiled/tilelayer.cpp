@@ -31,6 +31,7 @@
 
 #include "tile.h"
 #include "hex.h"
+#include "regionbuilder.h"
 
 #include <algorithm>
 #include <memory>
@@ -41,26 +42,32 @@ using namespace Tiled;
 
 Cell Cell::empty;
 
-QRegion Chunk::region(std::function<bool (const Cell &)> condition) const
-{
-    QRegion region;
-
-    for (int y = 0; y < CHUNK_SIZE; ++y) {
-        for (int x = 0; x < CHUNK_SIZE; ++x) {
-            if (condition(cellAt(x, y))) {
-                const int rangeStart = x;
-                for (++x; x <= CHUNK_SIZE; ++x) {
-                    if (x == CHUNK_SIZE || !condition(cellAt(x, y))) {
-                        const int rangeEnd = x;
-                        region += QRect(rangeStart, y, rangeEnd - rangeStart, 1);
-                        break;
-                    }
-                }
+/**
+ * Adds the spans of cells in this chunk for which the given \a condition
+ * returns true to \a builder, offset by (\a x, \a y).
+ */
+static void addChunkSpans(RegionBuilder &builder,
+                          const Chunk &chunk,
+                          int x, int y,
+                          const std::function<bool (const Cell &)> &condition)
+{
+    for (int cy = 0; cy < CHUNK_SIZE; ++cy) {
+        for (int cx = 0; cx < CHUNK_SIZE; ++cx) {
+            if (condition(chunk.cellAt(cx, cy))) {
+                const int rangeStart = cx;
+                while (cx + 1 < CHUNK_SIZE && condition(chunk.cellAt(cx + 1, cy)))
+                    ++cx;
+                builder.addSpan(y + cy, x + rangeStart, x + cx);
             }
         }
     }
+}
 
-    return region;
+QRegion Chunk::region(std::function<bool (const Cell &)> condition) const
+{
+    RegionBuilder builder;
+    addChunkSpans(builder, *this, 0, 0, condition);
+    return builder.region();
 }
 
 void Chunk::setCell(int x, int y, const Cell &cell)
@@ -156,16 +163,18 @@ QMargins TileLayer::drawMargins() const
  */
 QRegion TileLayer::region(std::function<bool (const Cell &)> condition) const
 {
-    QRegion region;
+    RegionBuilder builder;
 
     QHashIterator<QPoint, Chunk> it(mChunks);
     while (it.hasNext()) {
         it.next();
-        region += it.value().region(condition).translated(it.key().x() * CHUNK_SIZE + mX,
-                                                          it.key().y() * CHUNK_SIZE + mY);
+        addChunkSpans(builder, it.value(),
+                      it.key().x() * CHUNK_SIZE + mX,
+                      it.key().y() * CHUNK_SIZE + mY,
+                      condition);
     }
 
-    return region;
+    return builder.region();
 }
 
 /**
@@ -200,6 +209,66 @@ void Tiled::TileLayer::setCell(int x, int y, const Cell &cell)
     _chunk.setCell(x & CHUNK_MASK, y & CHUNK_MASK, cell);
 }
 
+/**
+ * Sets the \a count cells starting at \a x on row \a y. Equivalent to
+ * calling setCell() for each of them, but looks up each chunk only once.
+ */
+void TileLayer::setCellRow(int x, int y, const Cell *cells, int count)
+{
+    const int chunkY = y & CHUNK_MASK;
+    Tileset *lastInsertedTileset = nullptr;
+
+    while (count > 0) {
+        const int chunkX = x & CHUNK_MASK;
+        const int spanLength = std::min(CHUNK_SIZE - chunkX, count);
+
+        const QPoint chunkCoordinates(x >> CHUNK_BITS, y >> CHUNK_BITS);
+        auto it = mChunks.find(chunkCoordinates);
+
+        if (it == mChunks.end()) {
+            const bool spanIsEmpty = std::all_of(cells, cells + spanLength,
+                                                 [] (const Cell &cell) {
+                return cell == Cell::empty && !cell.checked();
+            });
+
+            if (!spanIsEmpty) {
+                mBounds = mBounds.united(QRect(x - chunkX,
+                                               y - chunkY,
+                                               CHUNK_SIZE,
+                                               CHUNK_SIZE));
+                it = mChunks.insert(chunkCoordinates, Chunk());
+            }
+        }
+
+        if (it != mChunks.end()) {
+            auto target = it.value().begin() + chunkY * CHUNK_SIZE + chunkX;
+
+            for (int i = 0; i < spanLength; ++i, ++target) {
+                const Cell &cell = cells[i];
+
+                if (!mUsedTilesetsDirty) {
+                    Tileset *oldTileset = target->tileset();
+                    Tileset *newTileset = cell.tileset();
+                    if (oldTileset != newTileset) {
+                        if (oldTileset) {
+                            mUsedTilesetsDirty = true;
+                        } else if (newTileset && newTileset != lastInsertedTileset) {
+                            mUsedTilesets.insert(newTileset->sharedPointer());
+                            lastInsertedTileset = newTileset;
+                        }
+                    }
+                }
+
+                *target = cell;
+            }
+        }
+
+        x += spanLength;
+        cells += spanLength;
+        count -= spanLength;
+    }
+}
+
 std::unique_ptr<TileLayer> TileLayer::copy(const QRegion &region) const
 {
     const QRect regionBounds = region.boundingRect();
@@ -701,11 +770,45 @@ Layer *TileLayer::mergedWith(const Layer *other) const
 
 QRegion TileLayer::computeDiffRegion(const TileLayer *other) const
 {
-    QRegion ret;
+    RegionBuilder builder;
 
     const int dx = other->x() - mX;
     const int dy = other->y() - mY;
 
+    // When the layers are aligned, only the chunks present in either layer
+    // need to be compared, and each pair of chunks can be compared directly.
+    if (dx == 0 && dy == 0) {
+        const Chunk emptyChunk;
+
+        auto compareChunks = [&] (QPoint key, const Chunk &a, const Chunk &b) {
+            const int left = key.x() * CHUNK_SIZE;
+            const int top = key.y() * CHUNK_SIZE;
+
+            for (int y = 0; y < CHUNK_SIZE; ++y) {
+                for (int x = 0; x < CHUNK_SIZE; ++x) {
+                    if (a.cellAt(x, y) != b.cellAt(x, y)) {
+                        const int rangeStart = x;
+                        while (x + 1 < CHUNK_SIZE && a.cellAt(x + 1, y) != b.cellAt(x + 1, y))
+                            ++x;
+                        builder.addSpan(top + y, left + rangeStart, left + x);
+                    }
+                }
+            }
+        };
+
+        for (auto it = mChunks.cbegin(), end = mChunks.cend(); it != end; ++it) {
+            auto otherIt = other->mChunks.find(it.key());
+            const bool hasOther = otherIt != other->mChunks.cend();
+            compareChunks(it.key(), it.value(), hasOther ? otherIt.value() : emptyChunk);
+        }
+
+        for (auto it = other->mChunks.cbegin(), end = other->mChunks.cend(); it != end; ++it)
+            if (!mChunks.contains(it.key()))
+                compareChunks(it.key(), emptyChunk, it.value());
+
+        return builder.region();
+    }
+
     const QRect r = bounds().united(other->bounds()).translated(-position());
 
     for (int y = r.top(); y <= r.bottom(); ++y) {
@@ -717,12 +820,12 @@ QRegion TileLayer::computeDiffRegion(const TileLayer *other) const
                     ++x;
                 }
                 const int rangeEnd = x;
-                ret += QRect(rangeStart, y, rangeEnd - rangeStart, 1);
+                builder.addSpan(y, rangeStart, rangeEnd - 1);
             }
         }
     }
 
-    return ret;
+    return builder.region();
 }
 
 bool TileLayer::isEmpty() const
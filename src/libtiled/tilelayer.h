@@ -386,6 +386,7 @@ public:
     const Cell &cellAt(QPoint point) const;
 
     void setCell(int x, int y, const Cell &cell);
+    void setCellRow(int x, int y, const Cell *cells, int count);
 
     /**
      * Returns a copy of the area specified by the given \a region. The
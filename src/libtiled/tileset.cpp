@@ -37,6 +37,9 @@
 #include "wangset.h"
 
 #include <QBitmap>
+#include <QCoreApplication>
+#include <QPainter>
+#include <QThread>
 
 #include "qtcompat_p.h"
 
@@ -67,6 +70,8 @@ Tileset::Tileset(QString name, int tileWidth, int tileHeight,
     mExpectedRowCount(0),
     mNextTileId(0),
     mMaximumTerrainDistance(0),
+    mTilesSparse(false),
+    mAnimatedTilesDirty(false),
     mTerrainDistancesDirty(false),
     mStatus(LoadingReady)
 {
@@ -129,11 +134,14 @@ void Tileset::setMargin(int margin)
  */
 Tile *Tileset::findOrCreateTile(int id)
 {
-    if (Tile *tile = mTiles.value(id))
+    if (Tile *tile = findTile(id))
         return tile;
 
     mNextTileId = std::max(mNextTileId, id + 1);
-    return mTiles[id] = new Tile(id, this);
+
+    Tile *tile = new Tile(id, this);
+    insertTile(tile);
+    return tile;
 }
 
 /**
@@ -175,6 +183,50 @@ void Tileset::setImageReference(const ImageReference &reference)
         TilesetManager::instance()->tilesetImageSourceChanged(*this, oldImageSource);
 }
 
+/**
+ * Returns the whole tileset image as a single pixmap. The tiles cut from this
+ * image refer to their part of it through Tile::imageRect(), which allows
+ * renderers to draw tiles from the same tileset in a single batch.
+ *
+ * The atlas is assembled from the tile images on first use, so that only
+ * tilesets rendered with MapRenderer::UseTileAtlas keep their pixels twice.
+ * Since pixmaps can only be painted on the GUI thread, a null pixmap is
+ * returned when the atlas does not exist yet and this is called from another
+ * thread.
+ *
+ * Returns a null pixmap for image collection tilesets.
+ */
+const QPixmap &Tileset::atlasImage() const
+{
+    if (!mAtlasImage.isNull() || isCollection() || mImageReference.size.isEmpty())
+        return mAtlasImage;
+
+    const QCoreApplication *app = QCoreApplication::instance();
+    if (!app || QThread::currentThread() != app->thread())
+        return mAtlasImage;
+
+    QPixmap atlas(mImageReference.size);
+    atlas.fill(Qt::transparent);
+
+    QPainter painter(&atlas);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    bool empty = true;
+    for (const Tile *tile : mTiles) {
+        if (!tile->imageRect().isNull()) {
+            painter.drawPixmap(tile->imageRect().topLeft(), tile->image());
+            empty = false;
+        }
+    }
+
+    painter.end();
+
+    if (!empty)
+        mAtlasImage = atlas;
+
+    return mAtlasImage;
+}
+
 /**
  * Load this tileset from the given tileset \a image. This will replace
  * existing tile images in this tileset with new ones. If the new image
@@ -212,24 +264,29 @@ bool Tileset::loadFromImage(const QImage &image, const QUrl &source)
     const int stopWidth = image.width() - tileSize.width();
     const int stopHeight = image.height() - tileSize.height();
 
+    const QColor &transparent = mImageReference.transparentColor;
+
+    mAtlasImage = QPixmap();
+
     int tileNum = 0;
 
     for (int y = margin; y <= stopHeight; y += tileSize.height() + spacing) {
         for (int x = margin; x <= stopWidth; x += tileSize.width() + spacing) {
             const QImage tileImage = image.copy(x, y, tileSize.width(), tileSize.height());
             QPixmap tilePixmap = QPixmap::fromImage(tileImage);
-            const QColor &transparent = mImageReference.transparentColor;
 
             if (transparent.isValid()) {
                 const QImage mask = tileImage.createMaskFromColor(transparent.rgb());
                 tilePixmap.setMask(QBitmap::fromImage(mask));
             }
 
-            auto it = mTiles.find(tileNum);
-            if (it != mTiles.end())
-                it.value()->setImage(tilePixmap);
+            Tile *tile = findTile(tileNum);
+            if (tile)
+                tile->setImage(tilePixmap);
             else
-                mTiles.insert(tileNum, new Tile(tilePixmap, tileNum, this));
+                insertTile(tile = new Tile(tilePixmap, tileNum, this));
+
+            tile->setImageRect(QRect(QPoint(x, y), tileSize));
 
             ++tileNum;
         }
@@ -278,6 +335,27 @@ bool Tileset::loadFromImage(const QString &fileName)
     return loadImage();
 }
 
+static TilesheetParameters tilesheetParameters(const Tileset &tileset)
+{
+    TilesheetParameters p;
+    p.fileName = Tiled::urlToLocalFileOrQrc(tileset.imageSource());
+    p.tileWidth = tileset.tileWidth();
+    p.tileHeight = tileset.tileHeight();
+    p.spacing = tileset.tileSpacing();
+    p.margin = tileset.margin();
+    p.transparentColor = tileset.transparentColor();
+    return p;
+}
+
+/**
+ * Starts decoding the image this tileset is referring to in the background,
+ * so that a following call to loadImage() has less work to do.
+ */
+void Tileset::preloadImage() const
+{
+    ImageCache::preloadTilesheet(tilesheetParameters(*this));
+}
+
 /**
  * Tries to load the image this tileset is referring to.
  *
@@ -286,33 +364,35 @@ bool Tileset::loadFromImage(const QString &fileName)
  */
 bool Tileset::loadImage()
 {
-    TilesheetParameters p;
-    p.fileName = Tiled::urlToLocalFileOrQrc(mImageReference.source);
-    p.tileWidth = mTileWidth;
-    p.tileHeight = mTileHeight;
-    p.spacing = mTileSpacing;
-    p.margin = mMargin;
-    p.transparentColor = mImageReference.transparentColor;
+    const TilesheetParameters p = tilesheetParameters(*this);
 
     if (p.tileWidth <= 0 || p.tileHeight <= 0) {
         mImageReference.status = LoadingError;
         return false;
     }
 
-    QImage image = ImageCache::loadImage(p.fileName);
-    if (image.isNull()) {
+    // Only the pixmaps are needed, so the image is not kept in the cache
+    QSize imageSize;
+    const auto tiles = ImageCache::cutTiles(p, &imageSize);
+    if (imageSize.isEmpty()) {
         mImageReference.status = LoadingError;
         return false;
     }
 
-    auto tiles = ImageCache::cutTiles(p);
+    mAtlasImage = QPixmap();
+
+    const int columns = qMax(1, columnCountForWidth(imageSize.width()));
 
     for (int tileNum = 0; tileNum < tiles.size(); ++tileNum) {
-        auto it = mTiles.find(tileNum);
-        if (it != mTiles.end())
-            it.value()->setImage(tiles.at(tileNum));
+        Tile *tile = findTile(tileNum);
+        if (tile)
+            tile->setImage(tiles.at(tileNum));
         else
-            mTiles.insert(tileNum, new Tile(tiles.at(tileNum), tileNum, this));
+            insertTile(tile = new Tile(tiles.at(tileNum), tileNum, this));
+
+        const int x = mMargin + (tileNum % columns) * (mTileWidth + mTileSpacing);
+        const int y = mMargin + (tileNum / columns) * (mTileHeight + mTileSpacing);
+        tile->setImageRect(QRect(x, y, mTileWidth, mTileHeight));
     }
 
     QPixmap blank;
@@ -330,7 +410,7 @@ bool Tileset::loadImage()
 
     mNextTileId = std::max(mNextTileId, tiles.size());
 
-    mImageReference.size = image.size();
+    mImageReference.size = imageSize;
     mColumnCount = columnCountForWidth(mImageReference.size.width());
     mImageReference.status = LoadingReady;
 
@@ -703,7 +783,7 @@ Tile *Tileset::addTile(const QPixmap &image, const QUrl &source)
     newTile->setImage(image);
     newTile->setImageSource(source);
 
-    mTiles.insert(newTile->id(), newTile);
+    insertTile(newTile);
     if (mTileHeight < image.height())
         mTileHeight = image.height();
     if (mTileWidth < image.width())
@@ -720,7 +800,7 @@ void Tileset::addTiles(const QList<Tile *> &tiles)
 {
     for (Tile *tile : tiles) {
         Q_ASSERT(tile->tileset() == this && !mTiles.contains(tile->id()));
-        mTiles.insert(tile->id(), tile);
+        insertTile(tile);
     }
 
     updateTileSize();
@@ -735,7 +815,7 @@ void Tileset::removeTiles(const QList<Tile *> &tiles)
 {
     for (Tile *tile : tiles) {
         Q_ASSERT(tile->tileset() == this && mTiles.contains(tile->id()));
-        mTiles.remove(tile->id());
+        takeTile(tile->id());
     }
 
     updateTileSize();
@@ -746,7 +826,7 @@ void Tileset::removeTiles(const QList<Tile *> &tiles)
  */
 void Tileset::deleteTile(int id)
 {
-    delete mTiles.take(id);
+    delete takeTile(id);
 }
 
 /**
@@ -823,6 +903,11 @@ void Tileset::swap(Tileset &other)
     std::swap(mExpectedColumnCount, other.mExpectedColumnCount);
     std::swap(mExpectedRowCount, other.mExpectedRowCount);
     std::swap(mTiles, other.mTiles);
+    std::swap(mTileLookup, other.mTileLookup);
+    std::swap(mTilesSparse, other.mTilesSparse);
+    std::swap(mAnimatedTiles, other.mAnimatedTiles);
+    std::swap(mAnimatedTilesDirty, other.mAnimatedTilesDirty);
+    std::swap(mAtlasImage, other.mAtlasImage);
     std::swap(mNextTileId, other.mNextTileId);
     std::swap(mTerrainTypes, other.mTerrainTypes);
     std::swap(mWangSets, other.mWangSets);
@@ -865,6 +950,7 @@ SharedTileset Tileset::clone() const
     c->mStatus = mStatus;
     c->mBackgroundColor = mBackgroundColor;
     c->mFormat = mFormat;
+    c->mAtlasImage = mAtlasImage;
 
     QMapIterator<int, Tile*> tileIterator(mTiles);
     while (tileIterator.hasNext()) {
@@ -875,6 +961,8 @@ SharedTileset Tileset::clone() const
 
         c->mTiles.insert(id, tile->clone(c.data()));
     }
+    c->rebuildTileLookup();
+    c->mAnimatedTilesDirty = true;
 
     c->mTerrainTypes.reserve(mTerrainTypes.size());
     for (Terrain *terrain : mTerrainTypes)
@@ -891,6 +979,92 @@ SharedTileset Tileset::clone() const
     return c;
 }
 
+/**
+ * Adds the given \a tile to the tile map as well as to the lookup table
+ * used by findTile().
+ */
+void Tileset::insertTile(Tile *tile)
+{
+    const int id = tile->id();
+    mTiles.insert(id, tile);
+
+    if (tile->isAnimated())
+        mAnimatedTilesDirty = true;
+
+    if (mTilesSparse)
+        return;
+
+    if (id >= 0 && id < mTileLookup.size()) {
+        mTileLookup[id] = tile;
+    } else if (id >= 0 && id < std::max(mTiles.size() * 2, 64)) {
+        mTileLookup.resize(id + 1);
+        mTileLookup[id] = tile;
+    } else {
+        rebuildTileLookup();
+    }
+}
+
+/**
+ * Removes the tile with the given \a id from the tile map and the lookup
+ * table and returns it.
+ */
+Tile *Tileset::takeTile(int id)
+{
+    if (id >= 0 && id < mTileLookup.size())
+        mTileLookup[id] = nullptr;
+
+    Tile *tile = mTiles.take(id);
+    if (tile && tile->isAnimated())
+        mAnimatedTilesDirty = true;
+
+    return tile;
+}
+
+/**
+ * Returns the tiles in this tileset that have an animation, in order of
+ * their ID. The list is updated lazily when tiles are added or removed, or
+ * when their animation is set.
+ */
+const QVector<Tile *> &Tileset::animatedTiles() const
+{
+    if (mAnimatedTilesDirty) {
+        mAnimatedTiles.clear();
+        for (Tile *tile : mTiles)
+            if (tile->isAnimated())
+                mAnimatedTiles.append(tile);
+        mAnimatedTilesDirty = false;
+    }
+
+    return mAnimatedTiles;
+}
+
+/**
+ * Rebuilds the lookup table used by findTile(). As long as at least half of
+ * the tile IDs in use are filled (or the IDs are small), the tiles are stored
+ * in an array indexed by tile ID. Otherwise, findTile() falls back to looking
+ * up the tiles in the tile map.
+ */
+void Tileset::rebuildTileLookup()
+{
+    mTileLookup.clear();
+    mTilesSparse = false;
+
+    if (mTiles.isEmpty())
+        return;
+
+    const int minId = mTiles.firstKey();
+    const int maxId = mTiles.lastKey();
+
+    if (minId < 0 || maxId >= std::max(mTiles.size() * 2, 64)) {
+        mTilesSparse = true;
+        return;
+    }
+
+    mTileLookup.resize(maxId + 1);
+    for (Tile *tile : qAsConst(mTiles))
+        mTileLookup[tile->id()] = tile;
+}
+
 /**
  * Sets tile size to the maximum size.
  */
@@ -145,6 +145,7 @@ public:
     Tile *tileAt(int id) const { return findTile(id); } // provided for Python
     Tile *findOrCreateTile(int id);
     int tileCount() const;
+    const QVector<Tile*> &animatedTiles() const;
 
     int columnCount() const;
     int rowCount() const;
@@ -164,9 +165,12 @@ public:
 
     void setImageReference(const ImageReference &reference);
 
+    const QPixmap &atlasImage() const;
+
     bool loadFromImage(const QImage &image, const QUrl &source);
     bool loadFromImage(const QImage &image, const QString &source);
     bool loadFromImage(const QString &fileName);
+    void preloadImage() const;
     bool loadImage();
 
     SharedTileset findSimilarTileset(const QVector<SharedTileset> &tilesets) const;
@@ -249,6 +253,12 @@ public:
     static Orientation orientationFromString(const QString &);
 
 private:
+    friend class Tile; // To invalidate the list of animated tiles
+
+    void insertTile(Tile *tile);
+    Tile *takeTile(int id);
+    void rebuildTileLookup();
+
     void updateTileSize();
     void recalculateTerrainDistances();
 
@@ -269,6 +279,11 @@ private:
     int mNextTileId;
     int mMaximumTerrainDistance;
     QMap<int, Tile*> mTiles;
+    QVector<Tile*> mTileLookup;     // Indexed by tile ID, unless mTilesSparse
+    bool mTilesSparse;
+    mutable QVector<Tile*> mAnimatedTiles;
+    mutable bool mAnimatedTilesDirty;
+    mutable QPixmap mAtlasImage;
     QList<Terrain*> mTerrainTypes;
     QList<WangSet*> mWangSets;
     bool mTerrainDistancesDirty;
@@ -439,10 +454,15 @@ inline const QMap<int, Tile *> &Tileset::tiles() const
 /**
  * Returns the tile with the given tile ID. The tile IDs are local to this
  * tileset.
+ *
+ * Usually this is just an array lookup. Only when the tile IDs are very
+ * sparse, the lookup falls back to the tile map.
  */
 inline Tile *Tileset::findTile(int id) const
 {
-    return mTiles.value(id);
+    if (static_cast<unsigned>(id) < static_cast<unsigned>(mTileLookup.size()))
+        return mTileLookup.at(id);
+    return mTilesSparse ? mTiles.value(id) : nullptr;
 }
 
 /**
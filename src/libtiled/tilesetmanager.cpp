@@ -221,33 +221,29 @@ void TilesetManager::filesChanged(const QStringList &fileNames)
  */
 void TilesetManager::resetTileAnimations()
 {
-    // TODO: This could be more optimal by keeping track of the list of
-    // actually animated tiles
-
     for (Tileset *tileset : qAsConst(mTilesets)) {
-        bool imageChanged = false;
+        QVector<Tile*> changedTiles;
 
-        for (Tile *tile : tileset->tiles())
-            imageChanged |= tile->resetAnimation();
+        for (Tile *tile : tileset->animatedTiles())
+            if (tile->resetAnimation())
+                changedTiles.append(tile);
 
-        if (imageChanged)
-            emit repaintTileset(tileset);
+        if (!changedTiles.isEmpty())
+            emit repaintTiles(tileset, changedTiles);
     }
 }
 
 void TilesetManager::advanceTileAnimations(int ms)
 {
-    // TODO: This could be more optimal by keeping track of the list of
-    // actually animated tiles
-
     for (Tileset *tileset : qAsConst(mTilesets)) {
-        bool imageChanged = false;
+        QVector<Tile*> changedTiles;
 
-        for (Tile *tile : tileset->tiles())
-            imageChanged |= tile->advanceAnimation(ms);
+        for (Tile *tile : tileset->animatedTiles())
+            if (tile->advanceAnimation(ms))
+                changedTiles.append(tile);
 
-        if (imageChanged)
-            emit repaintTileset(tileset);
+        if (!changedTiles.isEmpty())
+            emit repaintTiles(tileset, changedTiles);
     }
 }
 
@@ -38,6 +38,7 @@
 namespace Tiled {
 
 class FileSystemWatcher;
+class Tile;
 class TileAnimationDriver;
 
 /**
@@ -85,10 +86,10 @@ signals:
     void tilesetImagesChanged(Tileset *tileset);
 
     /**
-     * Emitted when any images of the tiles in the given \a tileset have
-     * changed as a result of playing tile animations.
+     * Emitted when the given animated \a tiles of \a tileset have changed
+     * to a different frame as a result of playing tile animations.
      */
-    void repaintTileset(Tileset *tileset);
+    void repaintTiles(Tileset *tileset, const QVector<Tile*> &tiles);
 
 private:
     void filesChanged(const QStringList &fileNames);
@@ -49,6 +49,19 @@ unsigned wangTileToTileInfo(const WangTile &wangTile)
             | (wangTile.flippedAntiDiagonally() << 27);
 }
 
+/**
+ * Returns a mask covering the colors that are set in the given \a wangId.
+ * A wangId with wildcards matches those with the same colors in its mask.
+ */
+static unsigned wildcardMask(WangId wangId)
+{
+    unsigned mask = 0;
+    for (int i = 0; i < 8; ++i)
+        if (wangId.indexColor(i))
+            mask |= 0xfu << (i * 4);
+    return mask;
+}
+
 int WangId::edgeColor(int index) const
 {
     return indexColor(index * 2);
@@ -572,6 +585,9 @@ void WangSet::addWangTile(const WangTile &wangTile)
 
     mWangIdToWangTile.insert(wangTile.wangId(), wangTile);
     mTileInfoToWangId.insert(wangTileToTileInfo(wangTile), wangTile.wangId());
+
+    for (auto it = mWildcardIndex.begin(), end = mWildcardIndex.end(); it != end; ++it)
+        it.value()[wangTile.wangId() & it.key()].append(wangTile);
 }
 
 void WangSet::removeWangTile(const WangTile &wangTile)
@@ -583,6 +599,15 @@ void WangSet::removeWangTile(const WangTile &wangTile)
 
     mWangIdToWangTile.remove(wangId, w);
 
+    for (auto it = mWildcardIndex.begin(), end = mWildcardIndex.end(); it != end; ++it) {
+        auto tiles = it.value().find(wangId & it.key());
+        if (tiles != it.value().end()) {
+            tiles.value().removeOne(w);
+            if (tiles.value().isEmpty())
+                it.value().erase(tiles);
+        }
+    }
+
     if (wangId
             && !mWangIdToWangTile.contains(wangId)
             && (edgeColorCount() <= 1 || !wangId.hasEdgeWildCards())
@@ -602,17 +627,27 @@ QList<WangTile> WangSet::findMatchingWangTiles(WangId wangId) const
     if (wangId == 0)
         return mWangIdToWangTile.values();
 
-    QList<WangTile> list;
+    return wildcardIndex(wildcardMask(wangId)).value(wangId);
+}
+
+/**
+ * Returns the index of the wang tiles by their wangId with only the colors
+ * in the given \a mask, building it when it is used for the first time.
+ *
+ * Matching a wangId with wildcards this way is equivalent to looking up all
+ * its variations, as long as the wangIds in the set are valid.
+ */
+const QHash<WangId, QList<WangTile>> &WangSet::wildcardIndex(unsigned mask) const
+{
+    auto it = mWildcardIndex.find(mask);
+    if (it != mWildcardIndex.end())
+        return it.value();
 
-    for (WangId id : wangId.variations(edgeColorCount(), cornerColorCount())) {
-        auto i = mWangIdToWangTile.find(id);
-        while (i != mWangIdToWangTile.end() && i.key() == id) {
-            list.append(i.value());
-            ++i;
-        }
-    }
+    QHash<WangId, QList<WangTile>> &index = mWildcardIndex[mask];
+    for (auto i = mWangIdToWangTile.cbegin(); i != mWangIdToWangTile.cend(); ++i)
+        index[i.key() & mask].append(i.value());
 
-    return list;
+    return index;
 }
 
 WangId WangSet::wangIdFromSurrounding(WangId surroundingWangIds[]) const
@@ -738,12 +773,7 @@ bool WangSet::wildWangIdIsUsed(WangId wangId) const
     if (!wangId)
         return true;
 
-    for (WangId id : wangId.variations(edgeColorCount(), cornerColorCount())) {
-        if (wangIdIsUsed(id))
-            return true;
-    }
-
-    return false;
+    return wildcardIndex(wildcardMask(wangId)).contains(wangId);
 }
 
 bool WangSet::isComplete() const
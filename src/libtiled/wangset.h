@@ -422,6 +422,8 @@ public:
 private:
     void removeWangTile(const WangTile &wangTile);
 
+    const QHash<WangId, QList<WangTile>> &wildcardIndex(unsigned mask) const;
+
     void insertEdgeWangColor(const QSharedPointer<WangColor> &wangColor);
     void insertCornerWangColor(const QSharedPointer<WangColor> &wangColor);
 
@@ -436,6 +438,10 @@ private:
     QVector<QSharedPointer<WangColor>> mCornerColors;
     QMultiHash<WangId, WangTile> mWangIdToWangTile;
 
+    // For each mask used in a wildcard query so far, the wang tiles by their
+    // wangId with only the masked colors. Kept up to date on changes.
+    mutable QHash<unsigned, QHash<WangId, QList<WangTile>>> mWildcardIndex;
+
     // Tile info being the tileId, with the last three bits (32, 31, 30)
     // being info on flip (horizontal, vertical, and antidiagonal)
     QHash<unsigned, WangId> mTileInfoToWangId;
@@ -35,6 +35,7 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -44,8 +45,128 @@
 
 #include "qtcompat_p.h"
 
+#include <algorithm>
+#include <numeric>
+
 namespace Tiled {
 
+/**
+ * The list of all maps in a world, including the ones matched by its
+ * patterns, along with a grid that allows quickly finding the maps in a
+ * certain area.
+ */
+struct World::MapIndex
+{
+    explicit MapIndex(QVector<MapEntry> maps);
+
+    QVector<MapEntry> mapsInRect(const QRect &rect) const;
+
+    QVector<MapEntry> maps;
+    QSize cellSize;
+    QHash<quint64, QVector<int>> grid;
+    QVector<int> largeMaps;    // maps spanning many cells, always checked
+
+private:
+    QRect cellRange(const QRect &rect) const;
+
+    static quint64 cellKey(int x, int y)
+    {
+        return (quint64(quint32(x)) << 32) | quint32(y);
+    }
+};
+
+static int floorDiv(int value, int divisor)
+{
+    const int quotient = value / divisor;
+    return (value % divisor < 0) ? quotient - 1 : quotient;
+}
+
+World::MapIndex::MapIndex(QVector<MapEntry> maps)
+    : maps(std::move(maps))
+    , cellSize(1, 1)
+{
+    // Use the average map size as the size of the grid cells
+    qint64 totalWidth = 0;
+    qint64 totalHeight = 0;
+    int count = 0;
+
+    for (const MapEntry &entry : qAsConst(this->maps)) {
+        if (entry.rect.isEmpty())
+            continue;
+        totalWidth += entry.rect.width();
+        totalHeight += entry.rect.height();
+        ++count;
+    }
+
+    if (count == 0)
+        return;
+
+    cellSize = QSize(int(qMax<qint64>(1, totalWidth / count)),
+                     int(qMax<qint64>(1, totalHeight / count)));
+
+    for (int i = 0; i < this->maps.size(); ++i) {
+        const QRect &rect = this->maps.at(i).rect;
+        if (rect.isEmpty())
+            continue;   // can't intersect with anything
+
+        const QRect cells = cellRange(rect);
+        if (qint64(cells.width()) * cells.height() > 16) {
+            largeMaps.append(i);
+            continue;
+        }
+
+        for (int y = cells.top(); y <= cells.bottom(); ++y)
+            for (int x = cells.left(); x <= cells.right(); ++x)
+                grid[cellKey(x, y)].append(i);
+    }
+}
+
+QVector<World::MapEntry> World::MapIndex::mapsInRect(const QRect &rect) const
+{
+    QVector<MapEntry> result;
+    if (rect.isEmpty())
+        return result;
+
+    QVector<int> candidates(largeMaps);
+
+    const QRect cells = cellRange(rect);
+    if (qint64(cells.width()) * cells.height() > grid.size()) {
+        // Cheaper to just look at all the maps
+        candidates.resize(maps.size());
+        std::iota(candidates.begin(), candidates.end(), 0);
+    } else {
+        for (int y = cells.top(); y <= cells.bottom(); ++y) {
+            for (int x = cells.left(); x <= cells.right(); ++x) {
+                auto it = grid.constFind(cellKey(x, y));
+                if (it != grid.constEnd())
+                    candidates.append(it.value());
+            }
+        }
+
+        // Maps may be in multiple cells, and should be returned in order
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                         candidates.end());
+    }
+
+    for (int index : qAsConst(candidates)) {
+        const MapEntry &entry = maps.at(index);
+        if (entry.rect.intersects(rect))
+            result.append(entry);
+    }
+
+    return result;
+}
+
+QRect World::MapIndex::cellRange(const QRect &rect) const
+{
+    return QRect(QPoint(floorDiv(rect.left(), cellSize.width()),
+                        floorDiv(rect.top(), cellSize.height())),
+                 QPoint(floorDiv(rect.right(), cellSize.width()),
+                        floorDiv(rect.bottom(), cellSize.height())));
+}
+
+
 WorldManager *WorldManager::mInstance;
 
 WorldManager::WorldManager()
@@ -91,7 +212,9 @@ void WorldManager::reloadWorldFiles(const QStringList &fileNames)
             if (world) {
                 std::unique_ptr<World> oldWorld { mWorlds.take(fileName) };
                 oldWorld->clearErrorsAndWarnings();
+                unwatchWorldDirectory(oldWorld.get());
 
+                watchWorldDirectory(world.get());
                 mWorlds.insert(fileName, world.release());
 
                 changed = true;
@@ -100,10 +223,40 @@ void WorldManager::reloadWorldFiles(const QStringList &fileNames)
         }
     }
 
+    // Maps may have been added to or removed from the directories of worlds
+    // using patterns
+    for (const World *world : qAsConst(mWorlds)) {
+        if (world->patterns.isEmpty())
+            continue;
+        if (!fileNames.contains(QFileInfo(world->fileName).path()))
+            continue;
+
+        const auto previousMaps = world->allMaps();
+        world->invalidateMapIndex();
+        if (world->allMaps() != previousMaps)
+            changed = true;
+    }
+
     if (changed)
         emit worldsChanged();
 }
 
+/**
+ * Worlds using patterns are matched against the files in their directory,
+ * so we need to know when files are added or removed there.
+ */
+void WorldManager::watchWorldDirectory(const World *world)
+{
+    if (!world->patterns.isEmpty())
+        mFileSystemWatcher.addPath(QFileInfo(world->fileName).path());
+}
+
+void WorldManager::unwatchWorldDirectory(const World *world)
+{
+    if (!world->patterns.isEmpty())
+        mFileSystemWatcher.removePath(QFileInfo(world->fileName).path());
+}
+
 static QString jsonValueToString(const QJsonValue &value)
 {
     switch (value.type()) {
@@ -246,11 +399,14 @@ World *WorldManager::loadAndStoreWorld(const QString &fileName, QString *errorSt
     if (!world)
         return nullptr;
 
-    if (mWorlds.contains(fileName))
-        delete mWorlds.take(fileName);
-    else
+    if (mWorlds.contains(fileName)) {
+        std::unique_ptr<World> oldWorld { mWorlds.take(fileName) };
+        unwatchWorldDirectory(oldWorld.get());
+    } else {
         mFileSystemWatcher.addPath(fileName);
+    }
 
+    watchWorldDirectory(world.get());
     mWorlds.insert(fileName, world.release());
 
     return mWorlds.value(fileName);
@@ -335,6 +491,7 @@ void WorldManager::unloadWorld(const QString &fileName)
     std::unique_ptr<World> world { mWorlds.take(fileName) };
     if (world) {
         mFileSystemWatcher.removePath(fileName);
+        unwatchWorldDirectory(world.get());
         emit worldsChanged();
         emit worldUnloaded(fileName);
     }
@@ -434,14 +591,19 @@ bool WorldManager::addMap(const QString &fileName, const QString &mapFileName, c
     return false;
 }
 
+World::World() = default;
+World::~World() = default;
+
 void World::setMapRect(int mapIndex, const QRect &rect)
 {
     maps[mapIndex].rect = rect;
+    invalidateMapIndex();
 }
 
 void World::removeMap(int mapIndex)
 {
     maps.removeAt(mapIndex);
+    invalidateMapIndex();
 }
 
 void World::addMap(const QString &fileName, const QRect &rect)
@@ -450,6 +612,7 @@ void World::addMap(const QString &fileName, const QRect &rect)
     entry.rect = rect;
     entry.fileName = fileName;
     maps.append(entry);
+    invalidateMapIndex();
 }
 
 int World::mapIndex(const QString &fileName) const
@@ -505,8 +668,34 @@ QRect World::mapRect(const QString &fileName) const
     return QRect();
 }
 
+/**
+ * Returns all maps in this world, including the ones matching any of its
+ * patterns.
+ *
+ * The patterns are only matched against the files in the world's directory
+ * once, after which the result is cached until invalidateMapIndex() is
+ * called.
+ */
 QVector<World::MapEntry> World::allMaps() const
 {
+    return spatialIndex().maps;
+}
+
+/**
+ * Drops the cached list of maps and the spatial index. Needs to be called
+ * when the maps or patterns are changed directly, or when files were added to
+ * or removed from the world's directory.
+ */
+void World::invalidateMapIndex() const
+{
+    mMapIndex.reset();
+}
+
+const World::MapIndex &World::spatialIndex() const
+{
+    if (mMapIndex)
+        return *mMapIndex;
+
     QVector<World::MapEntry> all(maps);
 
     if (!patterns.isEmpty()) {
@@ -531,18 +720,13 @@ QVector<World::MapEntry> World::allMaps() const
         }
     }
 
-    return all;
+    mMapIndex.reset(new MapIndex(std::move(all)));
+    return *mMapIndex;
 }
 
 QVector<World::MapEntry> World::mapsInRect(const QRect &rect) const
 {
-    QVector<World::MapEntry> maps(allMaps());
-
-    maps.erase(std::remove_if(maps.begin(), maps.end(),
-                              [&](const World::MapEntry &mapEntry) { return !mapEntry.rect.intersects(rect); }),
-               maps.end());
-
-    return maps;
+    return spatialIndex().mapsInRect(rect);
 }
 
 QVector<World::MapEntry> World::contextMaps(const QString &fileName) const
@@ -557,18 +741,9 @@ QString World::firstMap() const
     if (!maps.isEmpty())
         return maps.first().fileName;
 
-    if (!patterns.isEmpty()) {
-        const QDir dir(QFileInfo(fileName).dir());
-        const QStringList entries = dir.entryList(QDir::Files | QDir::Readable);
-
-        for (const World::Pattern &pattern : patterns) {
-            for (const QString &fileName : entries) {
-                QRegularExpressionMatch match = pattern.regexp.match(fileName);
-                if (match.hasMatch())
-                    return dir.filePath(fileName);
-            }
-        }
-    }
+    const auto &all = spatialIndex().maps;
+    if (!all.isEmpty())
+        return all.first().fileName;
 
     return QString();
 }
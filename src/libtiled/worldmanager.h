@@ -47,6 +47,9 @@ namespace Tiled {
 
 struct TILEDSHARED_EXPORT World
 {
+    World();
+    ~World();
+
     struct Pattern
     {
         QRegularExpression regexp;
@@ -60,6 +63,16 @@ struct TILEDSHARED_EXPORT World
     {
         QString fileName;
         QRect rect;
+
+        bool operator==(const MapEntry &other) const
+        {
+            return fileName == other.fileName && rect == other.rect;
+        }
+
+        bool operator!=(const MapEntry &other) const
+        {
+            return !(*this == other);
+        }
     };
 
     QString fileName;
@@ -78,6 +91,8 @@ struct TILEDSHARED_EXPORT World
     QVector<MapEntry> contextMaps(const QString &fileName) const;
     QString firstMap() const;
 
+    void invalidateMapIndex() const;
+
     void error(const QString &message) const;
     void warning(const QString &message) const;
     void clearErrorsAndWarnings() const;
@@ -90,6 +105,13 @@ struct TILEDSHARED_EXPORT World
      */
     QString displayName() const;
     static QString displayName(const QString &fileName);
+
+private:
+    struct MapIndex;
+
+    const MapIndex &spatialIndex() const;
+
+    mutable std::unique_ptr<MapIndex> mMapIndex;
 };
 
 class TILEDSHARED_EXPORT WorldManager : public QObject
@@ -128,6 +150,9 @@ private:
     World *loadAndStoreWorld(const QString &fileName, QString *errorString = nullptr);
     void reloadWorldFiles(const QStringList &fileNames);
 
+    void watchWorldDirectory(const World *world);
+    void unwatchWorldDirectory(const World *world);
+
     std::unique_ptr<World> privateLoadWorld(const QString &fileName,
                                             QString *errorString = nullptr);
 
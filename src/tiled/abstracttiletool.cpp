@@ -27,6 +27,7 @@
 #include "mapscene.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilesetmanager.h"
 #include "tilestamp.h"
 
 #include <QKeyEvent>
@@ -49,6 +50,13 @@ AbstractTileTool::AbstractTileTool(Id id,
         mBrushItem = new BrushItem;
     mBrushItem->setVisible(false);
     mBrushItem->setZValue(10000);
+
+    // The brush may contain animated tiles
+    connect(TilesetManager::instance(), &TilesetManager::repaintTiles,
+            this, [this] {
+        if (mBrushItem->scene() && mBrushItem->isVisible())
+            mBrushItem->update();
+    });
 }
 
 AbstractTileTool::~AbstractTileTool()
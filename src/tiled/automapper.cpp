@@ -34,10 +34,16 @@
 #include "maprenderer.h"
 #include "object.h"
 #include "objectgroup.h"
+#include "randompicker.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilelayerjournal.h"
 
 #include <QDebug>
+#include <QThread>
+
+#include <algorithm>
+#include <set>
 
 #include "qtcompat_p.h"
 
@@ -135,6 +141,11 @@ bool AutoMapper::setupRuleMapProperties()
                 mOptions.noOverlappingRules = value.toBool();
                 continue;
             }
+        } else if (name.compare(QLatin1String("RandomSeed"), Qt::CaseInsensitive) == 0) {
+            if (value.canConvert(QVariant::UInt)) {
+                mOptions.randomSeed = value.toUInt();
+                continue;
+            }
         }
 
         QString warning = tr("Ignoring unknown property '%2' = '%3' (rule map '%1')")
@@ -472,9 +483,40 @@ bool AutoMapper::setupTilesets()
     return true;
 }
 
-void AutoMapper::autoMap(QRegion *where)
+void AutoMapper::setupCompiledRules()
+{
+    mEmptyLayer.reset(new TileLayer(QString(), 0, 0,
+                                    mMapWork->width(),
+                                    mMapWork->height()));
+
+    CompiledRule::MatchOptions matchOptions;
+    matchOptions.matchOutsideMap = mOptions.matchOutsideMap;
+    matchOptions.overflowBorder = mOptions.overflowBorder;
+    matchOptions.wrapBorder = mOptions.wrapBorder;
+
+    mCompiledRules.clear();
+    mCompiledRules.reserve(mRulesInput.size());
+
+    for (const QRegion &ruleInputRegion : qAsConst(mRulesInput)) {
+        mCompiledRules.append(CompiledRule(mInputRules,
+                                           ruleInputRegion,
+                                           *mMapWork,
+                                           mEmptyLayer.get(),
+                                           matchOptions));
+    }
+}
+
+void AutoMapper::autoMap(QRegion *where, TileLayerJournal *journal)
 {
+    mJournal = journal;
+
     Q_ASSERT(mRulesInput.size() == mRulesOutput.size());
+
+    // Compiled only now, since other automappers may have added the layers
+    // used as input while preparing, and the tilesets of the rules may have
+    // been replaced by setupTilesets().
+    setupCompiledRules();
+
     // first resize the active area
     if (mOptions.autoMappingRadius) {
         QRegion region;
@@ -501,6 +543,8 @@ void AutoMapper::autoMap(QRegion *where)
                 const QRegion region = setLayersRegion.intersected(*where);
                 TileLayer *dstTileLayer = dstLayer->asTileLayer();
                 if (dstTileLayer) {
+                    if (mJournal)
+                        mJournal->recordRegion(dstTileLayer, region);
                     dstTileLayer->erase(region);
                 } else {
                     eraseRegionObjectGroup(mMapDocument,
@@ -511,6 +555,20 @@ void AutoMapper::autoMap(QRegion *where)
         }
     }
 
+    // When no rule writes to a layer that is used as input, the matches of
+    // all rules can be found up front in parallel. They are applied in the
+    // same order in which they would otherwise have been found.
+    QVector<QVector<QPoint>> matches;
+    if (canMatchInParallel(*where))
+        matches = findMatches(*where);
+    else
+        setupCellIndex(*where);
+
+    if (mOptions.randomSeed)
+        mRandomEngine.seed(mOptions.randomSeed);
+    else
+        mRandomEngine.seed(globalRandomEngine()());
+
     // Increase the given region where the next automapper should work.
     // This needs to be done, so you can rely on the order of the rules at all
     // locations
@@ -522,219 +580,133 @@ void AutoMapper::autoMap(QRegion *where)
     for (const QRect &rect : *where) {
 #endif
         for (int i = 0; i < mRulesInput.size(); ++i) {
-            // at the moment the parallel execution does not work yet
-            // TODO: make multithreading available!
-            // either by dividing the rules or the region to multiple threads
-            ret = ret.united(applyRule(i, rect));
+            const QVector<QPoint> *ruleMatches = matches.isEmpty() ? nullptr : &matches.at(i);
+            ret = ret.united(applyRule(i, rect, ruleMatches));
         }
     }
     *where = where->united(ret);
+
+    mCellIndex.clear();
+    mJournal = nullptr;
 }
 
-QRegion AutoMapper::computeSetLayersRegion() const
+static bool rowMajorLess(QPoint a, QPoint b)
 {
-    QRegion result;
-    for (const QString &name : qAsConst(mInputRules.names)) {
-        const int index = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-        if (index == -1)
-            continue;
-        TileLayer *setLayer = mMapWork->layerAt(index)->asTileLayer();
-        result |= setLayer->region();
-    }
-    return result;
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
 }
 
 /**
- * Fills \a cells with the list of all cells which can be found within all
- * tile layers within the given region.
+ * Returns the offsets at which the rule with the given \a ruleInputRegion
+ * overlaps the \a where rect by at least one tile.
  */
-static void collectCellsInRegion(const QVector<InputLayer> &list,
-                                 const QRegion &r,
-                                 QVarLengthArray<Cell, 8> &cells)
+static QRect matchOffsets(const QRegion &ruleInputRegion, const QRect &where)
+{
+    // Since the rule itself is translated, we need to adjust the borders of the
+    // loops. Decrease the size at all sides by one: There must be at least one
+    // tile overlap to the rule.
+    const QRect rbr = ruleInputRegion.boundingRect();
+
+    return QRect(QPoint(where.left() - rbr.left() - rbr.width() + 1,
+                        where.top() - rbr.top() - rbr.height() + 1),
+                 QPoint(where.right() - rbr.left() + rbr.width() - 1,
+                        where.bottom() - rbr.top() + rbr.height() - 1));
+}
+
+bool AutoMapper::canMatchInParallel(const QRegion &where) const
+{
+    if (QThread::idealThreadCount() < 2)
+        return false;
+
+    // Matching is only independent of applying the rules when none of the
+    // output layers is also used as input.
+    for (const RuleOutput &translationTable : mLayerList) {
+        for (const int index : translationTable) {
+            const Layer *layer = mMapWork->layerAt(index);
+            if (layer->isTileLayer() && mInputRules.names.contains(layer->name()))
+                return false;
+        }
+    }
+
+    // Avoid the overhead for small areas, like those of interactive automapping
+    return matchPositions(where) >= 65536;
+}
+
+qint64 AutoMapper::matchPositions(const QRegion &where) const
 {
-    for (const InputLayer &inputLayer : list) {
+    qint64 positions = 0;
+    for (const QRegion &ruleInputRegion : mRulesInput) {
 #if QT_VERSION < 0x050800
-        const auto rects = r.rects();
+        const auto rects = where.rects();
         for (const QRect &rect : rects) {
 #else
-        for (const QRect &rect : r) {
+        for (const QRect &rect : where) {
 #endif
-            for (int x = rect.left(); x <= rect.right(); ++x) {
-                for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                    const Cell &cell = inputLayer.tileLayer->cellAt(x, y);
-                    if (!cells.contains(cell))
-                        cells.append(cell);
-                }
-            }
+            const QRect offsets = matchOffsets(ruleInputRegion, rect);
+            positions += qint64(offsets.width()) * offsets.height();
         }
     }
+    return positions;
 }
 
-/**
- * This function is one of the core functions for understanding the
- * automapping.
- * In this function a certain region (of the set layer) is compared to
- * several other layers (ruleSet and ruleNotSet).
- * This comparison will determine if a rule of automapping matches,
- * so if this rule is applied at this region given
- * by a QRegion and Offset given by a QPoint.
- *
- * This compares the tile layer setLayer to several others given
- * in the QList listYes (ruleSet) and OList listNo (ruleNotSet).
- * The tile layer setLayer is examined at QRegion ruleRegion + offset
- * The tile layers within listYes and listNo are examined at QRegion ruleRegion.
- *
- * Basically all matches between setLayer and a layer of listYes are considered
- * good, while all matches between setLayer and listNo are considered bad and
- * lead to canceling the comparison, returning false.
- *
- * The comparison is done for each position within the QRegion ruleRegion.
- * If all positions of the region are considered "good" return true.
- *
- * Now there are several cases to distinguish:
- *  - both listYes and listNo are empty:
- *      This should not happen, because with that configuration, absolutely
- *      no condition is given.
- *      return false, assuming this is an errornous rule being applied
- *
- *  - both listYes and listNo are not empty:
- *      When comparing a tile at a certain position of tile layer setLayer
- *      to all available tiles in listYes, there must be at least
- *      one layer, in which there is a match of tiles of setLayer and
- *      listYes to consider this position good.
- *      In listNo there must not be a match to consider this position
- *      good.
- *      If there are no tiles within all available tiles within all layers
- *      of one list, all tiles in setLayer are considered good,
- *      while inspecting this list.
- *      All available tiles are all tiles within the whole rule region in
- *      all tile layers of the list.
- *
- *  - either of both lists are not empty
- *      When comparing a certain position of tile layer setLayer
- *      to all Tiles at the corresponding position this can happen:
- *      A tile of setLayer matches a tile of a layer in the list. Then this
- *      is considered as good, if the layer is from the listYes.
- *      Otherwise it is considered bad.
- *
- *      Exception, when having only the listYes:
- *      if at the examined position there are no tiles within all Layers
- *      of the listYes, all tiles except all used tiles within
- *      the layers of that list are considered good.
- *
- *      This exception was added to have a better functionality
- *      (need of less layers.)
- *      It was not added to the case, when having only listNo layers to
- *      avoid total symmetry between those lists.
- *      It can be turned off by setting the StrictEmpty property on the input
- *      layer.
- *
- * If all positions are considered good, return true.
- * return false otherwise.
- *
- * @return bool, if the tile layer matches the given list of layers.
- */
-static bool layerMatchesConditions(const TileLayer &setLayer,
-                                   const InputConditions &conditions,
-                                   const QRegion &ruleRegion,
-                                   const QPoint offset,
-                                   const AutoMapper::Options &options)
-{
-    const auto &listYes = conditions.listYes;
-    const auto &listNo = conditions.listNo;
-    if (listYes.isEmpty() && listNo.isEmpty())
-        return false;
+void AutoMapper::setupCellIndex(const QRegion &where)
+{
+    mCellIndex.clear();
 
-    QVarLengthArray<Cell, 8> cells;
-    if (listNo.isEmpty())
-        collectCellsInRegion(listYes, ruleRegion, cells);
+    // Indexing the whole layers costs more than checking a small area
+    if (matchPositions(where) < 65536)
+        return;
 
+    for (const QString &name : qAsConst(mInputRules.names)) {
+        const int index = mMapWork->indexOfLayer(name, Layer::TileLayerType);
+        if (index != -1)
+            mCellIndex.addLayer(mMapWork->layerAt(index)->asTileLayer());
+    }
+}
+
+QVector<QVector<QPoint>> AutoMapper::findMatches(const QRegion &where) const
+{
+    QVector<QRegion> offsets(mRulesInput.size());
+
+    for (int i = 0; i < mRulesInput.size(); ++i) {
 #if QT_VERSION < 0x050800
-    const auto rects = ruleRegion.rects();
-    for (const QRect &rect : rects) {
+        const auto rects = where.rects();
+        for (const QRect &rect : rects) {
 #else
-    for (const QRect &rect : ruleRegion) {
+        for (const QRect &rect : where) {
 #endif
-        for (int x = rect.left(); x <= rect.right(); ++x) {
-            for (int y = rect.top(); y <= rect.bottom(); ++y) {
-                int xd = x + offset.x();
-                int yd = y + offset.y();
-
-                if (!options.matchOutsideMap && !setLayer.contains(xd, yd))
-                    return false;
-
-                // Those two options are guaranteed to be false if the map is infinite,
-                // so no "invalid" width/height accessing here.
-                if (options.wrapBorder) {
-                    xd = wrap(xd, setLayer.width());
-                    yd = wrap(yd, setLayer.height());
-                } else if (options.overflowBorder) {
-                    xd = qBound(0, xd, setLayer.width() - 1);
-                    yd = qBound(0, yd, setLayer.height() - 1);
-                }
-
-                const Cell &setCell = setLayer.cellAt(xd, yd);
-
-                // First check listNo. If any tile matches there, we can
-                // immediately know there is no match.
-                for (const InputLayer &inputNotLayer : listNo) {
-                    const Cell &noCell = inputNotLayer.tileLayer->cellAt(x, y);
-                    if ((inputNotLayer.strictEmpty || !noCell.isEmpty()) && setCell == noCell)
-                        return false;
-                }
-
-                // ruleDefinedListYes will be set when there is a tile in at
-                // least one layer. If there is a tile in at least one layer,
-                // only the given tiles in the different listYes layers are
-                // valid. Otherwise, consider all tiles not used elsewhere in
-                // the input as valid.
-                bool ruleDefinedListYes = false;
-                bool matchListYes = false;
-
-                for (const InputLayer &inputLayer : listYes) {
-                    const Cell &yesCell = inputLayer.tileLayer->cellAt(x, y);
-                    if (inputLayer.strictEmpty || !yesCell.isEmpty()) {
-                        ruleDefinedListYes = true;
-                        if (setCell == yesCell) {
-                            matchListYes = true;
-                            break;
-                        }
-                    }
-                }
-
-                if (!ruleDefinedListYes) {
-                    // if there were only layers in the listYes, check the exception
-                    if (listNo.isEmpty() && cells.contains(setCell))
-                        return false;
-                } else if (!matchListYes) {
-                    return false;
-                }
-            }
+            offsets[i] |= matchOffsets(mRulesInput.at(i), rect);
         }
     }
 
-    return true;
+    return CompiledRule::matchesIn(mCompiledRules, offsets);
 }
 
-QRect AutoMapper::applyRule(int ruleIndex, const QRect &where)
+QRegion AutoMapper::computeSetLayersRegion() const
+{
+    QRegion result;
+    for (const QString &name : qAsConst(mInputRules.names)) {
+        const int index = mMapWork->indexOfLayer(name, Layer::TileLayerType);
+        if (index == -1)
+            continue;
+        TileLayer *setLayer = mMapWork->layerAt(index)->asTileLayer();
+        result |= setLayer->region();
+    }
+    return result;
+}
+
+QRect AutoMapper::applyRule(int ruleIndex, const QRect &where,
+                            const QVector<QPoint> *matches)
 {
     QRect ret;
 
     if (mLayerList.isEmpty())
         return ret;
 
+    const CompiledRule &compiledRule = mCompiledRules.at(ruleIndex);
     const QRegion &ruleInputRegion = mRulesInput.at(ruleIndex);
     const QRegion &ruleOutputRegion = mRulesOutput.at(ruleIndex);
     const QRect rbr = ruleInputRegion.boundingRect();
-
-    // Since the rule itself is translated, we need to adjust the borders of the
-    // loops. Decrease the size at all sides by one: There must be at least one
-    // tile overlap to the rule.
-    const int minX = where.left() - rbr.left() - rbr.width() + 1;
-    const int minY = where.top() - rbr.top() - rbr.height() + 1;
-
-    const int maxX = where.right() - rbr.left() + rbr.width() - 1;
-    const int maxY = where.bottom() - rbr.top() + rbr.height() - 1;
+    const QRect offsets = matchOffsets(ruleInputRegion, where);
 
     // In this list of regions it is stored which parts or the map have already
     // been altered by exactly this rule. We store all the altered parts to
@@ -744,78 +716,87 @@ QRect AutoMapper::applyRule(int ruleIndex, const QRect &where)
     if (mOptions.noOverlappingRules)
         appliedRegions.resize(mMapWork->layerCount());
 
-    const TileLayer dummy(QString(), 0, 0, mMapWork->width(), mMapWork->height());
+    std::uniform_int_distribution<int> outputIndex(0, mLayerList.size() - 1);
 
-    for (int y = minY; y <= maxY; ++y)
-    for (int x = minX; x <= maxX; ++x) {
-        bool anyMatch = false;
+    auto applyAt = [&] (int x, int y) {
+        // choose by chance which group of rule_layers should be used:
+        const RuleOutput &translationTable = mLayerList.at(outputIndex(mRandomEngine));
 
-        for (const InputIndex &inputIndex : qAsConst(mInputRules)) {
-            bool allLayerNamesMatch = true;
+        if (mOptions.noOverlappingRules) {
+            const QList<Layer*> layers = translationTable.keys();
 
-            QMapIterator<QString, InputConditions> inputIndexIterator(inputIndex);
-            while (inputIndexIterator.hasNext()) {
-                inputIndexIterator.next();
+            // check if there are no overlaps within this rule.
+            QVector<QRegion> ruleRegionInLayer;
+            for (int i = 0; i < layers.size(); ++i) {
+                Layer *layer = layers.at(i);
 
-                const QString &name = inputIndexIterator.key();
-                const InputConditions &conditions = inputIndexIterator.value();
+                QRegion appliedPlace;
 
-                const int i = mMapWork->indexOfLayer(name, Layer::TileLayerType);
-                const TileLayer &setLayer = (i >= 0) ? *mMapWork->layerAt(i)->asTileLayer() : dummy;
+                if (TileLayer *tileLayer = layer->asTileLayer())
+                    appliedPlace = tileLayer->region();
+                else if (ObjectGroup *objectGroup = layer->asObjectGroup())
+                    appliedPlace = tileRegionOfObjectGroup(objectGroup);
+                else
+                    continue;
 
-                if (!layerMatchesConditions(setLayer, conditions, ruleInputRegion, QPoint(x, y), mOptions)) {
-                    allLayerNamesMatch = false;
-                    break;
-                }
-            }
+                ruleRegionInLayer.append(appliedPlace.intersected(ruleOutputRegion));
 
-            if (allLayerNamesMatch) {
-                anyMatch = true;
-                break;
+                if (appliedRegions.at(i).intersects(ruleRegionInLayer.at(i).translated(x, y)))
+                    return;
             }
-        }
-
-        if (anyMatch) {
-            // choose by chance which group of rule_layers should be used:
-            const int r = qrand() % mLayerList.size();
-            const RuleOutput &translationTable = mLayerList.at(r);
-
-            if (mOptions.noOverlappingRules) {
-                bool overlap = false;
-                const QList<Layer*> layers = translationTable.keys();
-
-                // check if there are no overlaps within this rule.
-                QVector<QRegion> ruleRegionInLayer;
-                for (int i = 0; i < layers.size(); ++i) {
-                    Layer *layer = layers.at(i);
-
-                    QRegion appliedPlace;
-
-                    if (TileLayer *tileLayer = layer->asTileLayer())
-                        appliedPlace = tileLayer->region();
-                    else if (ObjectGroup *objectGroup = layer->asObjectGroup())
-                        appliedPlace = tileRegionOfObjectGroup(objectGroup);
-                    else
-                        continue;
 
-                    ruleRegionInLayer.append(appliedPlace.intersected(ruleOutputRegion));
-
-                    if (appliedRegions.at(i).intersects(ruleRegionInLayer.at(i).translated(x, y))) {
-                        overlap = true;
-                        break;
-                    }
-                }
+            for (int i = 0; i < translationTable.size(); ++i)
+                appliedRegions[i] += ruleRegionInLayer.at(i).translated(x, y);
+        }
 
-                if (overlap)
-                    continue;
+        copyMapRegion(ruleOutputRegion, QPoint(x, y), translationTable);
+        ret = ret.united(rbr.translated(QPoint(x, y)));
+    };
+
+    if (matches) {
+        // The matches are ordered by row and then by column
+        auto it = std::lower_bound(matches->begin(), matches->end(), offsets.topLeft(),
+                                   rowMajorLess);
+
+        for (; it != matches->end() && it->y() <= offsets.bottom(); ++it)
+            if (it->x() >= offsets.left() && it->x() <= offsets.right())
+                applyAt(it->x(), it->y());
+    } else if (!mCellIndex.isEmpty() && compiledRule.canUseCellIndex()) {
+        // Only check the offsets at which the anchor of the rule finds one
+        // of its cells, in the same order as when checking all offsets
+        const QVector<QPoint> candidates = compiledRule.candidateOffsets(mCellIndex, offsets);
+        std::set<QPoint, bool (*)(QPoint, QPoint)> pending(candidates.begin(),
+                                                           candidates.end(),
+                                                           rowMajorLess);
+
+        // Cells written by earlier rules are already in the candidates
+        mCellIndex.takeChanges();
+
+        while (!pending.empty()) {
+            const QPoint offset = *pending.begin();
+            pending.erase(pending.begin());
+
+            if (!compiledRule.matches(offset))
+                continue;
 
-                for (int i = 0; i < translationTable.size(); ++i)
-                    appliedRegions[i] += ruleRegionInLayer.at(i).translated(x, y);
+            applyAt(offset.x(), offset.y());
+
+            // The cells written by this rule may let it match further on
+            const auto changes = mCellIndex.takeChanges();
+            for (const CellIndex::Change &change : changes) {
+                const auto changeOffsets = compiledRule.candidateOffsets(change.layer,
+                                                                         change.pos,
+                                                                         change.cell);
+                for (const QPoint &changeOffset : changeOffsets)
+                    if (rowMajorLess(offset, changeOffset) && offsets.contains(changeOffset))
+                        pending.insert(changeOffset);
             }
-
-            copyMapRegion(ruleOutputRegion, QPoint(x, y), translationTable);
-            ret = ret.united(rbr.translated(QPoint(x, y)));
         }
+    } else {
+        for (int y = offsets.top(); y <= offsets.bottom(); ++y)
+            for (int x = offsets.left(); x <= offsets.right(); ++x)
+                if (compiledRule.matches(QPoint(x, y)))
+                    applyAt(x, y);
     }
 
     return ret;
@@ -898,7 +879,10 @@ void AutoMapper::copyTileRegion(const TileLayer *srcLayer, QRect rect,
                     xd = wrap(xd, dwidth);
                     yd = wrap(yd, dheight);
                 }
+                if (mJournal)
+                    mJournal->recordCell(dstLayer, xd, yd);
                 dstLayer->setCell(xd, yd, cell);
+                mCellIndex.add(dstLayer, QPoint(xd, yd), cell);
             }
         }
     }
@@ -929,6 +913,9 @@ void AutoMapper::copyObjectRegion(const ObjectGroup *srcLayer, const QRectF &rec
 
 void AutoMapper::cleanAll()
 {
+    mCompiledRules.clear();
+    mCellIndex.clear();
+    mEmptyLayer.reset();
     cleanTilesets();
     cleanTileLayers();
 }
@@ -976,6 +963,7 @@ void AutoMapper::cleanUpRulesMap()
 
     cleanUpRuleMapLayers();
     mRulesInput.clear();
+    mCompiledRules.clear();
     mRulesOutput.clear();
 }
 
@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include "compiledrule.h"
 #include "tileset.h"
 
 #include <QList>
@@ -30,6 +31,7 @@
 #include <QVector>
 
 #include <memory>
+#include <random>
 
 namespace Tiled {
 
@@ -38,32 +40,10 @@ class Map;
 class MapObject;
 class ObjectGroup;
 class TileLayer;
+class TileLayerJournal;
 
 class MapDocument;
 
-struct InputLayer
-{
-    TileLayer *tileLayer;
-    bool strictEmpty;
-};
-
-class InputConditions
-{
-public:
-    QVector<InputLayer> listYes;    // "input"
-    QVector<InputLayer> listNo;     // "inputnot"
-};
-
-// Maps layer names to their conditions
-typedef QMap<QString, InputConditions> InputIndex;
-
-// Maps an index to a group of input layers
-class InputLayers : public QMap<QString, InputIndex>
-{
-public:
-    QSet<QString> names; // all names
-};
-
 class RuleOutput : public QMap<Layer*, int>
 {
 public:
@@ -121,6 +101,12 @@ public:
          * interactive automapping.
          */
         int autoMappingRadius = 0;
+
+        /**
+         * When non-zero, the random choice between multiple outputs is
+         * seeded with this value, so that each run gives the same result.
+         */
+        unsigned randomSeed = 0;
     };
 
     /**
@@ -162,8 +148,11 @@ public:
 
     /**
      * Here is done all the automapping.
+     *
+     * When a \a journal is given, the cells of tile layers are recorded in
+     * it before they are changed.
      */
-    void autoMap(QRegion *where);
+    void autoMap(QRegion *where, TileLayerJournal *journal = nullptr);
 
     /**
      * This cleans all data structures, which are setup via prepareAutoMap,
@@ -227,6 +216,11 @@ private:
      */
     bool setupTilesets();
 
+    /**
+     * Compiles the input rules for matching against the working map.
+     */
+    void setupCompiledRules();
+
     /**
      * Returns the conjunction of all regions of all setlayers.
      */
@@ -272,9 +266,35 @@ private:
      * if there is a match all Layers are copied to mMapWork.
      * @param ruleIndex: the region which should be compared to all positions
      *              of mMapWork will be looked up in mRulesInput and mRulesOutput
+     * @param matches: when given, the rule is applied at these offsets
+     *              instead of matching it again
      * @return a rectangle where the rule actually got applied
      */
-    QRect applyRule(int ruleIndex, const QRect &where);
+    QRect applyRule(int ruleIndex, const QRect &where,
+                    const QVector<QPoint> *matches = nullptr);
+
+    /**
+     * Returns whether the matches of all rules can be found before applying
+     * any of them, which is the case when no output layer is used as input.
+     */
+    bool canMatchInParallel(const QRegion &where) const;
+
+    /**
+     * Finds the matches of each rule within \a where in parallel.
+     */
+    QVector<QVector<QPoint>> findMatches(const QRegion &where) const;
+
+    /**
+     * Returns the number of offsets at which the rules are checked within
+     * \a where.
+     */
+    qint64 matchPositions(const QRegion &where) const;
+
+    /**
+     * Indexes the cells of the input layers, when \a where is large enough
+     * for this to pay off.
+     */
+    void setupCellIndex(const QRegion &where);
 
     /**
      * Cleans up the data structures filled by setupRuleMapLayers(),
@@ -344,6 +364,24 @@ private:
      */
     QVector<QRegion> mRulesInput;
 
+    /**
+     * The input rules compiled against the layers of the working map, with
+     * the same indexes as mRulesInput. Set up by autoMap().
+     */
+    QVector<CompiledRule> mCompiledRules;
+
+    /**
+     * Matched in place of input layers missing from the working map.
+     */
+    std::unique_ptr<TileLayer> mEmptyLayer;
+
+    /**
+     * The positions of the cells in the input layers, used to find the
+     * offsets at which a rule may match when the rules are applied one
+     * after the other. Empty unless set up by autoMap().
+     */
+    CellIndex mCellIndex;
+
     /**
      * List of regions in mMapRules to know where the output of a
      * rule is.
@@ -376,6 +414,16 @@ private:
 
     Options mOptions;
 
+    /**
+     * Where changes to tile layers are recorded during autoMap().
+     */
+    TileLayerJournal *mJournal = nullptr;
+
+    /**
+     * Chooses between multiple outputs, seeded for each autoMap() call.
+     */
+    std::default_random_engine mRandomEngine;
+
     QSet<QString> mTouchedTileLayers;
     QSet<QString> mTouchedObjectGroups;
 
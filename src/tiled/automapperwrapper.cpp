@@ -24,6 +24,7 @@
 #include "mapdocument.h"
 #include "tile.h"
 #include "tilelayer.h"
+#include "tilelayerjournal.h"
 
 #include "qtcompat_p.h"
 
@@ -34,60 +35,41 @@ AutoMapperWrapper::AutoMapperWrapper(MapDocument *mapDocument,
                                      QRegion *where)
 {
     mMapDocument = mapDocument;
-    Map *map = mMapDocument->map();
 
-    QSet<QString> touchedTileLayers;
     int index = 0;
     while (index < autoMappers.size()) {
         AutoMapper *a = autoMappers.at(index);
-        if (a->prepareAutoMap()) {
-            touchedTileLayers |= a->touchedTileLayers();
+        if (a->prepareAutoMap())
             index++;
-        } else {
+        else
             autoMappers.remove(index);
-        }
-    }
-    for (const QString &layerName : qAsConst(touchedTileLayers)) {
-        const int layerIndex = map->indexOfLayer(layerName, Layer::TileLayerType);
-        Q_ASSERT(layerIndex != -1);
-        auto clone = std::unique_ptr<TileLayer>(static_cast<TileLayer*>(map->layerAt(layerIndex)->clone()));
-        mLayersBefore.push_back(std::move(clone));
     }
 
+    TileLayerJournal journal;
+
     for (AutoMapper *a : autoMappers)
-        a->autoMap(where);
+        a->autoMap(where, &journal);
+
+    auto changes = journal.changes();
 
-    int beforeIndex = 0;
-    for (const QString &layerName : qAsConst(touchedTileLayers)) {
-        const int layerIndex = map->indexOfLayer(layerName, Layer::TileLayerType);
-        // layer index exists, because AutoMapper is still alive, don't check
-        Q_ASSERT(layerIndex != -1);
-        auto &before = mLayersBefore[beforeIndex];
-        TileLayer *after = static_cast<TileLayer*>(map->layerAt(layerIndex));
+    for (TileLayerJournal::Change &change : changes) {
+        TileLayer *after = change.layer;
 
         MapDocument::TileLayerChangeFlags flags;
 
-        if (before->drawMargins() != after->drawMargins())
+        if (change.drawMarginsBefore != after->drawMargins())
             flags |= MapDocument::LayerDrawMarginsChanged;
-        if (before->bounds() != after->bounds())
+        if (change.boundsBefore != after->bounds())
             flags |= MapDocument::LayerBoundsChanged;
 
         if (flags)
             emit mMapDocument->tileLayerChanged(after, flags);
 
-        // reduce memory usage by saving only diffs
-        QRect diffRegion = before->computeDiffRegion(after).boundingRect();
-        auto before1 = before->copy(diffRegion);
-        auto after1 = after->copy(diffRegion);
-
-        before1->setPosition(diffRegion.topLeft());
-        after1->setPosition(diffRegion.topLeft());
-        before1->setName(before->name());
-        after1->setName(after->name());
-        mLayersBefore[beforeIndex] = std::move(before1);
-        mLayersAfter.push_back(std::move(after1));
-
-        ++beforeIndex;
+        mLayerChanges.push_back(LayerChange {
+                                    change.region,
+                                    std::move(change.before),
+                                    std::move(change.after)
+                                });
     }
 
     for (AutoMapper *a : autoMappers)
@@ -101,24 +83,43 @@ AutoMapperWrapper::~AutoMapperWrapper()
 void AutoMapperWrapper::undo()
 {
     Map *map = mMapDocument->map();
-    for (auto &layer : qAsConst(mLayersBefore)) {
-        const int layerIndex = map->indexOfLayer(layer->name(), Layer::TileLayerType);
+    for (const LayerChange &change : mLayerChanges) {
+        const int layerIndex = map->indexOfLayer(change.before->name(), Layer::TileLayerType);
         if (layerIndex != -1)
-            patchLayer(layerIndex, *layer);
+            patchLayer(layerIndex, *change.before, change.region);
     }
 }
 
 void AutoMapperWrapper::redo()
 {
     Map *map = mMapDocument->map();
-    for (auto &layer : qAsConst(mLayersAfter)) {
-        const int layerIndex = map->indexOfLayer(layer->name(), Layer::TileLayerType);
+    for (const LayerChange &change : mLayerChanges) {
+        const int layerIndex = map->indexOfLayer(change.after->name(), Layer::TileLayerType);
         if (layerIndex != -1)
-            patchLayer(layerIndex, *layer);
+            patchLayer(layerIndex, *change.after, change.region);
     }
 }
 
-void AutoMapperWrapper::patchLayer(int layerIndex, const TileLayer &layer)
+qint64 AutoMapperWrapper::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const LayerChange &change : mLayerChanges) {
+        usage += tileLayerMemoryUsage(change.before.get());
+        usage += tileLayerMemoryUsage(change.after.get());
+        usage += change.region.rectCount() * sizeof(QRect);
+    }
+
+    return usage;
+}
+
+void AutoMapperWrapper::releaseMemory()
+{
+    mLayerChanges.clear();
+}
+
+void AutoMapperWrapper::patchLayer(int layerIndex, const TileLayer &layer,
+                                   const QRegion &region)
 {
     Map *map = mMapDocument->map();
     QRect b = layer.rect();
@@ -129,6 +130,6 @@ void AutoMapperWrapper::patchLayer(int layerIndex, const TileLayer &layer)
     t->setCells(b.left() - t->x(),
                 b.top() - t->y(),
                 &layer,
-                b.translated(-t->position()));
-    emit mMapDocument->regionChanged(b, t);
+                region.translated(-t->position()));
+    emit mMapDocument->regionChanged(region, t);
 }
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "automapper.h"
+#include "undocommands.h"
 
 #include <QUndoCommand>
 #include <QVector>
@@ -35,10 +36,11 @@ class MapDocument;
  * This is a wrapper class for the AutoMapper class.
  * Here in this class only undo/redo functionality all rulemaps
  * is provided.
- * This class will take a snapshot of the layers before and after the
- * automapping is done. In between instances of AutoMapper are doing the work.
+ * The instances of AutoMapper record the cells they are about to change in
+ * a TileLayerJournal, from which this class keeps the changed cells before
+ * and after the automapping.
  */
-class AutoMapperWrapper : public QUndoCommand
+class AutoMapperWrapper : public QUndoCommand, public MemoryReportingUndoCommand
 {
 public:
     AutoMapperWrapper(MapDocument *mapDocument,
@@ -49,12 +51,21 @@ public:
     void undo() override;
     void redo() override;
 
+    qint64 memoryUsage() const override;
+    void releaseMemory() override;
+
 private:
-    void patchLayer(int layerIndex, const TileLayer &layer);
+    struct LayerChange
+    {
+        QRegion region;
+        std::unique_ptr<TileLayer> before;
+        std::unique_ptr<TileLayer> after;
+    };
+
+    void patchLayer(int layerIndex, const TileLayer &layer, const QRegion &region);
 
     MapDocument *mMapDocument;
-    std::vector<std::unique_ptr<TileLayer>> mLayersAfter;
-    std::vector<std::unique_ptr<TileLayer>> mLayersBefore;
+    std::vector<LayerChange> mLayerChanges;
 };
 
 } // namespace Tiled
@@ -0,0 +1,439 @@
+/*
+ * batchexporter.cpp
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchexporter.h"
+
+#include "exporthelper.h"
+#include "imagelayer.h"
+#include "map.h"
+#include "mapformat.h"
+#include "objecttemplate.h"
+#include "tile.h"
+#include "utils.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "qtcompat_p.h"
+
+using namespace Tiled;
+
+static const char jobsVariable[] = "TILED_EXPORT_JOBS";
+
+// The number of external tilesets kept loaded in between maps
+static const std::size_t recentTilesetLimit = 64;
+
+/**
+ * Returns the number of processes to use, which defaults to the number of
+ * cores and can be overridden by setting TILED_EXPORT_JOBS.
+ */
+static int jobCount()
+{
+    bool ok;
+    const int jobs = qEnvironmentVariableIntValue(jobsVariable, &ok);
+    if (ok && jobs > 0)
+        return jobs;
+
+    return qMax(1, QThread::idealThreadCount());
+}
+
+static bool isWildcardPattern(const QString &fileName)
+{
+    return fileName.contains(QLatin1Char('*')) ||
+            fileName.contains(QLatin1Char('?')) ||
+            fileName.contains(QLatin1Char('['));
+}
+
+/**
+ * Returns the files the export of \a map depends on, apart from the map
+ * file itself.
+ */
+static QStringList dependencies(const Map &map, Preferences::ExportOptions options)
+{
+    QStringList fileNames;
+
+    auto addSource = [&] (const QUrl &url) {
+        if (url.isLocalFile())
+            fileNames.append(url.toLocalFile());
+    };
+
+    auto addTileset = [&] (const Tileset &tileset) {
+        if (tileset.isExternal())
+            fileNames.append(tileset.fileName());
+
+        addSource(tileset.imageSource());
+        for (const Tile *tile : tileset.tiles())
+            addSource(tile->imageSource());
+    };
+
+    for (const SharedTileset &tileset : map.tilesets())
+        addTileset(*tileset);
+
+    const auto usedTemplates = map.usedTemplates();
+    for (const ObjectTemplate *objectTemplate : usedTemplates) {
+        if (!objectTemplate->fileName().isEmpty())
+            fileNames.append(objectTemplate->fileName());
+        if (const SharedTileset &tileset = objectTemplate->tileset())
+            addTileset(*tileset);
+    }
+
+    for (Layer *layer : map.allLayers())
+        if (ImageLayer *imageLayer = layer->asImageLayer())
+            addSource(imageLayer->imageSource());
+
+    if (options.testFlag(Preferences::ResolveObjectTypesAndProperties))
+        fileNames.append(Preferences::instance()->objectTypesFile());
+
+    fileNames.removeDuplicates();
+    return fileNames;
+}
+
+static QStringList exportOptionArguments(Preferences::ExportOptions options)
+{
+    QStringList arguments;
+
+    if (options.testFlag(Preferences::EmbedTilesets))
+        arguments.append(QStringLiteral("--embed-tilesets"));
+    if (options.testFlag(Preferences::DetachTemplateInstances))
+        arguments.append(QStringLiteral("--detach-templates"));
+    if (options.testFlag(Preferences::ResolveObjectTypesAndProperties))
+        arguments.append(QStringLiteral("--resolve-types-and-properties"));
+    if (options.testFlag(Preferences::ExportMinimized))
+        arguments.append(QStringLiteral("--minimize"));
+
+    return arguments;
+}
+
+BatchExporter::BatchExporter(MapFormat *format,
+                             const QString &targetDirectory,
+                             Preferences::ExportOptions options)
+    : mFormat(format)
+    , mTargetDirectory(QDir(targetDirectory).absolutePath())
+    , mOptions(options)
+{
+}
+
+int BatchExporter::exportMaps(const QStringList &sources)
+{
+    const QStringList fileNames = expandSources(sources);
+    if (fileNames.isEmpty()) {
+        qWarning().noquote() << tr("No maps to export.");
+        return 1;
+    }
+
+    // Maps with the same name would overwrite each other's output
+    QHash<QString, QString> targetFiles;
+    for (const QString &fileName : fileNames) {
+        const QString targetFile = targetFileName(fileName);
+        if (targetFiles.contains(targetFile)) {
+            qWarning().noquote() << tr("Both '%1' and '%2' would be exported to '%3'.")
+                                    .arg(targetFiles.value(targetFile), fileName, targetFile);
+            return 1;
+        }
+        targetFiles.insert(targetFile, fileName);
+    }
+
+    if (!QDir().mkpath(mTargetDirectory)) {
+        qWarning().noquote() << tr("Failed to create target directory '%1'.").arg(mTargetDirectory);
+        return 1;
+    }
+
+    const int jobs = qMin(jobCount(), fileNames.size());
+    if (jobs > 1)
+        return runJobs(fileNames, jobs);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int failedCount = 0;
+    for (const QString &fileName : fileNames)
+        if (!exportMap(fileName))
+            ++failedCount;
+
+    qInfo().noquote() << tr("Exported %1, skipped %2 and failed %3 maps in %4 ms.")
+                         .arg(mExportedCount)
+                         .arg(mSkippedCount)
+                         .arg(failedCount)
+                         .arg(timer.elapsed());
+
+    return failedCount > 0 ? 1 : 0;
+}
+
+/**
+ * Expands wildcard patterns and files listing maps into the list of maps to
+ * export, with absolute file names. Sources naming an existing file are
+ * taken literally, even when they contain wildcard characters.
+ */
+QStringList BatchExporter::expandSources(const QStringList &sources) const
+{
+    QStringList fileNames;
+
+    for (const QString &source : sources) {
+        if (source.startsWith(QLatin1Char('@'))) {
+            const QString listFileName = source.mid(1);
+            QFile file(listFileName);
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                qWarning().noquote() << tr("Failed to read '%1'.").arg(listFileName);
+                continue;
+            }
+
+            // Sources in the list are relative to its location
+            const QDir dir = QFileInfo(listFileName).dir();
+            const QStringList lines = QString::fromUtf8(file.readAll()).split(QLatin1Char('\n'));
+
+            // Listed file names are taken literally, since they may contain
+            // characters that would otherwise be taken as a wildcard
+            for (const QString &line : lines) {
+                const QString trimmed = line.trimmed();
+                if (!trimmed.isEmpty() && !trimmed.startsWith(QLatin1Char('#')))
+                    fileNames.append(dir.absoluteFilePath(trimmed));
+            }
+        } else if (isWildcardPattern(source) && !QFileInfo::exists(source)) {
+            const QFileInfo fileInfo(source);
+            const QDir dir = fileInfo.dir();
+            const auto entries = dir.entryInfoList(QStringList(fileInfo.fileName()),
+                                                   QDir::Files, QDir::Name);
+            if (entries.isEmpty())
+                qWarning().noquote() << tr("No files match '%1'.").arg(source);
+
+            for (const QFileInfo &entry : entries)
+                fileNames.append(entry.absoluteFilePath());
+        } else {
+            fileNames.append(QFileInfo(source).absoluteFilePath());
+        }
+    }
+
+    fileNames.removeDuplicates();
+    return fileNames;
+}
+
+QString BatchExporter::targetFileName(const QString &fileName) const
+{
+    const QString extension = Utils::firstExtension(mFormat->nameFilter());
+    return QDir(mTargetDirectory).filePath(QFileInfo(fileName).completeBaseName() + extension);
+}
+
+/**
+ * Divides the maps over \a jobCount processes, which are started with
+ * the same format and options. Maps that follow each other are exported by
+ * the same process, since they are likely to share tilesets.
+ */
+int BatchExporter::runJobs(const QStringList &fileNames, int jobCount) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const int mapsPerJob = (fileNames.size() + jobCount - 1) / jobCount;
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QLatin1String(jobsVariable), QStringLiteral("1"));
+
+    std::vector<std::unique_ptr<QTemporaryFile>> listFiles;
+    std::vector<std::unique_ptr<QProcess>> processes;
+
+    for (int first = 0; first < fileNames.size(); first += mapsPerJob) {
+        auto listFile = std::make_unique<QTemporaryFile>();
+        if (!listFile->open()) {
+            qWarning().noquote() << tr("Failed to create temporary file.");
+            return 1;
+        }
+
+        const QStringList jobFileNames = fileNames.mid(first, mapsPerJob);
+        listFile->write(jobFileNames.join(QLatin1Char('\n')).toUtf8());
+        listFile->close();
+
+        QStringList arguments = exportOptionArguments(mOptions);
+        arguments << QStringLiteral("--export-maps")
+                  << mFormat->shortName()
+                  << mTargetDirectory
+                  << QStringLiteral("@") + listFile->fileName();
+
+        auto process = std::make_unique<QProcess>();
+        process->setProcessChannelMode(QProcess::ForwardedChannels);
+        process->setProcessEnvironment(environment);
+        process->start(QCoreApplication::applicationFilePath(), arguments);
+
+        listFiles.push_back(std::move(listFile));
+        processes.push_back(std::move(process));
+    }
+
+    bool success = true;
+
+    for (const auto &process : processes) {
+        process->waitForFinished(-1);
+
+        if (process->error() == QProcess::FailedToStart ||
+                process->exitStatus() != QProcess::NormalExit ||
+                process->exitCode() != 0) {
+            success = false;
+        }
+    }
+
+    qInfo().noquote() << tr("Processed %1 maps using %2 processes in %3 ms.")
+                         .arg(fileNames.size())
+                         .arg(processes.size())
+                         .arg(timer.elapsed());
+
+    return success ? 0 : 1;
+}
+
+bool BatchExporter::exportMap(const QString &fileName)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString targetFile = targetFileName(fileName);
+    if (isUpToDate(fileName, targetFile)) {
+        qInfo().noquote() << tr("Skipped '%1', which is up to date.").arg(fileName);
+        ++mSkippedCount;
+        return true;
+    }
+
+    QString error;
+    const std::unique_ptr<Map> sourceMap = readMap(fileName, &error);
+    if (!sourceMap) {
+        qWarning().noquote() << tr("Failed to load '%1': %2").arg(fileName, error);
+        return false;
+    }
+
+    keepTilesets(*sourceMap);
+
+    // Make sure a failed export is not considered up to date
+    QFile::remove(stampFileName(targetFile));
+
+    // Apply export options
+    std::unique_ptr<Map> exportMap;
+    ExportHelper exportHelper(mOptions);
+    const Map *map = exportHelper.prepareExportMap(sourceMap.get(), exportMap);
+
+    if (!mFormat->write(map, targetFile, exportHelper.formatOptions())) {
+        qWarning().noquote() << tr("Failed to export '%1': %2").arg(fileName, mFormat->errorString());
+        return false;
+    }
+
+    writeStamp(fileName, targetFile, dependencies(*sourceMap, mOptions));
+
+    qInfo().noquote() << tr("Exported '%1' in %2 ms.").arg(fileName).arg(timer.elapsed());
+    ++mExportedCount;
+    return true;
+}
+
+QString BatchExporter::stampFileName(const QString &targetFile) const
+{
+    return QDir(mTargetDirectory).filePath(QLatin1String(".tiled-export/") +
+                                           QFileInfo(targetFile).fileName() +
+                                           QLatin1String(".deps"));
+}
+
+/**
+ * Returns a line identifying the source map, the format and the export
+ * options, which all need to match for an earlier export to be up to date.
+ */
+QString BatchExporter::exportSignature(const QString &fileName) const
+{
+    QStringList parts(fileName);
+    parts.append(mFormat->shortName());
+    parts.append(exportOptionArguments(mOptions));
+    return parts.join(QLatin1Char(' '));
+}
+
+/**
+ * Returns whether \a targetFile was exported from \a fileName with the
+ * current format and options, after the map and the files listed in its
+ * stamp file were last changed.
+ */
+bool BatchExporter::isUpToDate(const QString &fileName, const QString &targetFile) const
+{
+    const QFileInfo targetInfo(targetFile);
+    if (!targetInfo.exists())
+        return false;
+
+    QFile stampFile(stampFileName(targetFile));
+    if (!stampFile.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QStringList fileNames = QString::fromUtf8(stampFile.readAll()).split(QLatin1Char('\n'),
+                                                                        QString::SkipEmptyParts);
+    if (fileNames.isEmpty() || fileNames.takeFirst() != exportSignature(fileName))
+        return false;
+
+    fileNames.append(fileName);
+
+    // Missing files are considered changed, since they were there before
+    const QDateTime exported = targetInfo.lastModified();
+    return std::all_of(fileNames.cbegin(), fileNames.cend(), [&] (const QString &dependency) {
+        const QFileInfo info(dependency);
+        return info.exists() && info.lastModified() <= exported;
+    });
+}
+
+void BatchExporter::writeStamp(const QString &fileName,
+                               const QString &targetFile,
+                               const QStringList &dependencies) const
+{
+    const QString stampFileName = this->stampFileName(targetFile);
+    if (!QDir().mkpath(QFileInfo(stampFileName).path()))
+        return;
+
+    // When the stamp can't be written, the map is exported again next time
+    QFile stampFile(stampFileName);
+    if (!stampFile.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        return;
+
+    QStringList lines(exportSignature(fileName));
+    lines.append(dependencies);
+    stampFile.write(lines.join(QLatin1Char('\n')).toUtf8());
+}
+
+/**
+ * Keeps the external tilesets used by \a map loaded, so that the
+ * TilesetManager can hand them out again to the following maps. Only the
+ * most recently used tilesets are kept, to bound the memory used by a long
+ * list of maps.
+ */
+void BatchExporter::keepTilesets(const Map &map)
+{
+    for (const SharedTileset &tileset : map.tilesets()) {
+        // Failed tilesets are not kept, since they are only a placeholder
+        if (!tileset->isExternal() || tileset->status() == LoadingError)
+            continue;
+
+        auto it = std::find(mRecentTilesets.begin(), mRecentTilesets.end(), tileset);
+        if (it != mRecentTilesets.end())
+            mRecentTilesets.erase(it);
+
+        mRecentTilesets.push_front(tileset);
+    }
+
+    while (mRecentTilesets.size() > recentTilesetLimit)
+        mRecentTilesets.pop_back();
+}
@@ -0,0 +1,93 @@
+/*
+ * batchexporter.h
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "preferences.h"
+#include "tileset.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <deque>
+
+namespace Tiled {
+
+class Map;
+class MapFormat;
+
+/**
+ * Exports a list of maps to a target directory, as done by the
+ * --export-maps command-line option.
+ *
+ * The maps are divided over a number of worker processes, each of which
+ * exports its share of the maps one after the other. Maps that were exported
+ * after they and the files they depend on were last changed are skipped. The
+ * files each map depends on are remembered in a stamp file in the
+ * ".tiled-export" directory within the target directory, so that they can be
+ * checked without loading the map.
+ *
+ * The most recently used external tilesets are kept loaded, so that the maps
+ * exported by the same process can share them.
+ */
+class BatchExporter
+{
+    Q_DECLARE_TR_FUNCTIONS(BatchExporter)
+
+public:
+    BatchExporter(MapFormat *format,
+                  const QString &targetDirectory,
+                  Preferences::ExportOptions options);
+
+    /**
+     * Exports the maps given by \a sources, which can be file names,
+     * wildcard patterns or a file listing map file names when prefixed
+     * with '@'.
+     *
+     * Returns the exit code for the application.
+     */
+    int exportMaps(const QStringList &sources);
+
+private:
+    QStringList expandSources(const QStringList &sources) const;
+    QString targetFileName(const QString &fileName) const;
+    QString stampFileName(const QString &targetFile) const;
+    QString exportSignature(const QString &fileName) const;
+
+    bool isUpToDate(const QString &fileName, const QString &targetFile) const;
+    void writeStamp(const QString &fileName, const QString &targetFile,
+                    const QStringList &dependencies) const;
+
+    int runJobs(const QStringList &fileNames, int jobCount) const;
+    bool exportMap(const QString &fileName);
+    void keepTilesets(const Map &map);
+
+    MapFormat *mFormat;
+    QString mTargetDirectory;
+    Preferences::ExportOptions mOptions;
+
+    // Most recently used first
+    std::deque<SharedTileset> mRecentTilesets;
+
+    int mExportedCount = 0;
+    int mSkippedCount = 0;
+};
+
+} // namespace Tiled
@@ -0,0 +1,442 @@
+/*
+ * compiledrule.cpp
+ * Copyright 2010-2012, Stefan Beller, stefanbeller@googlemail.com
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "compiledrule.h"
+
+#include "map.h"
+
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <climits>
+
+#include "qtcompat_p.h"
+
+using namespace Tiled;
+
+static int wrap(int value, int bound)
+{
+    return (value % bound + bound) % bound;
+}
+
+/**
+ * Appends \a cell to \a cells, unless it is already present after \a begin.
+ */
+static void appendUnique(QVector<Cell> &cells, int begin, const Cell &cell)
+{
+    for (int i = begin; i < cells.size(); ++i)
+        if (cells.at(i) == cell)
+            return;
+
+    cells.append(cell);
+}
+
+/**
+ * Indexes the non-empty cells of \a layer.
+ */
+void CellIndex::addLayer(const TileLayer *layer)
+{
+    auto &positions = mPositions[layer];
+
+    // The region includes the position of the layer, unlike cellAt()
+    const QRegion region = layer->region().translated(-layer->position());
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+            for (int x = rect.left(); x <= rect.right(); ++x)
+                positions[layer->cellAt(x, y)].append(QPoint(x, y));
+    }
+}
+
+/**
+ * Adds \a cell at \a pos, when \a layer is indexed.
+ */
+void CellIndex::add(const TileLayer *layer, QPoint pos, const Cell &cell)
+{
+    auto it = mPositions.find(layer);
+    if (it == mPositions.end() || cell.isEmpty())
+        return;
+
+    it.value()[cell].append(pos);
+    mChanges.append(Change { layer, pos, cell });
+}
+
+void CellIndex::clear()
+{
+    mPositions.clear();
+    mChanges.clear();
+}
+
+QVector<QPoint> CellIndex::positions(const TileLayer *layer, const Cell &cell) const
+{
+    return mPositions.value(layer).value(cell);
+}
+
+QVector<CellIndex::Change> CellIndex::takeChanges()
+{
+    QVector<Change> changes;
+    changes.swap(mChanges);
+    return changes;
+}
+
+static bool rowMajorLess(QPoint a, QPoint b)
+{
+    return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+}
+
+/**
+ * Compiles the conditions of the input layers into a flat list of positions,
+ * following the rules documented below.
+ *
+ * In this function a certain region (of the set layer) is compared to
+ * several other layers (ruleSet and ruleNotSet).
+ *
+ * Basically all matches between setLayer and a layer of listYes are considered
+ * good, while all matches between setLayer and listNo are considered bad and
+ * lead to canceling the comparison.
+ *
+ * Now there are several cases to distinguish:
+ *  - both listYes and listNo are empty:
+ *      This should not happen, because with that configuration, absolutely
+ *      no condition is given. The conditions never match, assuming this is
+ *      an errornous rule.
+ *
+ *  - both listYes and listNo are not empty:
+ *      When comparing a tile at a certain position of tile layer setLayer
+ *      to all available tiles in listYes, there must be at least
+ *      one layer, in which there is a match of tiles of setLayer and
+ *      listYes to consider this position good.
+ *      In listNo there must not be a match to consider this position
+ *      good.
+ *      If there are no tiles within all available tiles within all layers
+ *      of one list, all tiles in setLayer are considered good,
+ *      while inspecting this list.
+ *
+ *  - either of both lists are not empty
+ *      When comparing a certain position of tile layer setLayer
+ *      to all Tiles at the corresponding position this can happen:
+ *      A tile of setLayer matches a tile of a layer in the list. Then this
+ *      is considered as good, if the layer is from the listYes.
+ *      Otherwise it is considered bad.
+ *
+ *      Exception, when having only the listYes:
+ *      if at the examined position there are no tiles within all Layers
+ *      of the listYes, all tiles except all used tiles within
+ *      the layers of that list are considered good.
+ *
+ *      This exception was added to have a better functionality
+ *      (need of less layers.)
+ *      It was not added to the case, when having only listNo layers to
+ *      avoid total symmetry between those lists.
+ *      It can be turned off by setting the StrictEmpty property on the input
+ *      layer.
+ */
+CompiledRule::CompiledRule(const InputLayers &inputLayers,
+                           const QRegion &inputRegion,
+                           const Map &map,
+                           const TileLayer *emptyLayer,
+                           const MatchOptions &options)
+    : mOptions(options)
+{
+    for (const InputIndex &inputIndex : inputLayers) {
+        Alternative alternative;
+        int anchorCandidates = INT_MAX;
+        bool neverMatches = false;
+
+        for (auto it = inputIndex.begin(), end = inputIndex.end(); it != end; ++it) {
+            const InputConditions &conditions = it.value();
+            const auto &listYes = conditions.listYes;
+            const auto &listNo = conditions.listNo;
+
+            if (listYes.isEmpty() && listNo.isEmpty()) {
+                neverMatches = true;
+                break;
+            }
+
+            Condition condition;
+
+            const int index = map.indexOfLayer(it.key(), Layer::TileLayerType);
+            condition.setLayer = index >= 0 ? map.layerAt(index)->asTileLayer() : emptyLayer;
+            condition.hasListNo = !listNo.isEmpty();
+
+#if QT_VERSION < 0x050800
+            const auto rects = inputRegion.rects();
+            for (const QRect &rect : rects) {
+#else
+            for (const QRect &rect : inputRegion) {
+#endif
+                for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                    for (int x = rect.left(); x <= rect.right(); ++x) {
+                        Position position;
+                        position.pos = QPoint(x, y);
+                        position.noBegin = condition.cells.size();
+
+                        for (const InputLayer &inputNotLayer : listNo) {
+                            const Cell &noCell = inputNotLayer.tileLayer->cellAt(x, y);
+                            if (inputNotLayer.strictEmpty || !noCell.isEmpty())
+                                appendUnique(condition.cells, position.noBegin, noCell);
+                        }
+
+                        position.yesBegin = condition.cells.size();
+
+                        for (const InputLayer &inputLayer : listYes) {
+                            const Cell &yesCell = inputLayer.tileLayer->cellAt(x, y);
+                            if (inputLayer.strictEmpty || !yesCell.isEmpty())
+                                appendUnique(condition.cells, position.yesBegin, yesCell);
+
+                            if (!condition.hasListNo)
+                                appendUnique(condition.usedCells, 0, yesCell);
+                        }
+
+                        position.yesEnd = condition.cells.size();
+
+                        // The position accepting the fewest cells is the
+                        // most likely to reject a match
+                        const int candidates = position.yesEnd - position.yesBegin;
+                        if (candidates > 0 && candidates < anchorCandidates) {
+                            anchorCandidates = candidates;
+                            alternative.anchorCondition = alternative.conditions.size();
+                            alternative.anchorPosition = condition.positions.size();
+                        }
+
+                        condition.positions.append(position);
+                    }
+                }
+            }
+
+            alternative.conditions.append(condition);
+        }
+
+        if (!neverMatches)
+            mAlternatives.append(alternative);
+    }
+}
+
+bool CompiledRule::matches(QPoint offset) const
+{
+    for (const Alternative &alternative : mAlternatives) {
+        if (alternative.anchorCondition != -1) {
+            const Condition &condition = alternative.conditions.at(alternative.anchorCondition);
+            if (!matches(condition, condition.positions.at(alternative.anchorPosition), offset))
+                continue;
+        }
+
+        bool allConditionsMatch = true;
+
+        for (const Condition &condition : alternative.conditions) {
+            for (const Position &position : condition.positions) {
+                if (!matches(condition, position, offset)) {
+                    allConditionsMatch = false;
+                    break;
+                }
+            }
+
+            if (!allConditionsMatch)
+                break;
+        }
+
+        if (allConditionsMatch)
+            return true;
+    }
+
+    return false;
+}
+
+QVector<QPoint> CompiledRule::matchesIn(const QRegion &offsets) const
+{
+    QVector<QPoint> result;
+
+#if QT_VERSION < 0x050800
+    const auto rects = offsets.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : offsets) {
+#endif
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+            for (int x = rect.left(); x <= rect.right(); ++x)
+                if (matches(QPoint(x, y)))
+                    result.append(QPoint(x, y));
+    }
+
+    // A band of the region can consist of multiple rects
+    std::sort(result.begin(), result.end(), rowMajorLess);
+
+    return result;
+}
+
+namespace {
+
+struct MatchTask
+{
+    int ruleIndex;
+    QRegion offsets;
+    QVector<QPoint> matches;
+};
+
+} // anonymous namespace
+
+QVector<QVector<QPoint>> CompiledRule::matchesIn(const QVector<CompiledRule> &rules,
+                                                 const QVector<QRegion> &offsets)
+{
+    Q_ASSERT(rules.size() == offsets.size());
+
+    constexpr int bandHeight = 16;
+
+    QVector<MatchTask> tasks;
+    for (int i = 0; i < rules.size(); ++i) {
+        const QRegion &ruleOffsets = offsets.at(i);
+        const QRect bounds = ruleOffsets.boundingRect();
+
+        for (int y = bounds.top(); y <= bounds.bottom(); y += bandHeight) {
+            const QRect band(bounds.left(), y, bounds.width(), bandHeight);
+            tasks.append(MatchTask { i, ruleOffsets.intersected(band), QVector<QPoint>() });
+        }
+    }
+
+    QtConcurrent::blockingMap(tasks, [&] (MatchTask &task) {
+        task.matches = rules.at(task.ruleIndex).matchesIn(task.offsets);
+    });
+
+    // The bands of each rule are in order, so their matches can be joined
+    QVector<QVector<QPoint>> result(rules.size());
+    for (const MatchTask &task : qAsConst(tasks))
+        result[task.ruleIndex] += task.matches;
+
+    return result;
+}
+
+bool CompiledRule::canUseCellIndex() const
+{
+    // Positions outside of the layer may refer to cells inside of it
+    if (mOptions.wrapBorder || mOptions.overflowBorder)
+        return false;
+
+    for (const Alternative &alternative : mAlternatives) {
+        if (alternative.anchorCondition == -1)
+            return false;
+
+        const Condition &condition = alternative.conditions.at(alternative.anchorCondition);
+        const Position &position = condition.positions.at(alternative.anchorPosition);
+
+        for (int i = position.yesBegin; i < position.yesEnd; ++i)
+            if (condition.cells.at(i).isEmpty())
+                return false;
+    }
+
+    return true;
+}
+
+QVector<QPoint> CompiledRule::candidateOffsets(const CellIndex &index,
+                                               const QRect &offsets) const
+{
+    Q_ASSERT(canUseCellIndex());
+
+    QVector<QPoint> result;
+
+    for (const Alternative &alternative : mAlternatives) {
+        const Condition &condition = alternative.conditions.at(alternative.anchorCondition);
+        const Position &position = condition.positions.at(alternative.anchorPosition);
+
+        for (int i = position.yesBegin; i < position.yesEnd; ++i) {
+            const auto positions = index.positions(condition.setLayer, condition.cells.at(i));
+            for (const QPoint &pos : positions) {
+                const QPoint offset = pos - position.pos;
+                if (offsets.contains(offset))
+                    result.append(offset);
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end(), rowMajorLess);
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+QVector<QPoint> CompiledRule::candidateOffsets(const TileLayer *layer, QPoint pos,
+                                               const Cell &cell) const
+{
+    QVector<QPoint> result;
+
+    for (const Alternative &alternative : mAlternatives) {
+        const Condition &condition = alternative.conditions.at(alternative.anchorCondition);
+        if (condition.setLayer != layer)
+            continue;
+
+        const Position &position = condition.positions.at(alternative.anchorPosition);
+        const Cell *begin = condition.cells.constData() + position.yesBegin;
+        const Cell *end = condition.cells.constData() + position.yesEnd;
+
+        if (std::find(begin, end, cell) != end)
+            result.append(pos - position.pos);
+    }
+
+    return result;
+}
+
+bool CompiledRule::matches(const Condition &condition,
+                           const Position &position,
+                           QPoint offset) const
+{
+    const TileLayer &setLayer = *condition.setLayer;
+
+    int x = position.pos.x() + offset.x();
+    int y = position.pos.y() + offset.y();
+
+    if (!mOptions.matchOutsideMap && !setLayer.contains(x, y))
+        return false;
+
+    // Those two options are guaranteed to be false if the map is infinite,
+    // so no "invalid" width/height accessing here.
+    if (mOptions.wrapBorder) {
+        x = wrap(x, setLayer.width());
+        y = wrap(y, setLayer.height());
+    } else if (mOptions.overflowBorder) {
+        x = qBound(0, x, setLayer.width() - 1);
+        y = qBound(0, y, setLayer.height() - 1);
+    }
+
+    const Cell &setCell = setLayer.cellAt(x, y);
+    const Cell *cells = condition.cells.constData();
+
+    // First check listNo. If any tile matches there, we can immediately know
+    // there is no match.
+    for (int i = position.noBegin; i < position.yesBegin; ++i)
+        if (setCell == cells[i])
+            return false;
+
+    // When no tile is given by any "input" layer at this position, consider
+    // all tiles not used elsewhere in the input as valid (only when there are
+    // no "inputnot" layers).
+    if (position.yesBegin == position.yesEnd)
+        return condition.hasListNo || !condition.usedCells.contains(setCell);
+
+    for (int i = position.yesBegin; i < position.yesEnd; ++i)
+        if (setCell == cells[i])
+            return true;
+
+    return false;
+}
@@ -0,0 +1,224 @@
+/*
+ * compiledrule.h
+ * Copyright 2010-2012, Stefan Beller, stefanbeller@googlemail.com
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "tilelayer.h"
+
+#include <QHash>
+#include <QMap>
+#include <QPoint>
+#include <QRegion>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+namespace Tiled {
+
+class Map;
+
+struct InputLayer
+{
+    TileLayer *tileLayer;
+    bool strictEmpty;
+};
+
+class InputConditions
+{
+public:
+    QVector<InputLayer> listYes;    // "input"
+    QVector<InputLayer> listNo;     // "inputnot"
+};
+
+// Maps layer names to their conditions
+typedef QMap<QString, InputConditions> InputIndex;
+
+// Maps an index to a group of input layers
+class InputLayers : public QMap<QString, InputIndex>
+{
+public:
+    QSet<QString> names; // all names
+};
+
+inline uint qHash(const Cell &cell, uint seed = 0) Q_DECL_NOTHROW
+{
+    // The flags are left out, since not all of them are compared
+    return qHash(qMakePair(cell.tileset(), cell.tileId()), seed);
+}
+
+/**
+ * Indexes the positions of the cells in a number of tile layers, so that a
+ * rule only needs to be checked at the offsets where its anchor finds one of
+ * its cells.
+ *
+ * Positions are only ever added, so the index may still list a position of
+ * a cell that was replaced since. The rule is checked there anyway.
+ */
+class CellIndex
+{
+public:
+    struct Change
+    {
+        const TileLayer *layer;
+        QPoint pos;
+        Cell cell;
+    };
+
+    void addLayer(const TileLayer *layer);
+    void add(const TileLayer *layer, QPoint pos, const Cell &cell);
+    void clear();
+
+    bool isEmpty() const { return mPositions.isEmpty(); }
+
+    QVector<QPoint> positions(const TileLayer *layer, const Cell &cell) const;
+
+    /**
+     * Returns the cells added since the last call, for finding the offsets
+     * at which a rule may now match.
+     */
+    QVector<Change> takeChanges();
+
+private:
+    QHash<const TileLayer*, QHash<Cell, QVector<QPoint>>> mPositions;
+    QVector<Change> mChanges;
+};
+
+/**
+ * The input of an automapping rule, compiled for fast matching.
+ *
+ * The conditions of the input layers are flattened into arrays of offsets
+ * and expected cells, and the layers of the working map they need to be
+ * compared against are resolved up front. Each group of input layers
+ * starts by checking its most selective position (the anchor), so most
+ * positions of the map are rejected after looking at a single cell.
+ *
+ * A compiled rule refers to the layers of the working map, so it needs to
+ * be compiled again whenever those may have changed.
+ */
+class CompiledRule
+{
+public:
+    struct MatchOptions
+    {
+        bool matchOutsideMap = true;
+        bool overflowBorder = false;
+        bool wrapBorder = false;
+    };
+
+    CompiledRule() = default;
+
+    /**
+     * Compiles the rule with the given \a inputRegion in the rules map,
+     * matched against the layers in \a map. Input layer names that have
+     * no tile layer in \a map are matched against \a emptyLayer.
+     */
+    CompiledRule(const InputLayers &inputLayers,
+                 const QRegion &inputRegion,
+                 const Map &map,
+                 const TileLayer *emptyLayer,
+                 const MatchOptions &options);
+
+    /**
+     * Returns whether the rule matches when its input region is
+     * translated by \a offset.
+     */
+    bool matches(QPoint offset) const;
+
+    /**
+     * Returns the offsets within \a offsets at which the rule matches,
+     * ordered by row and then by column.
+     */
+    QVector<QPoint> matchesIn(const QRegion &offsets) const;
+
+    /**
+     * Returns the matches of each of the \a rules within the corresponding
+     * \a offsets, as returned by matchesIn(const QRegion &). The work is
+     * spread over the global thread pool in bands of rows.
+     */
+    static QVector<QVector<QPoint>> matchesIn(const QVector<CompiledRule> &rules,
+                                              const QVector<QRegion> &offsets);
+
+    /**
+     * Returns whether candidateOffsets() can be used, which requires each
+     * alternative to have an anchor that only accepts non-empty cells.
+     */
+    bool canUseCellIndex() const;
+
+    /**
+     * Returns the offsets within \a offsets at which the anchor of any of
+     * the alternatives finds one of its cells in \a index. The rule can only
+     * match at these offsets. They are ordered by row and then by column.
+     */
+    QVector<QPoint> candidateOffsets(const CellIndex &index, const QRect &offsets) const;
+
+    /**
+     * Returns the offsets at which the anchor of any of the alternatives
+     * finds \a cell, when it is placed at \a pos in \a layer.
+     */
+    QVector<QPoint> candidateOffsets(const TileLayer *layer, QPoint pos,
+                                     const Cell &cell) const;
+
+private:
+    /**
+     * A single position of the input region. The cells that may not match
+     * are at [noBegin, yesBegin) and the cells of which one should match
+     * are at [yesBegin, yesEnd) in Condition::cells.
+     */
+    struct Position
+    {
+        QPoint pos;
+        int noBegin;
+        int yesBegin;
+        int yesEnd;
+    };
+
+    /**
+     * The conditions for a single layer of the working map.
+     */
+    struct Condition
+    {
+        const TileLayer *setLayer = nullptr;
+        bool hasListNo = false;
+        QVector<Position> positions;
+        QVector<Cell> cells;
+        QVector<Cell> usedCells;    // all cells used by the "input" layers
+    };
+
+    /**
+     * A group of input layers sharing the same index. All its conditions
+     * need to match for the rule to match.
+     */
+    struct Alternative
+    {
+        QVector<Condition> conditions;
+        int anchorCondition = -1;
+        int anchorPosition = -1;
+    };
+
+    bool matches(const Condition &condition,
+                 const Position &position,
+                 QPoint offset) const;
+
+    QVector<Alternative> mAlternatives;
+    MatchOptions mOptions;
+};
+
+} // namespace Tiled
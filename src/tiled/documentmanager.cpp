@@ -590,6 +590,12 @@ void DocumentManager::insertDocument(int index, const DocumentPtr &document)
     if (auto *mapDocument = qobject_cast<MapDocument*>(documentPtr)) {
         connect(mapDocument, &MapDocument::tilesetAdded, this, &DocumentManager::tilesetAdded);
         connect(mapDocument, &MapDocument::tilesetRemoved, this, &DocumentManager::tilesetRemoved);
+        connect(mapDocument, &MapDocument::backgroundSaveFinished, this, [=] (bool success, const QString &error) {
+            if (success)
+                emit documentSaved(mapDocument);
+            else
+                QMessageBox::critical(mWidget->window(), QCoreApplication::translate("Tiled::MainWindow", "Error Saving File"), error);
+        });
     }
 
     if (auto *tilesetDocument = qobject_cast<TilesetDocument*>(documentPtr))
@@ -689,6 +695,34 @@ bool DocumentManager::saveDocument(Document *document, const QString &fileName)
 
     emit documentAboutToBeSaved(document);
 
+    return writeDocument(document, fileName);
+}
+
+/**
+ * Starts saving the given document with the given file name. Maps are
+ * written in the background when possible, in which case documentSaved() is
+ * emitted, or an error is shown, once the map has been written.
+ *
+ * @return <code>false</code> when saving failed right away, otherwise
+ *         <code>true</code>. Use finishBackgroundSaves() to wait for the
+ *         result of a save in the background.
+ */
+bool DocumentManager::startSavingDocument(Document *document, const QString &fileName)
+{
+    auto mapDocument = qobject_cast<MapDocument*>(document);
+    if (!mapDocument || fileName.isEmpty())
+        return saveDocument(document, fileName);
+
+    emit documentAboutToBeSaved(document);
+
+    if (mapDocument->saveInBackground(fileName))
+        return true;
+
+    return writeDocument(document, fileName);
+}
+
+bool DocumentManager::writeDocument(Document *document, const QString &fileName)
+{
     QString error;
     if (!document->save(fileName, &error)) {
         QMessageBox::critical(mWidget->window(), QCoreApplication::translate("Tiled::MainWindow", "Error Saving File"), error);
@@ -700,6 +734,23 @@ bool DocumentManager::saveDocument(Document *document, const QString &fileName)
     return true;
 }
 
+/**
+ * Waits for any maps that are being saved in the background.
+ *
+ * @return <code>true</code> on success, <code>false</code> when any of them
+ *         failed to save
+ */
+bool DocumentManager::finishBackgroundSaves()
+{
+    bool success = true;
+
+    for (const auto &document : qAsConst(mDocuments))
+        if (auto mapDocument = qobject_cast<MapDocument*>(document.data()))
+            success &= mapDocument->waitForBackgroundSave();
+
+    return success;
+}
+
 /**
  * Save the given document with a file name chosen by the user. When saved
  * successfully, the file is added to the list of recent files.
@@ -1121,6 +1172,9 @@ void DocumentManager::fileChanged(const QString &fileName)
     // Ignore change event when it seems to be our own save
     if (QFileInfo(fileName).lastModified() == document->lastSaved())
         return;
+    if (auto mapDocument = qobject_cast<MapDocument*>(document.data()))
+        if (mapDocument->isSavingInBackground())
+            return;
 
     // Automatically reload when there are no unsaved changes
     if (!isDocumentModified(document.data())) {
@@ -110,7 +110,9 @@ public:
                              QString *error = nullptr);
 
     bool saveDocument(Document *document, const QString &fileName);
+    bool startSavingDocument(Document *document, const QString &fileName);
     bool saveDocumentAs(Document *document);
+    bool finishBackgroundSaves();
 
     void closeCurrentDocument();
     void closeAllDocuments();
@@ -191,6 +193,8 @@ public slots:
 private:
     void onWorldUnloaded(const QString &worldFile);
 
+    bool writeDocument(Document *document, const QString &fileName);
+
     void currentIndexChanged();
     void fileNameChanged(const QString &fileName,
                          const QString &oldFileName);
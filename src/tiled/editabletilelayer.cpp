@@ -23,10 +23,17 @@
 #include "changelayer.h"
 #include "editablemanager.h"
 #include "editablemap.h"
+#include "gidmapper.h"
 #include "resizetilelayer.h"
+#include "scriptmanager.h"
 #include "tilelayeredit.h"
 #include "tilesetdocument.h"
 
+#include <QCoreApplication>
+
+#include <cstring>
+#include <limits>
+
 namespace Tiled {
 
 EditableTileLayer::EditableTileLayer(const QString &name, QSize size, QObject *parent)
@@ -105,6 +112,45 @@ EditableTile *EditableTileLayer::tileAt(int x, int y) const
     return nullptr;
 }
 
+/**
+ * Returns the global tile IDs of the cells in the given rectangle, including
+ * the flipping flags, as an array of 32-bit unsigned integers in row-major
+ * order. The IDs are based on the tilesets of the map this layer is part of.
+ *
+ * Returned to scripts as an ArrayBuffer, which can be wrapped in an
+ * Uint32Array.
+ */
+QByteArray EditableTileLayer::gids(int x, int y, int width, int height) const
+{
+    if (width < 0 || height < 0 || qint64(width) * height > std::numeric_limits<int>::max() / 4) {
+        ScriptManager::instance().throwError(QCoreApplication::translate("Script Errors", "Invalid argument"));
+        return QByteArray();
+    }
+
+    const Map *map = tileLayer()->map();
+    if (!map) {
+        ScriptManager::instance().throwError(QCoreApplication::translate("Script Errors", "Layer not part of a map"));
+        return QByteArray();
+    }
+
+    const GidMapper gidMapper(map->tilesets());
+    const TileLayer *layer = tileLayer();
+
+    QByteArray data(width * height * 4, Qt::Uninitialized);
+    char *out = data.data();
+
+    for (int cy = y; cy < y + height; ++cy) {
+        for (int cx = x; cx < x + width; ++cx) {
+            const unsigned gid = gidMapper.cellToGid(layer->cellAt(cx, cy));
+            const quint32 value = gid;
+            std::memcpy(out, &value, sizeof(value));
+            out += sizeof(value);
+        }
+    }
+
+    return data;
+}
+
 TileLayerEdit *EditableTileLayer::edit()
 {
     return new TileLayerEdit(this);
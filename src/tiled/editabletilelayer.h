@@ -63,6 +63,8 @@ public:
     Q_INVOKABLE int flagsAt(int x, int y) const;
     Q_INVOKABLE Tiled::EditableTile *tileAt(int x, int y) const;
 
+    Q_INVOKABLE QByteArray gids(int x, int y, int width, int height) const;
+
     Q_INVOKABLE Tiled::TileLayerEdit *edit();
 
     TileLayer *tileLayer() const;
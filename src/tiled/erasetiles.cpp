@@ -114,3 +114,20 @@ bool EraseTiles::mergeWith(const QUndoCommand *other)
 
     return true;
 }
+
+qint64 EraseTiles::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const LayerData &data : mLayerData) {
+        usage += tileLayerMemoryUsage(data.mErasedCells);
+        usage += data.mRegion.rectCount() * sizeof(QRect);
+    }
+
+    return usage;
+}
+
+void EraseTiles::releaseMemory()
+{
+    mLayerData.clear();
+}
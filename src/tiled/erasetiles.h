@@ -33,7 +33,7 @@ class TileLayer;
 
 class MapDocument;
 
-class EraseTiles : public QUndoCommand
+class EraseTiles : public QUndoCommand, public MemoryReportingUndoCommand
 {
 public:
     EraseTiles(MapDocument *mapDocument,
@@ -53,6 +53,9 @@ public:
     int id() const override { return Cmd_EraseTiles; }
     bool mergeWith(const QUndoCommand *other) override;
 
+    qint64 memoryUsage() const override;
+    void releaseMemory() override;
+
 private:
     struct LayerData
     {
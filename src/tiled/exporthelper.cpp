@@ -132,20 +132,20 @@ void ExportHelper::resolveTypeAndProperties(MapObject *object) const
             (!object->isTemplateInstance() || object->propertyChanged(MapObject::CellProperty)))
         object->setType(tile->type());
 
-    Properties properties;
-
-    // Inherit properties from type
-    if (!object->type().isEmpty()) {
-        for (int i = Object::objectTypes().size() - 1; i >= 0; --i) {
-            auto const &type = Object::objectTypes().at(i);
-            if (type.name == object->type())
-                mergeProperties(properties, type.defaultProperties);
-        }
+    const auto key = qMakePair(object->type(), static_cast<const Tile*>(tile));
+    auto it = mInheritedProperties.find(key);
+    if (it == mInheritedProperties.end()) {
+        // Inherit properties from type
+        Properties inherited = Object::objectTypeProperties(object->type());
+
+        // Inherit properties from tile
+        if (tile)
+            mergeProperties(inherited, tile->properties());
+
+        it = mInheritedProperties.insert(key, inherited);
     }
 
-    // Inherit properties from tile
-    if (tile)
-        mergeProperties(properties, tile->properties());
+    Properties properties = it.value();
 
     // Override with own properties
     mergeProperties(properties, object->properties());
@@ -24,6 +24,9 @@
 #include "preferences.h"
 #include "tileset.h"
 
+#include <QHash>
+#include <QPair>
+
 #include <memory>
 
 namespace Tiled {
@@ -50,6 +53,9 @@ private:
     void resolveTypeAndProperties(MapObject *object) const;
 
     const Preferences::ExportOptions mOptions;
+
+    // Properties inherited from each combination of object type and tile
+    mutable QHash<QPair<QString, const Tile*>, Properties> mInheritedProperties;
 };
 
 } // namespace Tiled
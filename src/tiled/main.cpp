@@ -20,6 +20,7 @@
  * this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "batchexporter.h"
 #include "commandlineparser.h"
 #include "exporthelper.h"
 #include "languagemanager.h"
@@ -72,6 +73,7 @@ public:
     bool showedVersion = false;
     bool disableOpenGL = false;
     bool exportMap = false;
+    bool exportMaps = false;
     bool exportTileset = false;
     bool newInstance = false;
     Preferences::ExportOptions exportOptions;
@@ -81,6 +83,7 @@ private:
     void justQuit();
     void setDisableOpenGL();
     void setExportMap();
+    void setExportMaps();
     void setExportTileset();
     void setExportEmbedTilesets();
     void setExportDetachTemplateInstances();
@@ -208,6 +211,11 @@ CommandLineHandler::CommandLineHandler()
                 QLatin1String("--export-map"),
                 tr("Export the specified map file to target"));
 
+    option<&CommandLineHandler::setExportMaps>(
+                QChar(),
+                QLatin1String("--export-maps"),
+                tr("Export the specified map files to a target directory"));
+
     option<&CommandLineHandler::setExportTileset>(
                 QChar(),
                 QLatin1String("--export-tileset"),
@@ -269,6 +277,11 @@ void CommandLineHandler::setExportMap()
     exportMap = true;
 }
 
+void CommandLineHandler::setExportMaps()
+{
+    exportMaps = true;
+}
+
 void CommandLineHandler::setExportTileset()
 {
     exportTileset = true;
@@ -423,6 +436,29 @@ int main(int argc, char *argv[])
         return 0;
     }
 
+    if (commandLine.exportMaps) {
+        // Get the format, target directory and sources
+        if (commandLine.exportTileset || commandLine.filesToOpen().length() < 3) {
+            qWarning().noquote() << QCoreApplication::translate("Command line", "Export syntax is --export-maps <format> <target directory> <source>...");
+            return 1;
+        }
+
+        initializePluginsAndExtensions();
+
+        const QStringList &arguments = commandLine.filesToOpen();
+
+        QString errorMsg;
+        MapFormat *outputFormat = findExportFormat<MapFormat>(&arguments.at(0), QString(), errorMsg);
+        if (!outputFormat) {
+            Q_ASSERT(!errorMsg.isEmpty());
+            qWarning().noquote() << errorMsg;
+            return 1;
+        }
+
+        BatchExporter exporter(outputFormat, arguments.at(1), commandLine.exportOptions);
+        return exporter.exportMaps(arguments.mid(2));
+    }
+
     if (commandLine.exportTileset) {
         // Get the path to the source file and target file
         if (commandLine.filesToOpen().length() < 2) {
@@ -1114,7 +1114,7 @@ bool MainWindow::saveFile()
     if (currentFileName.isEmpty())
         return mDocumentManager->saveDocumentAs(document);
     else
-        return mDocumentManager->saveDocument(document, currentFileName);
+        return mDocumentManager->startSavingDocument(document, currentFileName);
 }
 
 bool MainWindow::saveFileAs()
@@ -1175,6 +1175,9 @@ void MainWindow::saveAll()
 
 bool MainWindow::confirmSave(Document *document)
 {
+    // A map being saved is only marked clean once it was written
+    mDocumentManager->finishBackgroundSaves();
+
     if (!document || !mDocumentManager->isDocumentModified(document))
         return true;
 
@@ -1186,7 +1189,7 @@ bool MainWindow::confirmSave(Document *document)
             QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
 
     switch (ret) {
-    case QMessageBox::Save:    return saveFile();
+    case QMessageBox::Save:    return saveFile() && mDocumentManager->finishBackgroundSaves();
     case QMessageBox::Discard: return true;
     case QMessageBox::Cancel:
     default:
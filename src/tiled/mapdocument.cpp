@@ -41,6 +41,7 @@
 #include "layermodel.h"
 #include "logginginterface.h"
 #include "mapobject.h"
+#include "mapwriter.h"
 #include "mapobjectmodel.h"
 #include "movelayer.h"
 #include "movemapobject.h"
@@ -49,6 +50,7 @@
 #include "offsetlayer.h"
 #include "orthogonalrenderer.h"
 #include "painttilelayer.h"
+#include "preferences.h"
 #include "rangeset.h"
 #include "reparentlayers.h"
 #include "resizemap.h"
@@ -61,16 +63,62 @@
 #include "tilelayer.h"
 #include "tilesetdocument.h"
 #include "tmxmapformat.h"
+#include "undocommands.h"
 
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QRect>
 #include <QUndoStack>
+#include <QtConcurrentRun>
 
 #include "changeevents.h"
 #include "qtcompat_p.h"
 
 using namespace Tiled;
 
+/**
+ * The state of a save running on a worker thread. Destroying it waits for
+ * the worker to finish, since it is writing the snapshot.
+ */
+struct MapDocument::BackgroundSave
+{
+    ~BackgroundSave()
+    {
+        for (const QMetaObject::Connection &connection : qAsConst(connections))
+            QObject::disconnect(connection);
+
+        watcher->disconnect();
+        watcher->waitForFinished();
+        watcher->deleteLater();
+    }
+
+    QString fileName;
+    std::unique_ptr<Map> snapshot;
+    QHash<const Tileset*, const Tileset*> tilesetAliases;
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>;
+    QString error;                  /**< Set by the worker on failure. */
+    bool modified = false;          /**< Whether changes were made meanwhile. */
+    QVector<QMetaObject::Connection> connections;
+};
+
+/**
+ * Returns whether any embedded tileset has tiles with embedded image data,
+ * which would need to be encoded from a pixmap.
+ */
+static bool hasEmbeddedImageData(const Map &map)
+{
+    for (const SharedTileset &tileset : map.tilesets()) {
+        if (tileset->isExternal())
+            continue;
+
+        for (const Tile *tile : tileset->tiles())
+            if (tile->imageSource().isEmpty() && !tile->image().isNull())
+                return true;
+    }
+
+    return false;
+}
+
 MapDocument::MapDocument(std::unique_ptr<Map> map)
     : Document(MapDocumentType, map->fileName)
     , mMap(std::move(map))
@@ -111,10 +159,23 @@ MapDocument::MapDocument(std::unique_ptr<Map> map)
 
     connect(TemplateManager::instance(), &TemplateManager::objectTemplateChanged,
             this, &MapDocument::updateTemplateInstances);
+
+    // Queued, so that merged commands are checked after they were merged
+    connect(undoStack(), &QUndoStack::indexChanged,
+            this, &MapDocument::enforceUndoMemoryBudget, Qt::QueuedConnection);
+
+    Preferences *prefs = Preferences::instance();
+    connect(prefs, &Preferences::undoMemoryLimitChanged,
+            this, [this] (int megabytes) { setUndoMemoryBudget(qint64(megabytes) * 1024 * 1024); });
+
+    setUndoMemoryBudget(qint64(prefs->undoMemoryLimit()) * 1024 * 1024);
 }
 
 MapDocument::~MapDocument()
 {
+    // Let a save in progress finish before the map goes away
+    mBackgroundSave.reset();
+
     // Clear any previously found issues in this document
     IssuesModel::instance().removeIssuesWithContext(this);
 
@@ -126,6 +187,9 @@ MapDocument::~MapDocument()
 
 bool MapDocument::save(const QString &fileName, QString *error)
 {
+    // Don't let a pending save overwrite this one
+    waitForBackgroundSave();
+
     MapFormat *mapFormat = mWriterFormat;
 
     TmxMapFormat tmxMapFormat;
@@ -138,7 +202,99 @@ bool MapDocument::save(const QString &fileName, QString *error)
         return false;
     }
 
-    undoStack()->setClean();
+    finishSave(fileName, true);
+    return true;
+}
+
+bool MapDocument::saveInBackground(const QString &fileName)
+{
+    // Only the TMX writer is known to be safe to use on a worker thread, and
+    // pixmaps can only be encoded on the main thread
+    if (mWriterFormat && !qobject_cast<TmxMapFormat*>(mWriterFormat.data()))
+        return false;
+    if (hasEmbeddedImageData(*mMap))
+        return false;
+
+    waitForBackgroundSave();
+
+    auto save = std::make_unique<BackgroundSave>();
+    save->fileName = fileName;
+
+    // The layers share their data with the map until it is modified. The
+    // tilesets are replaced by copies, while the cells keep referring to the
+    // original tilesets, which the writer maps to the copies. Updating the
+    // cells would detach all the chunks.
+    save->snapshot = mMap->clone();
+    for (int i = 0; i < mMap->tilesetCount(); ++i) {
+        const SharedTileset &tileset = mMap->tilesetAt(i);
+        SharedTileset copy;
+
+        if (tileset->isExternal()) {
+            // Only the file name and the GID range are written
+            copy = Tileset::create(tileset->name(), tileset->tileWidth(), tileset->tileHeight());
+            copy->setFileName(tileset->fileName());
+            if (tileset->nextTileId() > 0)
+                copy->setNextTileId(tileset->nextTileId());
+        } else {
+            // Embedded tilesets are written in full
+            copy = tileset->clone();
+            copy->exportFileName = tileset->exportFileName;
+            copy->exportFormat = tileset->exportFormat;
+
+            if (TilesetDocument *tilesetDocument = TilesetDocument::findDocumentForTileset(tileset)) {
+                save->connections.append(connect(tilesetDocument->undoStack(), &QUndoStack::indexChanged,
+                                                 this, [save = save.get()] { save->modified = true; }));
+            }
+        }
+
+        save->snapshot->removeTilesetAt(i);
+        save->snapshot->insertTileset(i, copy);
+        save->tilesetAliases.insert(tileset.data(), copy.data());
+    }
+
+    save->connections.append(connect(undoStack(), &QUndoStack::indexChanged,
+                                     this, [save = save.get()] { save->modified = true; }));
+
+    connect(save->watcher, &QFutureWatcherBase::finished,
+            this, &MapDocument::finishBackgroundSave);
+
+    BackgroundSave *state = save.get();
+    save->watcher->setFuture(QtConcurrent::run([state] {
+        MapWriter writer;
+        writer.setTilesetAliases(state->tilesetAliases);
+        if (writer.writeMap(state->snapshot.get(), state->fileName))
+            return true;
+
+        state->error = writer.errorString();
+        return false;
+    }));
+
+    mBackgroundSave = std::move(save);
+    return true;
+}
+
+/**
+ * Blocks until a save started by saveInBackground() has finished.
+ *
+ * Returns whether the map was saved successfully (or wasn't being saved).
+ */
+bool MapDocument::waitForBackgroundSave()
+{
+    if (!mBackgroundSave)
+        return true;
+
+    mBackgroundSave->watcher->waitForFinished();
+    return finishBackgroundSave();
+}
+
+/**
+ * Updates the document after the map was written to \a fileName. The undo
+ * stack is only marked clean when the written map is the current one.
+ */
+void MapDocument::finishSave(const QString &fileName, bool markClean)
+{
+    if (markClean)
+        undoStack()->setClean();
 
     if (mMap->fileName != fileName) {
         mMap->fileName = fileName;
@@ -149,14 +305,28 @@ bool MapDocument::save(const QString &fileName, QString *error)
     mLastSaved = QFileInfo(fileName).lastModified();
 
     // Mark TilesetDocuments for embedded tilesets as saved
-    for (const SharedTileset &tileset : mMap->tilesets()) {
-        if (TilesetDocument *tilesetDocument = TilesetDocument::findDocumentForTileset(tileset))
-            if (tilesetDocument->isEmbedded())
-                tilesetDocument->setClean();
+    if (markClean) {
+        for (const SharedTileset &tileset : mMap->tilesets()) {
+            if (TilesetDocument *tilesetDocument = TilesetDocument::findDocumentForTileset(tileset))
+                if (tilesetDocument->isEmbedded())
+                    tilesetDocument->setClean();
+        }
     }
 
     emit saved();
-    return true;
+}
+
+bool MapDocument::finishBackgroundSave()
+{
+    // Also deletes the snapshot, which needs to happen on this thread
+    const std::unique_ptr<BackgroundSave> save = std::move(mBackgroundSave);
+    const bool success = save->watcher->result();
+
+    if (success)
+        finishSave(save->fileName, !save->modified);
+
+    emit backgroundSaveFinished(success, save->error);
+    return success;
 }
 
 MapDocumentPtr MapDocument::load(const QString &fileName,
@@ -1292,24 +1462,15 @@ void MapDocument::checkIssues()
         }
     }
 
-    QSet<const ObjectTemplate*> brokenTemplates;
-
-    LayerIterator it(map());
-    for (Layer *layer : map()->objectGroups()) {
-        ObjectGroup *objectGroup = static_cast<ObjectGroup*>(layer->asObjectGroup());
-        for (MapObject *mapObject : *objectGroup) {
-            if (const ObjectTemplate *objectTemplate = mapObject->objectTemplate())
-                if (!objectTemplate->object())
-                    brokenTemplates.insert(objectTemplate);
+    const auto usedTemplates = map()->usedTemplates();
+    for (const ObjectTemplate *objectTemplate : usedTemplates) {
+        if (!objectTemplate->object()) {
+            ERROR(tr("Failed to load template '%1'").arg(objectTemplate->fileName()),
+                  LocateObjectTemplate { objectTemplate, sharedFromThis() },
+                  this);
         }
     }
 
-    for (auto objectTemplate : brokenTemplates) {
-        ERROR(tr("Failed to load template '%1'").arg(objectTemplate->fileName()),
-              LocateObjectTemplate { objectTemplate, sharedFromThis() },
-              this);
-    }
-
     checkFilePathProperties(map());
 
     for (Layer *layer : map()->allLayers()) {
@@ -1322,29 +1483,126 @@ void MapDocument::checkIssues()
     }
 }
 
-void MapDocument::updateTemplateInstances(const ObjectTemplate *objectTemplate)
+/**
+ * Returns the approximate memory held by each of the commands on the undo
+ * stack, from the oldest to the most recent one.
+ */
+QVector<MapDocument::UndoCommandMemory> MapDocument::undoMemoryReport() const
 {
-    QList<MapObject*> objectList;
-    for (Layer *layer : mMap->objectGroups()) {
-        for (auto object : static_cast<ObjectGroup*>(layer)->objects()) {
-            if (object->objectTemplate() == objectTemplate) {
-                object->syncWithTemplate();
-                objectList.append(object);
-            }
+    updateUndoMemory();
+
+    QVector<UndoCommandMemory> report;
+#if QT_VERSION >= 0x050900
+    for (int i = 0; i < mUndoMemory.size(); ++i)
+        report.append(UndoCommandMemory { undoStack()->text(i), mUndoMemory.at(i).second });
+#endif
+    return report;
+}
+
+/**
+ * Returns the approximate memory held by the undo stack.
+ */
+qint64 MapDocument::undoMemoryUsage() const
+{
+    updateUndoMemory();
+
+    qint64 usage = 0;
+    for (const auto &entry : qAsConst(mUndoMemory))
+        usage += entry.second;
+    return usage;
+}
+
+/**
+ * Sets the maximum amount of memory the undo stack may hold, in \a bytes.
+ * A value of 0 means there is no limit.
+ */
+void MapDocument::setUndoMemoryBudget(qint64 bytes)
+{
+    mUndoMemoryBudget = bytes;
+    enforceUndoMemoryBudget();
+}
+
+/**
+ * Updates the cached memory usage of the commands on the undo stack. Only the
+ * new commands and the most recent command, which may have been merged with
+ * other commands, need to be checked.
+ */
+void MapDocument::updateUndoMemory() const
+{
+#if QT_VERSION >= 0x050900
+    const QUndoStack *stack = undoStack();
+    mUndoMemory.resize(stack->count());
+
+    for (int i = 0; i < stack->count(); ++i) {
+        const QUndoCommand *command = stack->command(i);
+        auto &entry = mUndoMemory[i];
+
+        if (entry.first != command || i == stack->index() - 1) {
+            entry.first = command;
+            entry.second = undoCommandMemoryUsage(command);
         }
     }
+#endif
+}
+
+/**
+ * Drops the oldest commands from the undo history until it fits within the
+ * budget. The most recent command is always kept.
+ *
+ * QUndoStack does not allow removing its oldest commands, so they release
+ * the memory they hold and are marked obsolete instead. Undoing an obsolete
+ * command has no effect and removes it from the stack.
+ */
+void MapDocument::enforceUndoMemoryBudget()
+{
+#if QT_VERSION >= 0x050900
+    if (mUndoMemoryBudget <= 0)
+        return;
+
+    qint64 usage = undoMemoryUsage();
+    if (usage <= mUndoMemoryBudget)
+        return;
+
+    const QUndoStack *stack = undoStack();
+    const int mostRecent = stack->index() - 1;
+    int dropped = 0;
+
+    for (int i = 0; i < mostRecent && usage > mUndoMemoryBudget; ++i) {
+        auto command = const_cast<QUndoCommand*>(stack->command(i));
+        if (command->isObsolete())
+            continue;
+
+        releaseUndoCommandMemory(command);
+        command->setObsolete(true);
+
+        usage -= mUndoMemory[i].second;
+        mUndoMemory[i].second = 0;
+        ++dropped;
+    }
+
+    if (dropped > 0) {
+        INFO(tr("Dropped the %1 oldest changes from the undo history of '%2'")
+             .arg(dropped)
+             .arg(displayName()));
+    }
+#endif
+}
+
+void MapDocument::updateTemplateInstances(const ObjectTemplate *objectTemplate)
+{
+    QList<MapObject*> objectList = mMap->templateInstances(objectTemplate);
+    if (objectList.isEmpty())
+        return;
+
+    for (MapObject *object : qAsConst(objectList))
+        object->syncWithTemplate();
+
     emit changed(MapObjectsChangeEvent(std::move(objectList)));
 }
 
 void MapDocument::selectAllInstances(const ObjectTemplate *objectTemplate)
 {
-    QList<MapObject*> objectList;
-    for (Layer *layer : mMap->objectGroups()) {
-        for (auto object : static_cast<ObjectGroup*>(layer)->objects())
-            if (object->objectTemplate() == objectTemplate)
-                objectList.append(object);
-    }
-    setSelectedObjects(objectList);
+    setSelectedObjects(mMap->templateInstances(objectTemplate));
 }
 
 /**
@@ -1534,4 +1792,6 @@ void MapDocument::createRenderer()
         mRenderer = std::make_unique<OrthogonalRenderer>(mMap.get());
         break;
     }
+
+    mRenderer->setFlag(UseTileAtlas);
 }
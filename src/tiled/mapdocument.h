@@ -31,7 +31,9 @@
 
 #include <QList>
 #include <QPointer>
+#include <QPair>
 #include <QRegion>
+#include <QVector>
 
 #include <memory>
 
@@ -39,6 +41,7 @@ class QModelIndex;
 class QPoint;
 class QRect;
 class QSize;
+class QUndoCommand;
 class QUndoStack;
 
 namespace Tiled {
@@ -93,6 +96,17 @@ public:
 
     bool save(const QString &fileName, QString *error = nullptr) override;
 
+    /**
+     * Starts saving a snapshot of the map on a worker thread, so that
+     * editing can continue meanwhile. Returns false when the map can't be
+     * saved in the background, in which case save() should be used instead.
+     *
+     * backgroundSaveFinished() is emitted once the map has been written.
+     */
+    bool saveInBackground(const QString &fileName);
+    bool isSavingInBackground() const { return mBackgroundSave != nullptr; }
+    bool waitForBackgroundSave();
+
     /**
      * Loads a map and returns a MapDocument instance on success. Returns null
      * on error and sets the \a error message.
@@ -252,6 +266,21 @@ public:
 
     void checkIssues() override;
 
+    /**
+     * The memory held by a single command on the undo stack.
+     */
+    struct UndoCommandMemory
+    {
+        QString text;
+        qint64 bytes;
+    };
+
+    QVector<UndoCommandMemory> undoMemoryReport() const;
+    qint64 undoMemoryUsage() const;
+
+    qint64 undoMemoryBudget() const { return mUndoMemoryBudget; }
+    void setUndoMemoryBudget(qint64 bytes);
+
 signals:
     /**
      * Emitted when the selected tile region changes. Sends the currently
@@ -270,6 +299,12 @@ signals:
      */
     void selectedObjectsChanged();
 
+    /**
+     * Emitted when a save started by saveInBackground() has finished. When
+     * it failed, \a error describes the problem.
+     */
+    void backgroundSaveFinished(bool success, const QString &error);
+
     /**
      * Emitted when the hovered object changes. Use \a previous with caution,
      * because it may reference an object that was removed.
@@ -366,6 +401,11 @@ public slots:
     void deselectObjects(const QList<MapObject*> &objects);
 
 private:
+    struct BackgroundSave;
+
+    void finishSave(const QString &fileName, bool markClean);
+    bool finishBackgroundSave();
+
     void onChanged(const ChangeEvent &change);
 
     void onMapObjectModelRowsInserted(const QModelIndex &parent, int first, int last);
@@ -379,6 +419,9 @@ private:
 
     void moveObjectIndex(const MapObject *object, int count);
 
+    void updateUndoMemory() const;
+    void enforceUndoMemoryBudget();
+
     /*
      * QPointer is used since the formats referenced here may be dynamically
      * added by a plugin, and can also be removed again.
@@ -396,6 +439,11 @@ private:
     MapObjectModel *mMapObjectModel;
     bool mAllowHidingObjects = true;
     bool mAllowTileObjects = true;
+
+    qint64 mUndoMemoryBudget = 0;       /**< In bytes, 0 means unlimited. */
+    mutable QVector<QPair<const QUndoCommand*, qint64>> mUndoMemory;
+
+    std::unique_ptr<BackgroundSave> mBackgroundSave;
 };
 
 } // namespace Tiled
@@ -245,7 +245,7 @@ void MapItem::setShowTileCollisionShapes(bool enabled)
 
     for (LayerItem *item : qAsConst(mLayerItems))
         if (item->layer()->isTileLayer())
-            item->update();
+            static_cast<TileLayerItem*>(item)->repaint();
 }
 
 QRectF MapItem::boundingRect() const
@@ -333,7 +333,41 @@ void MapItem::repaintRegion(const QRegion &region, TileLayer *tileLayer)
                             margins.right(),
                             margins.bottom());
 
-        tileLayerItem->update(boundingRect);
+        tileLayerItem->repaint(boundingRect);
+    }
+
+    tileLayerItem->invalidateAnimatedCells(region.translated(-tileLayer->position()));
+}
+
+/**
+ * Repaints the tile layers referring to the given \a tileset, for example
+ * because its image changed.
+ */
+void MapItem::repaintTileset(Tileset *tileset)
+{
+    for (LayerItem *layerItem : qAsConst(mLayerItems)) {
+        if (layerItem->layer()->isTileLayer()) {
+            auto tileLayerItem = static_cast<TileLayerItem*>(layerItem);
+            if (tileLayerItem->tileLayer()->referencesTileset(tileset))
+                tileLayerItem->repaint();
+        }
+    }
+}
+
+/**
+ * Repaints the tile layers and tile objects displaying any of the given
+ * animated \a tiles.
+ */
+void MapItem::repaintTiles(Tileset *tileset, const QVector<Tile *> &tiles)
+{
+    for (LayerItem *layerItem : qAsConst(mLayerItems))
+        if (layerItem->layer()->isTileLayer())
+            static_cast<TileLayerItem*>(layerItem)->repaintTiles(tileset, tiles);
+
+    for (MapObjectItem *item : qAsConst(mObjectItems)) {
+        const Cell &cell = item->mapObject()->cell();
+        if (cell.tileset() == tileset && tiles.contains(cell.tile()))
+            item->update();
     }
 }
 
@@ -380,8 +414,10 @@ void MapItem::documentChanged(const ChangeEvent &change)
 void MapItem::mapChanged()
 {
     for (QGraphicsItem *item : qAsConst(mLayerItems)) {
-        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item)) {
             tli->syncWithTileLayer();
+            tli->repaint();
+        }
     }
 
     syncAllObjectItems();
@@ -462,6 +498,8 @@ void MapItem::layerTintColorChanged(Layer *layer)
 {
     switch (layer->layerType()) {
     case Layer::TileLayerType:
+        static_cast<TileLayerItem*>(mLayerItems.value(layer))->repaint();
+        break;
     case Layer::ImageLayerType:
         mLayerItems.value(layer)->update();
         break;
@@ -496,9 +534,12 @@ void MapItem::imageLayerChanged(ImageLayer *imageLayer)
  */
 void MapItem::adaptToTilesetTileSizeChanges(Tileset *tileset)
 {
-    for (QGraphicsItem *item : qAsConst(mLayerItems))
-        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+    for (QGraphicsItem *item : qAsConst(mLayerItems)) {
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item)) {
             tli->syncWithTileLayer();
+            tli->repaint();
+        }
+    }
 
     for (MapObjectItem *item : qAsConst(mObjectItems)) {
         const Cell &cell = item->mapObject()->cell();
@@ -509,15 +550,20 @@ void MapItem::adaptToTilesetTileSizeChanges(Tileset *tileset)
 
 void MapItem::adaptToTileSizeChanges(Tile *tile)
 {
-    for (QGraphicsItem *item : qAsConst(mLayerItems))
-        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item))
+    for (QGraphicsItem *item : qAsConst(mLayerItems)) {
+        if (TileLayerItem *tli = dynamic_cast<TileLayerItem*>(item)) {
             tli->syncWithTileLayer();
+            tli->repaint();
+        }
+    }
 
     for (MapObjectItem *item : qAsConst(mObjectItems)) {
         const Cell &cell = item->mapObject()->cell();
         if (cell.tile() == tile)
             item->syncWithMapObject();
     }
+
+    repaintTileset(tile->tileset());
 }
 
 void MapItem::tileObjectGroupChanged(Tile *tile)
@@ -73,6 +73,9 @@ public:
     void setDisplayMode(DisplayMode displayMode);
     void setShowTileCollisionShapes(bool enabled);
 
+    void repaintTileset(Tileset *tileset);
+    void repaintTiles(Tileset *tileset, const QVector<Tile*> &tiles);
+
     // QGraphicsItem
     QRectF boundingRect() const override;
     void paint(QPainter *, const QStyleOptionGraphicsItem *,
@@ -35,34 +35,53 @@
 #include "preferences.h"
 #include "stylehelper.h"
 #include "templatemanager.h"
+#include "tilelayer.h"
 #include "tilesetmanager.h"
 #include "toolmanager.h"
 #include "worldmanager.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QGraphicsSceneMouseEvent>
+#include <QGraphicsView>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QPalette>
 
 #include "qtcompat_p.h"
 
+#include <algorithm>
+
 using namespace Tiled;
 
+// Time spent loading context maps before returning to the event loop (ms)
+static const int contextMapLoadTimeSlice = 20;
+
+// Estimated memory the context maps may use before distant ones get unloaded
+static const qint64 contextMapMemoryBudget = qint64(256) * 1024 * 1024;
+
+// Distant context maps are unloaded until their usage drops below this
+static const qint64 contextMapUnloadTarget = contextMapMemoryBudget / 4 * 3;
+
 MapScene::MapScene(QObject *parent)
     : QGraphicsScene(parent)
 {
     updateDefaultBackgroundColor();
 
+    mContextMapLoadTimer.setSingleShot(true);
+    mContextMapLoadTimer.setInterval(0);
+    connect(&mContextMapLoadTimer, &QTimer::timeout,
+            this, &MapScene::loadContextMaps);
+
     connect(StyleHelper::instance(), &StyleHelper::styleApplied,
             this, &MapScene::updateDefaultBackgroundColor);
 
     TilesetManager *tilesetManager = TilesetManager::instance();
     connect(tilesetManager, &TilesetManager::tilesetImagesChanged,
             this, &MapScene::repaintTileset);
-    connect(tilesetManager, &TilesetManager::repaintTileset,
-            this, &MapScene::repaintTileset);
+    connect(tilesetManager, &TilesetManager::repaintTiles,
+            this, &MapScene::repaintTiles);
 
     WorldManager &worldManager = WorldManager::instance();
     connect(&worldManager, &WorldManager::worldsChanged, this, &MapScene::refreshScene);
@@ -154,11 +173,19 @@ void MapScene::setSelectedTool(AbstractTool *tool)
 
 /**
  * Refreshes the map scene.
+ *
+ * Context maps from the world that are not loaded yet are loaded
+ * incrementally afterwards, see loadContextMaps().
  */
 void MapScene::refreshScene()
 {
     QHash<MapDocument*, MapItem*> mapItems;
 
+    mContextMapLoadTimer.stop();
+    mPendingContextMaps.clear();
+    mLoadedContextMaps.clear();
+    mContextMapsRect = QRectF();
+
     if (!mMapDocument) {
         mMapItems.swap(mapItems);
         qDeleteAll(mapItems);
@@ -170,27 +197,26 @@ void MapScene::refreshScene()
     const QString currentMapFile = mMapDocument->canonicalFilePath();
 
     if (const World *world = worldManager.worldForMap(currentMapFile)) {
-        const QPoint currentMapPosition = world->mapRect(currentMapFile).topLeft();
+        mCurrentMapPosition = world->mapRect(currentMapFile).topLeft();
         auto const contextMaps = world->contextMaps(currentMapFile);
 
         for (const World::MapEntry &mapEntry : contextMaps) {
-            MapDocumentPtr mapDocument;
-
             if (mapEntry.fileName == currentMapFile) {
-                mapDocument = mMapDocument->sharedFromThis();
-            } else {
-                auto doc = DocumentManager::instance()->loadDocument(mapEntry.fileName);
-                mapDocument = doc.objectCast<MapDocument>();
+                auto mapItem = takeOrCreateMapItem(mMapDocument->sharedFromThis(), MapItem::Editable);
+                mapItem->setPos(mapEntry.rect.topLeft() - mCurrentMapPosition);
+                mapItems.insert(mMapDocument, mapItem);
+                continue;
             }
 
-            if (mapDocument) {
-                MapItem::DisplayMode displayMode = MapItem::ReadOnly;
-                if (mapDocument == mMapDocument)
-                    displayMode = MapItem::Editable;
+            mContextMapsRect |= contextMapRect(mapEntry);
 
-                auto mapItem = takeOrCreateMapItem(mapDocument, displayMode);
-                mapItem->setPos(mapEntry.rect.topLeft() - currentMapPosition);
-                mapItems.insert(mapDocument.data(), mapItem);
+            // Maps that are already loaded can be displayed right away
+            Document *document = Document::documentInstances().value(mapEntry.fileName);
+            if (document && document->type() == Document::MapDocumentType) {
+                auto mapDocument = static_cast<MapDocument*>(document)->sharedFromThis();
+                mapItems.insert(mapDocument.data(), createContextMapItem(mapDocument, mapEntry));
+            } else {
+                mPendingContextMaps.append(mapEntry);
             }
         }
     } else {
@@ -210,9 +236,191 @@ void MapScene::refreshScene()
     else
         setBackgroundBrush(mDefaultBackgroundColor);
 
+    if (!mPendingContextMaps.isEmpty())
+        mContextMapLoadTimer.start();
+
     emit sceneRefreshed();
 }
 
+/**
+ * Should be called by the views when their visible area changed, so that
+ * context maps can be loaded in the newly visible area.
+ */
+void MapScene::viewportChanged()
+{
+    if (!mPendingContextMaps.isEmpty() && !mContextMapLoadTimer.isActive())
+        mContextMapLoadTimer.start();
+}
+
+static qint64 estimatedMemoryUsage(const Map *map)
+{
+    qint64 memoryUsage = 0;
+
+    LayerIterator iterator(map, Layer::TileLayerType);
+    while (auto tileLayer = static_cast<TileLayer*>(iterator.next())) {
+        const QRect bounds = tileLayer->bounds();
+        memoryUsage += qint64(bounds.width()) * bounds.height() * qint64(sizeof(Cell));
+    }
+
+    return memoryUsage;
+}
+
+static qreal squaredDistance(const QRectF &rect, const QPointF &point)
+{
+    const QPointF delta = rect.center() - point;
+    return QPointF::dotProduct(delta, delta);
+}
+
+/**
+ * Loads the pending context maps, starting with the ones closest to the
+ * visible area. Only spends a limited amount of time per call, so that maps
+ * are streamed into the scene while the editor remains responsive.
+ *
+ * Maps near the visible area are always loaded. Other maps are only loaded
+ * while they are expected to fit within the memory budget. Once the budget
+ * is exceeded, maps far outside of the visible area are unloaded until the
+ * usage is well below the budget, so that maps at the edge of the budget
+ * are not loaded and unloaded over and over.
+ *
+ * Note that the time slice is only checked in between maps, so loading a
+ * single large map still blocks the editor until it is done.
+ */
+void MapScene::loadContextMaps()
+{
+    if (!mMapDocument)
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const QRectF visibleRect = visibleSceneRect();
+    const QPointF visibleCenter = visibleRect.center();
+    const QRectF keepRect = visibleRect.adjusted(-visibleRect.width(),
+                                                 -visibleRect.height(),
+                                                 visibleRect.width(),
+                                                 visibleRect.height());
+
+    bool itemsAdded = false;
+
+    while (!mPendingContextMaps.isEmpty()) {
+        if (timer.elapsed() >= contextMapLoadTimeSlice) {
+            mContextMapLoadTimer.start();
+            break;
+        }
+
+        auto closest = std::min_element(mPendingContextMaps.begin(),
+                                        mPendingContextMaps.end(),
+                                        [&] (const World::MapEntry &a, const World::MapEntry &b) {
+            return squaredDistance(contextMapRect(a), visibleCenter) <
+                    squaredDistance(contextMapRect(b), visibleCenter);
+        });
+
+        // Remaining maps are further away, wait for the view to move. The
+        // cost of a map is only known once it has been loaded before.
+        const qint64 cost = mContextMapCosts.value(closest->fileName);
+        if (!keepRect.intersects(contextMapRect(*closest)) &&
+                contextMapMemoryUsage() + cost > contextMapMemoryBudget)
+            break;
+
+        const World::MapEntry mapEntry = *closest;
+        mPendingContextMaps.erase(closest);
+
+        auto document = DocumentManager::instance()->loadDocument(mapEntry.fileName);
+        if (auto mapDocument = document.objectCast<MapDocument>()) {
+            mMapItems.insert(mapDocument.data(), createContextMapItem(mapDocument, mapEntry));
+            itemsAdded = true;
+        }
+    }
+
+    unloadDistantContextMaps(keepRect);
+
+    if (itemsAdded) {
+        updateSceneRect();
+        emit sceneRefreshed();
+    }
+}
+
+/**
+ * When the context maps exceed their memory budget, unloads the ones
+ * furthest away from the visible area until their memory usage drops below
+ * the unload target. Maps intersecting \a keepRect are never unloaded.
+ */
+void MapScene::unloadDistantContextMaps(const QRectF &keepRect)
+{
+    qint64 memoryUsage = contextMapMemoryUsage();
+    if (memoryUsage <= contextMapMemoryBudget)
+        return;
+
+    QVector<MapDocument*> candidates;
+    for (auto it = mLoadedContextMaps.cbegin(), it_end = mLoadedContextMaps.cend(); it != it_end; ++it)
+        if (!keepRect.intersects(contextMapRect(it.value().mapEntry)))
+            candidates.append(it.key());
+
+    const QPointF center = keepRect.center();
+    std::sort(candidates.begin(), candidates.end(), [&] (MapDocument *a, MapDocument *b) {
+        return squaredDistance(contextMapRect(mLoadedContextMaps[a].mapEntry), center) >
+                squaredDistance(contextMapRect(mLoadedContextMaps[b].mapEntry), center);
+    });
+
+    for (MapDocument *mapDocument : qAsConst(candidates)) {
+        if (memoryUsage <= contextMapUnloadTarget)
+            break;
+
+        const ContextMap contextMap = mLoadedContextMaps.take(mapDocument);
+        memoryUsage -= contextMap.memoryUsage;
+        mPendingContextMaps.append(contextMap.mapEntry);
+
+        // Releases the document, unless it is also open elsewhere
+        delete mMapItems.take(mapDocument);
+    }
+}
+
+MapItem *MapScene::createContextMapItem(const MapDocumentPtr &mapDocument,
+                                        const World::MapEntry &mapEntry)
+{
+    auto mapItem = takeOrCreateMapItem(mapDocument, MapItem::ReadOnly);
+    mapItem->setPos(mapEntry.rect.topLeft() - mCurrentMapPosition);
+
+    const qint64 memoryUsage = estimatedMemoryUsage(mapDocument->map());
+    mLoadedContextMaps.insert(mapDocument.data(), ContextMap { mapEntry, memoryUsage });
+    mContextMapCosts.insert(mapEntry.fileName, memoryUsage);
+
+    return mapItem;
+}
+
+/**
+ * Returns the area covered by the given context map, in scene coordinates.
+ */
+QRectF MapScene::contextMapRect(const World::MapEntry &mapEntry) const
+{
+    return QRectF(mapEntry.rect.translated(-mCurrentMapPosition));
+}
+
+qint64 MapScene::contextMapMemoryUsage() const
+{
+    qint64 memoryUsage = 0;
+    for (const ContextMap &contextMap : mLoadedContextMaps)
+        memoryUsage += contextMap.memoryUsage;
+    return memoryUsage;
+}
+
+/**
+ * Returns the area of the scene visible in any of its views.
+ */
+QRectF MapScene::visibleSceneRect() const
+{
+    QRectF visibleRect;
+
+    const auto views = this->views();
+    for (QGraphicsView *view : views)
+        visibleRect |= view->mapToScene(view->viewport()->rect()).boundingRect();
+
+    if (visibleRect.isNull())
+        visibleRect = mapBoundingRect();
+
+    return visibleRect;
+}
+
 void MapScene::updateDefaultBackgroundColor()
 {
     mDefaultBackgroundColor = QGuiApplication::palette().dark().color();
@@ -223,7 +431,8 @@ void MapScene::updateDefaultBackgroundColor()
 
 void MapScene::updateSceneRect()
 {
-    QRectF sceneRect;
+    // Include context maps that are not loaded yet, so they can be scrolled to
+    QRectF sceneRect = mContextMapsRect;
 
     for (MapItem *mapItem : qAsConst(mMapItems))
         sceneRect |= mapItem->boundingRect().translated(mapItem->pos());
@@ -260,12 +469,28 @@ void MapScene::mapChanged()
 
 void MapScene::repaintTileset(Tileset *tileset)
 {
+    bool usedTileset = false;
+
     for (MapItem *mapItem : qAsConst(mMapItems)) {
         if (contains(mapItem->mapDocument()->map()->tilesets(), tileset)) {
-            update();
-            return;
+            mapItem->repaintTileset(tileset);
+            usedTileset = true;
         }
     }
+
+    if (usedTileset)
+        update();
+}
+
+/**
+ * Repaints the parts of the maps where the given animated \a tiles are
+ * displayed.
+ */
+void MapScene::repaintTiles(Tileset *tileset, const QVector<Tile *> &tiles)
+{
+    for (MapItem *mapItem : qAsConst(mMapItems))
+        if (contains(mapItem->mapDocument()->map()->tilesets(), tileset))
+            mapItem->repaintTiles(tileset, tiles);
 }
 
 void MapScene::tilesetReplaced(int index, Tileset *tileset, Tileset *oldTileset)
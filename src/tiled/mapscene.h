@@ -25,10 +25,13 @@
 
 #include "mapdocument.h"
 #include "mapitem.h"
+#include "worldmanager.h"
 
 #include <QColor>
 #include <QGraphicsScene>
 #include <QHash>
+#include <QTimer>
+#include <QVector>
 
 namespace Tiled {
 
@@ -68,6 +71,8 @@ public:
 
     MapItem *mapItem(MapDocument *mapDocument) const;
 
+    void viewportChanged();
+
 signals:
     void mapDocumentChanged(MapDocument *mapDocument);
 
@@ -90,8 +95,17 @@ protected:
 private:
     void refreshScene();
 
+    void loadContextMaps();
+    void unloadDistantContextMaps(const QRectF &keepRect);
+    MapItem *createContextMapItem(const MapDocumentPtr &mapDocument,
+                                  const World::MapEntry &mapEntry);
+    QRectF contextMapRect(const World::MapEntry &mapEntry) const;
+    qint64 contextMapMemoryUsage() const;
+    QRectF visibleSceneRect() const;
+
     void mapChanged();
     void repaintTileset(Tileset *tileset);
+    void repaintTiles(Tileset *tileset, const QVector<Tile*> &tiles);
 
     void tilesetReplaced(int index, Tileset *tileset, Tileset *oldTileset);
 
@@ -105,6 +119,20 @@ private:
 
     MapDocument *mMapDocument = nullptr;
     QHash<MapDocument*, MapItem*> mMapItems;
+
+    struct ContextMap
+    {
+        World::MapEntry mapEntry;
+        qint64 memoryUsage;
+    };
+
+    QPoint mCurrentMapPosition;
+    QRectF mContextMapsRect;
+    QVector<World::MapEntry> mPendingContextMaps;
+    QHash<MapDocument*, ContextMap> mLoadedContextMaps;
+    QHash<QString, qint64> mContextMapCosts;   // estimated usage by file name
+    QTimer mContextMapLoadTimer;
+
     AbstractTool *mSelectedTool = nullptr;
     bool mUnderMouse = false;
     bool mShowTileCollisionShapes = false;
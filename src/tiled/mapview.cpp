@@ -162,6 +162,9 @@ void MapView::adjustScale(qreal scale)
 
     setRenderHint(QPainter::SmoothPixmapTransform,
                   mZoomable->smoothTransform());
+
+    if (MapScene *scene = mapScene())
+        scene->viewportChanged();
 }
 
 void MapView::setUseOpenGL(bool useOpenGL)
@@ -354,6 +357,17 @@ void MapView::resizeEvent(QResizeEvent *event)
         updateSceneRect(s->sceneRect());
 
     QGraphicsView::resizeEvent(event);
+
+    if (MapScene *scene = mapScene())
+        scene->viewportChanged();
+}
+
+void MapView::scrollContentsBy(int dx, int dy)
+{
+    QGraphicsView::scrollContentsBy(dx, dy);
+
+    if (MapScene *scene = mapScene())
+        scene->viewportChanged();
 }
 
 void MapView::keyPressEvent(QKeyEvent *event)
@@ -85,6 +85,7 @@ protected:
     void paintEvent(QPaintEvent *event) override;
     void hideEvent(QHideEvent *) override;
     void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
 
     void keyPressEvent(QKeyEvent *event) override;
 
@@ -21,16 +21,21 @@
 
 #include "minimap.h"
 
+#include "changeevents.h"
 #include "documentmanager.h"
 #include "map.h"
 #include "mapdocument.h"
+#include "mapobject.h"
 #include "maprenderer.h"
 #include "mapscene.h"
 #include "mapview.h"
+#include "objectgroup.h"
+#include "tilelayer.h"
 #include "utils.h"
 #include "zoomable.h"
 
 #include <QCursor>
+#include <QPainter>
 #include <QResizeEvent>
 #include <QScrollBar>
 #include <QUndoStack>
@@ -42,12 +47,13 @@ MiniMap::MiniMap(QWidget *parent)
     , mMapDocument(nullptr)
     , mDragging(false)
     , mMouseMoveCursorState(false)
-    , mRedrawMapImage(false)
     , mRenderFlags(MiniMapRenderer::DrawTileLayers
                    | MiniMapRenderer::DrawMapObjects
                    | MiniMapRenderer::DrawImageLayers
                    | MiniMapRenderer::IgnoreInvisibleLayer
                    | MiniMapRenderer::SmoothPixmapTransform)
+    , mFullRedraw(true)
+    , mChangeTracked(false)
 {
     setFrameStyle(QFrame::StyledPanel | QFrame::Sunken);
     setMinimumSize(50, 50);
@@ -66,6 +72,7 @@ void MiniMap::setMapDocument(MapDocument *map)
 
     if (mMapDocument) {
         mMapDocument->disconnect(this);
+        mMapDocument->undoStack()->disconnect(this);
 
         if (MapView *mapView = dm->viewForDocument(mMapDocument)) {
             mapView->zoomable()->disconnect(this);
@@ -75,10 +82,28 @@ void MiniMap::setMapDocument(MapDocument *map)
     }
 
     mMapDocument = map;
+    mDirtyRegion = QRegion();
+    mObjectBounds.clear();
 
     if (mMapDocument) {
         connect(mMapDocument->undoStack(), &QUndoStack::indexChanged,
-                this, &MiniMap::scheduleMapImageUpdate);
+                this, &MiniMap::undoIndexChanged);
+        connect(mMapDocument, &Document::changed,
+                this, &MiniMap::documentChanged);
+        connect(mMapDocument, &MapDocument::regionChanged,
+                this, &MiniMap::invalidateRegion);
+
+        // Changes that affect the whole map
+        connect(mMapDocument, &MapDocument::mapChanged, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::layerAdded, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::layerRemoved, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::imageLayerChanged, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::tilesetReplaced, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::tilesetRemoved, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::tilesetTilePositioningChanged, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::tileImageSourceChanged, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::objectTemplateReplaced, this, &MiniMap::invalidateAll);
+        connect(mMapDocument, &MapDocument::objectsIndexChanged, this, &MiniMap::invalidateAll);
 
         if (MapView *mapView = dm->viewForDocument(mMapDocument)) {
             connect(mapView->horizontalScrollBar(), &QAbstractSlider::valueChanged, this, [this] { update(); });
@@ -97,6 +122,7 @@ QSize MiniMap::sizeHint() const
 
 void MiniMap::scheduleMapImageUpdate()
 {
+    mFullRedraw = true;
     mMapImageUpdateTimer.start(100);
 }
 
@@ -104,11 +130,6 @@ void MiniMap::paintEvent(QPaintEvent *pe)
 {
     QFrame::paintEvent(pe);
 
-    if (mRedrawMapImage) {
-        renderMapToImage();
-        mRedrawMapImage = false;
-    }
-
     if (mMapImage.isNull() || mImageRect.isEmpty())
         return;
 
@@ -161,6 +182,11 @@ void MiniMap::updateImageRect()
     mImageRect = imageRect;
 }
 
+/**
+ * Renders the changed parts of the map into the minimap image. Only the
+ * changed parts are drawn, so the cost is bound by the size of the change
+ * rather than the size of the map.
+ */
 void MiniMap::renderMapToImage()
 {
     if (!mMapDocument) {
@@ -181,18 +207,166 @@ void MiniMap::renderMapToImage()
     qreal scale = qMin(static_cast<qreal>(viewSize.width()) / mapSize.width(),
                        static_cast<qreal>(viewSize.height()) / mapSize.height());
 
-    // Allocate a new image when the size changed
     const QSize imageSize = mapSize * scale;
+    if (imageSize.isEmpty())
+        return;
+
+    // Allocate a new image when the size changed
     if (mMapImage.size() != imageSize) {
         mMapImage = QImage(imageSize, QImage::Format_ARGB32_Premultiplied);
+        mFullRedraw = true;
         updateImageRect();
     }
 
-    if (imageSize.isEmpty())
+    if (!mFullRedraw && mDirtyRegion.isEmpty())
         return;
 
     MiniMapRenderer miniMapRenderer(mMapDocument->map());
-    miniMapRenderer.renderToImage(mMapImage, mRenderFlags);
+
+    if (mFullRedraw) {
+        miniMapRenderer.renderToImage(mMapImage, mRenderFlags);
+        updateObjectBounds();
+    } else {
+        miniMapRenderer.renderToImage(mMapImage, mRenderFlags, mDirtyRegion);
+    }
+
+    mFullRedraw = false;
+    mDirtyRegion = QRegion();
+
+    update();
+}
+
+/**
+ * Remembers the bounds of all objects, so that the area they were painted
+ * at can be repainted when they change.
+ */
+void MiniMap::updateObjectBounds()
+{
+    mObjectBounds.clear();
+
+    if (!mRenderFlags.testFlag(MiniMapRenderer::DrawMapObjects))
+        return;
+
+    for (const Layer *layer : mMapDocument->map()->objectGroups()) {
+        const ObjectGroup *objectGroup = static_cast<const ObjectGroup*>(layer);
+        for (const MapObject *object : objectGroup->objects())
+            mObjectBounds.insert(object, objectBounds(object));
+    }
+}
+
+void MiniMap::documentChanged(const ChangeEvent &change)
+{
+    switch (change.type) {
+    case ChangeEvent::LayerChanged:
+    case ChangeEvent::TileLayerChanged: {
+        auto &layerChange = static_cast<const LayerChangeEvent&>(change);
+        const int visualProperties = LayerChangeEvent::OpacityProperty |
+                LayerChangeEvent::VisibleProperty |
+                LayerChangeEvent::OffsetProperty |
+                LayerChangeEvent::TintColorProperty |
+                TileLayerChangeEvent::SizeProperty;
+        if (layerChange.properties & visualProperties)
+            invalidateAll();
+        break;
+    }
+    case ChangeEvent::ObjectGroupChanged:
+        invalidateAll();
+        break;
+    case ChangeEvent::MapObjectsAdded:
+    case ChangeEvent::MapObjectsAboutToBeRemoved:
+    case ChangeEvent::MapObjectsChanged:
+        invalidateObjects(static_cast<const MapObjectsEvent&>(change));
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Falls back to redrawing the whole map for commands that did not report
+ * which parts of the map they changed.
+ */
+void MiniMap::undoIndexChanged()
+{
+    if (!mChangeTracked)
+        invalidateAll();
+    mChangeTracked = false;
+}
+
+void MiniMap::invalidateRegion(const QRegion &region, TileLayer *tileLayer)
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins drawMargins = tileLayer->drawMargins();
+    const QPoint offset = tileLayer->totalOffset().toPoint();
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        mDirtyRegion |= renderer->boundingRect(rect)
+                .marginsAdded(drawMargins)
+                .translated(offset);
+    }
+
+    mChangeTracked = true;
+    mMapImageUpdateTimer.start(100);
+}
+
+void MiniMap::invalidateObjects(const MapObjectsEvent &event)
+{
+    for (const MapObject *object : event.mapObjects) {
+        // Repaint the area the object was previously painted at
+        auto it = mObjectBounds.find(object);
+        if (it != mObjectBounds.end()) {
+            mDirtyRegion |= it.value().toAlignedRect();
+            mObjectBounds.erase(it);
+        } else if (event.type == ChangeEvent::MapObjectsChanged) {
+            // Previous bounds are not known for objects that weren't added
+            // or changed before
+            mFullRedraw = true;
+        }
+
+        const QRectF bounds = objectBounds(object);
+        mDirtyRegion |= bounds.toAlignedRect();
+
+        if (event.type != ChangeEvent::MapObjectsAboutToBeRemoved)
+            mObjectBounds.insert(object, bounds);
+    }
+
+    mChangeTracked = true;
+    mMapImageUpdateTimer.start(100);
+}
+
+void MiniMap::invalidateAll()
+{
+    mChangeTracked = true;
+    scheduleMapImageUpdate();
+}
+
+/**
+ * Returns the bounds of the given \a object in map pixel coordinates,
+ * including a small margin for its outline.
+ */
+QRectF MiniMap::objectBounds(const MapObject *object) const
+{
+    const MapRenderer *renderer = mMapDocument->renderer();
+    QRectF bounds = renderer->boundingRect(object);
+
+    if (object->rotation() != qreal(0)) {
+        const QPointF origin = renderer->pixelToScreenCoords(object->position());
+        QTransform transform;
+        transform.translate(origin.x(), origin.y());
+        transform.rotate(object->rotation());
+        transform.translate(-origin.x(), -origin.y());
+        bounds = transform.mapRect(bounds);
+    }
+
+    if (const ObjectGroup *objectGroup = object->objectGroup())
+        bounds.translate(objectGroup->totalOffset());
+
+    return bounds.adjusted(-4, -4, 4, 4);
 }
 
 void MiniMap::centerViewOnLocalPixel(QPoint centerPos, int delta)
@@ -209,8 +383,11 @@ void MiniMap::centerViewOnLocalPixel(QPoint centerPos, int delta)
 
 void MiniMap::redrawTimeout()
 {
-    mRedrawMapImage = true;
-    update();
+    // Changes made outside of the undo stack are not followed by an index
+    // change, so reset this here as well
+    mChangeTracked = false;
+
+    renderMapToImage();
 }
 
 void MiniMap::wheelEvent(QWheelEvent *event)
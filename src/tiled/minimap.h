@@ -24,12 +24,18 @@
 #include "minimaprenderer.h"
 
 #include <QFrame>
+#include <QHash>
 #include <QImage>
+#include <QRegion>
 #include <QTimer>
 
 namespace Tiled {
 
+class ChangeEvent;
 class MapDocument;
+class MapObject;
+class MapObjectsEvent;
+class TileLayer;
 
 class MiniMap : public QFrame
 {
@@ -60,6 +66,13 @@ protected:
 private:
     void redrawTimeout();
 
+    void documentChanged(const ChangeEvent &change);
+    void undoIndexChanged();
+    void invalidateRegion(const QRegion &region, TileLayer *tileLayer);
+    void invalidateObjects(const MapObjectsEvent &event);
+    void invalidateAll();
+    QRectF objectBounds(const MapObject *object) const;
+
     MapDocument *mMapDocument;
     QImage mMapImage;
     QRect mImageRect;
@@ -67,13 +80,18 @@ private:
     bool mDragging;
     QPoint mDragOffset;
     bool mMouseMoveCursorState;
-    bool mRedrawMapImage;
     MiniMapRenderer::RenderFlags mRenderFlags;
 
+    bool mFullRedraw;
+    bool mChangeTracked;
+    QRegion mDirtyRegion;                           /**< In map pixel coordinates */
+    QHash<const MapObject*, QRectF> mObjectBounds;  /**< Bounds of objects as last painted */
+
     QRect viewportRect() const;
     QPointF mapToScene(QPoint p) const;
     void updateImageRect();
     void renderMapToImage();
+    void updateObjectBounds();
     void centerViewOnLocalPixel(QPoint centerPos, int delta = 0);
 };
 
@@ -0,0 +1,234 @@
+/*
+ * packedtilelayer.cpp
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "packedtilelayer.h"
+
+#include "tilelayer.h"
+
+#include "qtcompat_p.h"
+
+using namespace Tiled;
+
+static quint64 chunkKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+static QPoint chunkPosition(quint64 key)
+{
+    return QPoint(int(quint32(key >> 32)) * CHUNK_SIZE,
+                  int(quint32(key)) * CHUNK_SIZE);
+}
+
+void PackedTileLayer::setCells(const TileLayer &layer, QPoint offset, const QRegion &region)
+{
+    setCells(region, [&] (int x, int y) -> const Cell & {
+        return layer.cellAt(x - offset.x(), y - offset.y());
+    });
+}
+
+void PackedTileLayer::setCells(const PackedTileLayer &other, const QRegion &region)
+{
+    // Unpack the chunks of the other layer one at a time, since the region
+    // is processed chunk by chunk.
+    quint64 currentKey = 0;
+    bool haveChunk = false;
+    Chunk chunk;
+
+    setCells(region, [&] (int x, int y) -> const Cell & {
+        const quint64 key = chunkKey(x >> CHUNK_BITS, y >> CHUNK_BITS);
+        if (!haveChunk || key != currentKey) {
+            auto it = other.mChunks.constFind(key);
+            if (it != other.mChunks.constEnd())
+                other.unpack(it.value(), chunk);
+            else
+                chunk = Chunk();
+
+            currentKey = key;
+            haveChunk = true;
+        }
+
+        return chunk.cellAt(x & CHUNK_MASK, y & CHUNK_MASK);
+    });
+}
+
+template<typename CellAt>
+void PackedTileLayer::setCells(const QRegion &region, CellAt cellAt)
+{
+    // Split up the region by chunk
+    QHash<quint64, QVector<QRect>> chunkRects;
+    QVector<quint64> keys;
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        for (int cy = rect.top() >> CHUNK_BITS; cy <= rect.bottom() >> CHUNK_BITS; ++cy) {
+            for (int cx = rect.left() >> CHUNK_BITS; cx <= rect.right() >> CHUNK_BITS; ++cx) {
+                const quint64 key = chunkKey(cx, cy);
+                const QRect chunkRect(cx * CHUNK_SIZE, cy * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE);
+
+                auto it = chunkRects.find(key);
+                if (it == chunkRects.end()) {
+                    it = chunkRects.insert(key, QVector<QRect>());
+                    keys.append(key);
+                }
+                it->append(rect & chunkRect);
+            }
+        }
+    }
+
+    Chunk chunk;
+
+    for (const quint64 key : qAsConst(keys)) {
+        const QPoint chunkPos = chunkPosition(key);
+
+        auto it = mChunks.find(key);
+        if (it != mChunks.end())
+            unpack(it.value(), chunk);
+        else
+            chunk = Chunk();
+
+        for (const QRect &rect : chunkRects.value(key))
+            for (int y = rect.top(); y <= rect.bottom(); ++y)
+                for (int x = rect.left(); x <= rect.right(); ++x)
+                    chunk.setCell(x - chunkPos.x(), y - chunkPos.y(), cellAt(x, y));
+
+        Runs runs = pack(chunk);
+
+        // Chunks with only empty cells don't need to be stored
+        if (runs.size() == 1 && runs.first().tileset == 0 && runs.first().flags == 0) {
+            if (it != mChunks.end())
+                mChunks.erase(it);
+        } else if (it != mChunks.end()) {
+            it.value() = std::move(runs);
+        } else {
+            mChunks.insert(key, std::move(runs));
+        }
+    }
+}
+
+std::unique_ptr<TileLayer> PackedTileLayer::unpack() const
+{
+    std::unique_ptr<TileLayer> layer(new TileLayer);
+    Chunk chunk;
+
+    for (auto it = mChunks.cbegin(), end = mChunks.cend(); it != end; ++it) {
+        const QPoint chunkPos = chunkPosition(it.key());
+        unpack(it.value(), chunk);
+
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int x = 0; x < CHUNK_SIZE; ++x) {
+                const Cell &cell = chunk.cellAt(x, y);
+                if (!cell.isEmpty() || cell.checked())
+                    layer->setCell(chunkPos.x() + x, chunkPos.y() + y, cell);
+            }
+        }
+    }
+
+    return layer;
+}
+
+qint64 PackedTileLayer::memoryUsage() const
+{
+    // Approximates the overhead of the hash nodes and the vector headers
+    constexpr qint64 chunkOverhead = sizeof(void*) * 2 + sizeof(quint64) + sizeof(Runs) + 24;
+
+    qint64 usage = mTilesets.capacity() * sizeof(Tileset*);
+
+    for (const Runs &runs : mChunks)
+        usage += chunkOverhead + runs.capacity() * sizeof(Run);
+
+    return usage;
+}
+
+void PackedTileLayer::unpack(const Runs &runs, Chunk &chunk) const
+{
+    int index = 0;
+
+    for (const Run &run : runs) {
+        const Cell cell = unpackCell(run);
+        for (int i = 0; i <= run.length; ++i, ++index)
+            chunk.setCell(index & CHUNK_MASK, index >> CHUNK_BITS, cell);
+    }
+
+    Q_ASSERT(index == CHUNK_SIZE * CHUNK_SIZE);
+}
+
+PackedTileLayer::Runs PackedTileLayer::pack(const Chunk &chunk)
+{
+    Runs runs;
+
+    for (const Cell &cell : chunk) {
+        const Run run = packCell(cell);
+
+        if (!runs.isEmpty()) {
+            Run &last = runs.last();
+            if (last.tileId == run.tileId &&
+                    last.tileset == run.tileset &&
+                    last.flags == run.flags) {
+                ++last.length;
+                continue;
+            }
+        }
+
+        runs.append(run);
+    }
+
+    runs.squeeze();
+    return runs;
+}
+
+PackedTileLayer::Run PackedTileLayer::packCell(const Cell &cell)
+{
+    Run run;
+    run.tileId = cell.tileId();
+    run.tileset = 0;
+    run.flags = (cell.flippedHorizontally() ? 0x01 : 0) |
+                (cell.flippedVertically() ? 0x02 : 0) |
+                (cell.flippedAntiDiagonally() ? 0x04 : 0) |
+                (cell.rotatedHexagonal120() ? 0x08 : 0) |
+                (cell.checked() ? 0x10 : 0);
+    run.length = 0;
+
+    if (Tileset *tileset = cell.tileset()) {
+        int index = mTilesets.indexOf(tileset);
+        if (index == -1) {
+            index = mTilesets.size();
+            mTilesets.append(tileset);
+        }
+        run.tileset = quint16(index + 1);
+    }
+
+    return run;
+}
+
+Cell PackedTileLayer::unpackCell(const Run &run) const
+{
+    Cell cell(run.tileset ? mTilesets.at(run.tileset - 1) : nullptr, run.tileId);
+    cell.setFlippedHorizontally(run.flags & 0x01);
+    cell.setFlippedVertically(run.flags & 0x02);
+    cell.setFlippedAntiDiagonally(run.flags & 0x04);
+    cell.setRotatedHexagonal120(run.flags & 0x08);
+    cell.setChecked(run.flags & 0x10);
+    return cell;
+}
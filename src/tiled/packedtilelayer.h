@@ -0,0 +1,96 @@
+/*
+ * packedtilelayer.h
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QHash>
+#include <QPoint>
+#include <QRegion>
+#include <QVector>
+
+#include <memory>
+
+namespace Tiled {
+
+class Cell;
+class Chunk;
+class TileLayer;
+class Tileset;
+
+/**
+ * A compact copy of cells of tile layers, used to store the undo history of
+ * tile painting.
+ *
+ * The cells are stored per chunk, as runs of equal cells. Tilesets are
+ * referred to by index, so a run takes 8 bytes rather than the 16 bytes a
+ * single Cell takes. The chunks are implicitly shared, so copying is cheap
+ * and changing cells only touches the affected chunks.
+ *
+ * Positions are in map coordinates.
+ */
+class PackedTileLayer
+{
+public:
+    /**
+     * Copies the cells of \a layer within \a region. The cell at \a pos is
+     * taken from \a pos - \a offset in \a layer.
+     */
+    void setCells(const TileLayer &layer, QPoint offset, const QRegion &region);
+
+    /**
+     * Copies the cells of \a other within \a region.
+     */
+    void setCells(const PackedTileLayer &other, const QRegion &region);
+
+    /**
+     * Returns a tile layer with the stored cells at their position.
+     */
+    std::unique_ptr<TileLayer> unpack() const;
+
+    /**
+     * Returns the approximate amount of memory used to store the cells.
+     */
+    qint64 memoryUsage() const;
+
+private:
+    struct Run
+    {
+        qint32 tileId;
+        quint16 tileset;    // index + 1 in mTilesets, 0 for empty cells
+        quint8 flags;
+        quint8 length;      // number of cells - 1
+    };
+
+    using Runs = QVector<Run>;
+
+    template<typename CellAt>
+    void setCells(const QRegion &region, CellAt cellAt);
+
+    void unpack(const Runs &runs, Chunk &chunk) const;
+    Runs pack(const Chunk &chunk);
+
+    Run packCell(const Cell &cell);
+    Cell unpackCell(const Run &run) const;
+
+    QHash<quint64, Runs> mChunks;
+    QVector<Tileset*> mTilesets;
+};
+
+} // namespace Tiled
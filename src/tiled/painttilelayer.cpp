@@ -57,11 +57,8 @@ PaintTileLayer::PaintTileLayer(MapDocument *mapDocument,
 {
     auto &data = mLayerData[target];
 
-    data.mSource.reset(source->clone());
-    data.mErased.reset(new TileLayer);
-    data.mErased->setCells(target->x(), target->y(), target, paintRegion);
-    data.mX = x;
-    data.mY = y;
+    data.mSource.setCells(*source, QPoint(x, y), paintRegion);
+    data.mErased.setCells(*target, target->position(), paintRegion);
     data.mPaintedRegion = paintRegion;
 
     setText(QCoreApplication::translate("Undo Commands", "Paint"));
@@ -75,8 +72,9 @@ void PaintTileLayer::undo()
 {
     for (const std::pair<TileLayer* const, LayerData> &entry : mLayerData) {
         const LayerData &data = entry.second;
+        const auto erased = data.mErased.unpack();
         TilePainter painter(mMapDocument, entry.first);
-        painter.setCells(0, 0, data.mErased.get(), data.mPaintedRegion);
+        painter.setCells(0, 0, erased.get(), data.mPaintedRegion);
     }
 
     QUndoCommand::undo(); // undo child commands
@@ -88,42 +86,23 @@ void PaintTileLayer::redo()
 
     for (const std::pair<TileLayer* const, LayerData> &entry : mLayerData) {
         const LayerData &data = entry.second;
+        const auto source = data.mSource.unpack();
         TilePainter painter(mMapDocument, entry.first);
-        painter.setCells(data.mX, data.mY, data.mSource.get(), data.mPaintedRegion);
+        painter.setCells(0, 0, source.get(), data.mPaintedRegion);
     }
 }
 
 void PaintTileLayer::LayerData::mergeWith(const PaintTileLayer::LayerData &o)
 {
-    if (!mSource) {
-        mSource.reset(o.mSource->clone());
-        mErased.reset(o.mErased->clone());
-        mX = o.mX;
-        mY = o.mY;
-        mPaintedRegion = o.mPaintedRegion;
-        return;
-    }
-
-    const QRegion combinedRegion = mPaintedRegion.united(o.mPaintedRegion);
-    const QRegion newRegion = combinedRegion.subtracted(mPaintedRegion);
+    const QRegion newRegion = o.mPaintedRegion.subtracted(mPaintedRegion);
 
     // Copy the painted tiles from the other command over
-    mPaintedRegion = combinedRegion;
-    mSource->setCells(o.mX - mSource->x(),
-                      o.mY - mSource->y(),
-                      o.mSource.get(),
-                      o.mPaintedRegion.translated(-mSource->position()));
+    mSource.setCells(o.mSource, o.mPaintedRegion);
 
     // Copy the newly erased tiles from the other command over
-#if QT_VERSION >= 0x050800
-    for (const QRect &rect : newRegion)
-#else
-    const auto rects = newRegion.rects();
-    for (const QRect &rect : rects)
-#endif
-        for (int y = rect.top(); y <= rect.bottom(); ++y)
-            for (int x = rect.left(); x <= rect.right(); ++x)
-                mErased->setCell(x, y, o.mErased->cellAt(x, y));
+    mErased.setCells(o.mErased, newRegion);
+
+    mPaintedRegion |= o.mPaintedRegion;
 }
 
 bool PaintTileLayer::mergeWith(const QUndoCommand *other)
@@ -139,3 +118,22 @@ bool PaintTileLayer::mergeWith(const QUndoCommand *other)
 
     return true;
 }
+
+qint64 PaintTileLayer::memoryUsage() const
+{
+    qint64 usage = 0;
+
+    for (const std::pair<TileLayer* const, LayerData> &entry : mLayerData) {
+        const LayerData &data = entry.second;
+        usage += data.mSource.memoryUsage();
+        usage += data.mErased.memoryUsage();
+        usage += data.mPaintedRegion.rectCount() * sizeof(QRect);
+    }
+
+    return usage;
+}
+
+void PaintTileLayer::releaseMemory()
+{
+    mLayerData.clear();
+}
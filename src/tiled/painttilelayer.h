@@ -20,12 +20,12 @@
 
 #pragma once
 
+#include "packedtilelayer.h"
 #include "undocommands.h"
 
 #include <QRegion>
 #include <QUndoCommand>
 
-#include <memory>
 #include <unordered_map>
 
 namespace Tiled {
@@ -39,8 +39,11 @@ class MapDocument;
  *
  * Can merge with additional commands, even when they paint on different
  * tile layers.
+ *
+ * The painted and erased cells are stored in PackedTileLayer instances, to
+ * keep the undo history small during long painting sessions.
  */
-class PaintTileLayer : public QUndoCommand
+class PaintTileLayer : public QUndoCommand, public MemoryReportingUndoCommand
 {
 public:
     /**
@@ -88,14 +91,16 @@ public:
     int id() const override { return Cmd_PaintTileLayer; }
     bool mergeWith(const QUndoCommand *other) override;
 
+    qint64 memoryUsage() const override;
+    void releaseMemory() override;
+
 private:
     struct LayerData
     {
         void mergeWith(const LayerData &o);
 
-        std::unique_ptr<TileLayer> mSource;
-        std::unique_ptr<TileLayer> mErased;
-        int mX, mY;
+        PackedTileLayer mSource;
+        PackedTileLayer mErased;
         QRegion mPaintedRegion;
     };
 
@@ -675,6 +675,24 @@ bool Preferences::wheelZoomsByDefault() const
     return get("Interface/WheelZoomsByDefault", false);
 }
 
+/**
+ * Returns the maximum amount of memory, in megabytes, the undo history of
+ * a map may use. A value of 0, the default, means there is no limit.
+ */
+int Preferences::undoMemoryLimit() const
+{
+    return get("Interface/UndoMemoryLimit", 0);
+}
+
+/**
+ * Returns the maximum amount of memory, in megabytes, used for caching the
+ * rendered tile layers in the map view. A value of 0 disables the cache.
+ */
+int Preferences::tileLayerCacheLimit() const
+{
+    return get("Interface/TileLayerCacheLimit", 256);
+}
+
 void Preferences::setRestoreSessionOnStartup(bool enabled)
 {
     setValue(QLatin1String("Startup/RestorePreviousSession"), enabled);
@@ -715,6 +733,18 @@ void Preferences::setWheelZoomsByDefault(bool mode)
     setValue(QLatin1String("Interface/WheelZoomsByDefault"), mode);
 }
 
+void Preferences::setUndoMemoryLimit(int megabytes)
+{
+    setValue(QLatin1String("Interface/UndoMemoryLimit"), megabytes);
+    emit undoMemoryLimitChanged(megabytes);
+}
+
+void Preferences::setTileLayerCacheLimit(int megabytes)
+{
+    setValue(QLatin1String("Interface/TileLayerCacheLimit"), megabytes);
+    emit tileLayerCacheLimitChanged(megabytes);
+}
+
 QString Preferences::dataLocation()
 {
     return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
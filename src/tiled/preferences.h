@@ -175,6 +175,9 @@ public:
 
     bool wheelZoomsByDefault() const;
 
+    int undoMemoryLimit() const;
+    int tileLayerCacheLimit() const;
+
     template <typename T>
     T get(const char *key, const T &defaultValue = T()) const
     { return value(QLatin1String(key), defaultValue).template value<T>(); }
@@ -203,6 +206,8 @@ public slots:
     void setRestoreSessionOnStartup(bool enabled);
     void setPluginEnabled(const QString &fileName, bool enabled);
     void setWheelZoomsByDefault(bool mode);
+    void setUndoMemoryLimit(int megabytes);
+    void setTileLayerCacheLimit(int megabytes);
 
     void clearRecentFiles();
     void clearRecentProjects();
@@ -243,6 +248,9 @@ signals:
     void checkForUpdatesChanged(bool on);
     void displayNewsChanged(bool on);
 
+    void undoMemoryLimitChanged(int megabytes);
+    void tileLayerCacheLimitChanged(int megabytes);
+
     void aboutToSwitchSession();
 
 private:
@@ -13,7 +13,7 @@ win32 {
     DESTDIR = ../../bin
 }
 
-QT += widgets qml
+QT += widgets qml concurrent
 
 DEFINES += TILED_VERSION=$${TILED_VERSION}
 
@@ -65,6 +65,7 @@ SOURCES += aboutdialog.cpp \
     automapperwrapper.cpp \
     automappingmanager.cpp \
     automappingutils.cpp  \
+    batchexporter.cpp \
     brokenlinks.cpp \
     brushitem.cpp \
     bucketfilltool.cpp \
@@ -101,6 +102,7 @@ SOURCES += aboutdialog.cpp \
     commandlineparser.cpp \
     commandmanager.cpp \
     commandsedit.cpp \
+    compiledrule.cpp \
     consoledock.cpp \
     createellipseobjecttool.cpp \
     createobjecttool.cpp \
@@ -190,6 +192,7 @@ SOURCES += aboutdialog.cpp \
     objecttypesmodel.cpp \
     offsetlayer.cpp \
     offsetmapdialog.cpp \
+    packedtilelayer.cpp \
     painttilelayer.cpp \
     pluginlistmodel.cpp \
     pointhandle.cpp \
@@ -247,6 +250,7 @@ SOURCES += aboutdialog.cpp \
     tiledproxystyle.cpp \
     tilelayeredit.cpp \
     tilelayeritem.cpp \
+    tilelayerjournal.cpp \
     tilepainter.cpp \
     tileselectionitem.cpp \
     tileselectiontool.cpp \
@@ -305,6 +309,7 @@ HEADERS += aboutdialog.h \
     automapperwrapper.h \
     automappingmanager.h \
     automappingutils.h \
+    batchexporter.h \
     brokenlinks.h \
     brushitem.h \
     bucketfilltool.h \
@@ -342,6 +347,7 @@ HEADERS += aboutdialog.h \
     commandlineparser.h \
     commandmanager.h \
     commandsedit.h \
+    compiledrule.h \
     consoledock.h \
     createellipseobjecttool.h \
     createobjecttool.h \
@@ -431,6 +437,7 @@ HEADERS += aboutdialog.h \
     objecttypesmodel.h \
     offsetlayer.h \
     offsetmapdialog.h \
+    packedtilelayer.h \
     painttilelayer.h \
     pluginlistmodel.h \
     pointhandle.h \
@@ -491,6 +498,7 @@ HEADERS += aboutdialog.h \
     tiledproxystyle.h \
     tilelayeredit.h \
     tilelayeritem.h \
+    tilelayerjournal.h \
     tilepainter.h \
     tileselectionitem.h \
     tileselectiontool.h \
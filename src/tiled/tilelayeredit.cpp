@@ -24,9 +24,14 @@
 #include "editablemap.h"
 #include "editabletile.h"
 #include "editabletilelayer.h"
+#include "gidmapper.h"
 #include "painttilelayer.h"
 #include "scriptmanager.h"
 
+#include <QCoreApplication>
+
+#include <cstring>
+
 namespace Tiled {
 
 TileLayerEdit::TileLayerEdit(EditableTileLayer *tileLayer, QObject *parent)
@@ -58,6 +63,52 @@ void TileLayerEdit::setTile(int x, int y, EditableTile *tile, int flags)
     mChanges.setCell(x, y, cell);
 }
 
+/**
+ * Sets the cells in the given rectangle from an array of global tile IDs,
+ * as returned by EditableTileLayer::gids(). A GID of 0 erases the cell.
+ */
+void TileLayerEdit::setGids(int x, int y, int width, int height, const QByteArray &gids)
+{
+    if (width < 0 || height < 0 || qint64(width) * height * 4 != gids.size()) {
+        ScriptManager::instance().throwError(QCoreApplication::translate("Script Errors", "Invalid argument"));
+        return;
+    }
+
+    const Map *map = mTargetLayer->tileLayer()->map();
+    if (!map) {
+        ScriptManager::instance().throwError(QCoreApplication::translate("Script Errors", "Layer not part of a map"));
+        return;
+    }
+
+    const GidMapper gidMapper(map->tilesets());
+    const char *in = gids.constData();
+
+    // Decode all cells first, so that nothing is changed on error
+    QVector<Cell> cells;
+    cells.reserve(width * height);
+
+    for (int i = 0; i < width * height; ++i) {
+        quint32 gid;
+        std::memcpy(&gid, in, sizeof(gid));
+        in += sizeof(gid);
+
+        bool ok;
+        Cell cell = gidMapper.gidToCell(gid, ok);
+        if (!ok) {
+            ScriptManager::instance().throwError(QCoreApplication::translate("Script Errors", "Invalid tile GID: %1").arg(gid));
+            return;
+        }
+
+        cell.setChecked(true);  // Used to find painted region later (allows erasing)
+        cells.append(cell);
+    }
+
+    const Cell *cell = cells.constData();
+    for (int cy = y; cy < y + height; ++cy)
+        for (int cx = x; cx < x + width; ++cx)
+            mChanges.setCell(cx, cy, *cell++);
+}
+
 void TileLayerEdit::apply()
 {
     // Applying an edit automatically makes it mergeable, so that further
@@ -24,14 +24,82 @@
 #include "mapdocument.h"
 #include "maprenderer.h"
 #include "mapview.h"
+#include "preferences.h"
 #include "tile.h"
 #include "zoomable.h"
 
+#include <QCache>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+#include <algorithm>
+
+#include "qtcompat_p.h"
 
 using namespace Tiled;
 
+namespace {
+
+// Size of the blocks in the raster cache, in device pixels
+constexpr int CacheBlockSize = 256;
+
+struct CacheKey
+{
+    const TileLayerItem *item;
+    quint64 block;
+
+    bool operator==(const CacheKey &other) const
+    {
+        return item == other.item && block == other.block;
+    }
+};
+
+uint qHash(const CacheKey &key, uint seed = 0) Q_DECL_NOTHROW
+{
+    return ::qHash(key.block, ::qHash(key.item, seed));
+}
+
+} // anonymous namespace
+
+static quint64 blockKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+/**
+ * The pre-rendered blocks of all tile layers, shared so that they are bound
+ * by a single memory budget. The cost of a block is in kilobytes.
+ */
+static QCache<CacheKey, QPixmap> &blockCache()
+{
+    static QCache<CacheKey, QPixmap> cache;
+    return cache;
+}
+
+/**
+ * Returns the memory budget of the block cache in megabytes. It is read
+ * from the preferences once and then kept up to date.
+ */
+static int cacheLimit()
+{
+    static int limit = -1;
+
+    if (limit == -1) {
+        Preferences *prefs = Preferences::instance();
+        limit = prefs->tileLayerCacheLimit();
+        blockCache().setMaxCost(qMax(0, limit) * 1024);
+
+        QObject::connect(prefs, &Preferences::tileLayerCacheLimitChanged,
+                         [] (int megabytes) {
+            limit = megabytes;
+            blockCache().setMaxCost(qMax(0, limit) * 1024);
+        });
+    }
+
+    return limit;
+}
+
 TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument, QGraphicsItem *parent)
     : LayerItem(layer, parent)
     , mMapDocument(mapDocument)
@@ -41,6 +109,11 @@ TileLayerItem::TileLayerItem(TileLayer *layer, MapDocument *mapDocument, QGraphi
     syncWithTileLayer();
 }
 
+TileLayerItem::~TileLayerItem()
+{
+    clearCache();
+}
+
 void TileLayerItem::syncWithTileLayer()
 {
     prepareGeometryChange();
@@ -62,6 +135,125 @@ void TileLayerItem::syncWithTileLayer()
                                           -margins.top(),
                                           margins.right(),
                                           margins.bottom());
+
+    mAnimatedCellsDirty = true;
+}
+
+void TileLayerItem::repaintTiles(Tileset *tileset, const QVector<Tile *> &tiles)
+{
+    if (!tileLayer()->referencesTileset(tileset))
+        return;
+
+    // Re-index when tiles were added to or removed from the set of animated
+    // tiles, since we may not know their positions yet.
+    if (mAnimatedCellsDirty || mIndexedAnimatedTiles.value(tileset) != tileset->animatedTiles())
+        indexAnimatedCells();
+
+    QVector<const QVector<QPoint>*> changedCells;
+    int changedCellCount = 0;
+
+    for (const Tile *tile : tiles) {
+        auto it = mAnimatedCells.constFind(tile);
+        if (it != mAnimatedCells.constEnd()) {
+            changedCells.append(&it.value());
+            changedCellCount += it.value().size();
+        }
+    }
+
+    if (changedCellCount == 0)
+        return;
+
+    // Beyond a certain amount of cells, a full repaint is cheaper
+    if (changedCellCount > 1024) {
+        repaint();
+        return;
+    }
+
+    const MapRenderer *renderer = mMapDocument->renderer();
+    const QMargins margins = mMapDocument->map()->drawMargins();
+    const QPoint layerPosition = tileLayer()->position();
+
+    for (const QVector<QPoint> *positions : qAsConst(changedCells)) {
+        for (const QPoint &pos : *positions) {
+            const QRect cellRect(pos + layerPosition, QSize(1, 1));
+            repaint(renderer->boundingRect(cellRect).adjusted(-margins.left(),
+                                                              -margins.top(),
+                                                              margins.right(),
+                                                              margins.bottom()));
+        }
+    }
+}
+
+void TileLayerItem::invalidateAnimatedCells(const QRegion &region)
+{
+    if (mAnimatedCellsDirty)
+        return;
+
+    // Large changes are handled by re-indexing on the next animation step
+    const QRect boundingRect = region.boundingRect();
+    if (boundingRect.width() * boundingRect.height() > 64 * 64) {
+        mAnimatedCellsDirty = true;
+        return;
+    }
+
+    for (auto it = mAnimatedCells.begin(); it != mAnimatedCells.end(); ) {
+        QVector<QPoint> &positions = it.value();
+        positions.erase(std::remove_if(positions.begin(), positions.end(),
+                                       [&] (const QPoint &pos) { return region.contains(pos); }),
+                        positions.end());
+
+        if (positions.isEmpty())
+            it = mAnimatedCells.erase(it);
+        else
+            ++it;
+    }
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects)
+#else
+    for (const QRect &rect : region)
+#endif
+        indexAnimatedCells(rect);
+}
+
+void TileLayerItem::indexAnimatedCells()
+{
+    mAnimatedCells.clear();
+    mIndexedAnimatedTiles.clear();
+    mAnimatedCellsDirty = false;
+
+    bool hasAnimatedTiles = false;
+
+    const auto usedTilesets = tileLayer()->usedTilesets();
+    for (const SharedTileset &tileset : usedTilesets) {
+        const QVector<Tile*> &animatedTiles = tileset->animatedTiles();
+        mIndexedAnimatedTiles.insert(tileset.data(), animatedTiles);
+        hasAnimatedTiles |= !animatedTiles.isEmpty();
+    }
+
+    if (!hasAnimatedTiles)
+        return;
+
+    const TileLayer &layer = *tileLayer();
+    for (auto it = layer.begin(), it_end = layer.end(); it != it_end; ++it) {
+        const Tile *tile = it.value().tile();
+        if (tile && tile->isAnimated())
+            mAnimatedCells[tile].append(it.key());
+    }
+}
+
+void TileLayerItem::indexAnimatedCells(const QRect &rect)
+{
+    const TileLayer &layer = *tileLayer();
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            const Tile *tile = layer.cellAt(x, y).tile();
+            if (tile && tile->isAnimated())
+                mAnimatedCells[tile].append(QPoint(x, y));
+        }
+    }
 }
 
 QRectF TileLayerItem::boundingRect() const
@@ -77,6 +269,124 @@ void TileLayerItem::paint(QPainter *painter,
 
     MapRenderer *renderer = mMapDocument->renderer();
     renderer->setPainterScale(scale);
-    // TODO: Display a border around the layer when selected
-    renderer->drawTileLayer(painter, tileLayer(), option->exposedRect);
+
+    // The cached blocks can only be drawn pixel-aligned when the painter
+    // only scales and translates
+    if (cacheLimit() > 0 && painter->transform().type() <= QTransform::TxScale) {
+        paintCached(painter, option->exposedRect, scale);
+    } else {
+        // TODO: Display a border around the layer when selected
+        renderer->drawTileLayer(painter, tileLayer(), option->exposedRect);
+    }
+}
+
+void TileLayerItem::repaint(const QRectF &rect)
+{
+    if (!mCachedBlocks.isEmpty()) {
+        const qreal blockSize = CacheBlockSize / mCacheScale;
+        const int left = qFloor(rect.left() / blockSize);
+        const int top = qFloor(rect.top() / blockSize);
+        const int right = qCeil(rect.right() / blockSize) - 1;
+        const int bottom = qCeil(rect.bottom() / blockSize) - 1;
+
+        QCache<CacheKey, QPixmap> &cache = blockCache();
+
+        for (int y = top; y <= bottom; ++y) {
+            for (int x = left; x <= right; ++x) {
+                const quint64 block = blockKey(x, y);
+                if (mCachedBlocks.remove(block))
+                    cache.remove(CacheKey { this, block });
+            }
+        }
+    }
+
+    update(rect);
+}
+
+void TileLayerItem::repaint()
+{
+    clearCache();
+    update();
+}
+
+/**
+ * Paints the exposed part of the layer from blocks of pre-rendered pixmaps,
+ * rendering the blocks that are not in the cache.
+ *
+ * The blocks are aligned to a grid of CacheBlockSize device pixels, so that
+ * drawing them does not require any scaling.
+ */
+void TileLayerItem::paintCached(QPainter *painter, const QRectF &exposed, qreal scale)
+{
+    const qreal devicePixelRatio = painter->device()->devicePixelRatioF();
+    const qreal deviceScale = scale * devicePixelRatio;
+
+    if (mCacheScale != deviceScale) {
+        clearCache();
+        mCacheScale = deviceScale;
+    }
+
+    const QRectF area = exposed & mBoundingRect;
+    if (area.isEmpty())
+        return;
+
+    const qreal blockSize = CacheBlockSize / deviceScale;
+    const int left = qFloor(area.left() / blockSize);
+    const int top = qFloor(area.top() / blockSize);
+    const int right = qCeil(area.right() / blockSize) - 1;
+    const int bottom = qCeil(area.bottom() / blockSize) - 1;
+
+    QCache<CacheKey, QPixmap> &cache = blockCache();
+    const int cost = CacheBlockSize * CacheBlockSize * 4 / 1024;
+
+    const bool smoothPixmapTransform = painter->testRenderHint(QPainter::SmoothPixmapTransform);
+    const QPainter::RenderHints renderHints = painter->renderHints();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x) {
+            const QRectF blockRect(x * blockSize, y * blockSize, blockSize, blockSize);
+            const CacheKey key { this, blockKey(x, y) };
+
+            QPixmap pixmap;
+            if (const QPixmap *cached = cache.object(key)) {
+                pixmap = *cached;
+            } else {
+                pixmap = renderBlock(blockRect, scale, devicePixelRatio, renderHints);
+                cache.insert(key, new QPixmap(pixmap), cost);
+                mCachedBlocks.insert(key.block);
+            }
+
+            painter->drawPixmap(blockRect, pixmap, QRectF(QPointF(), pixmap.size()));
+        }
+    }
+
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, smoothPixmapTransform);
+}
+
+QPixmap TileLayerItem::renderBlock(const QRectF &blockRect, qreal scale,
+                                   qreal devicePixelRatio,
+                                   QPainter::RenderHints hints) const
+{
+    QPixmap pixmap(CacheBlockSize, CacheBlockSize);
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter(&pixmap);
+    painter.setRenderHints(hints);
+    painter.scale(scale, scale);
+    painter.translate(-blockRect.topLeft());
+
+    mMapDocument->renderer()->drawTileLayer(&painter, tileLayer(), blockRect);
+
+    return pixmap;
+}
+
+void TileLayerItem::clearCache()
+{
+    QCache<CacheKey, QPixmap> &cache = blockCache();
+    for (const quint64 block : qAsConst(mCachedBlocks))
+        cache.remove(CacheKey { this, block });
+
+    mCachedBlocks.clear();
 }
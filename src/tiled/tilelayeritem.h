@@ -24,6 +24,11 @@
 
 #include "tilelayer.h"
 
+#include <QHash>
+#include <QPainter>
+#include <QSet>
+#include <QVector>
+
 namespace Tiled {
 
 class MapDocument;
@@ -41,6 +46,7 @@ public:
      * @param mapDocument the map document owning the map of this layer
      */
     TileLayerItem(TileLayer *layer, MapDocument *mapDocument, QGraphicsItem *parent = nullptr);
+    ~TileLayerItem() override;
 
     TileLayer *tileLayer() const;
 
@@ -54,6 +60,28 @@ public:
      */
     void syncWithTileLayer();
 
+    /**
+     * Repaints the cells referring to any of the given animated \a tiles.
+     */
+    void repaintTiles(Tileset *tileset, const QVector<Tile*> &tiles);
+
+    /**
+     * Should be called when the cells in the given \a region (in layer
+     * coordinates) have changed, to keep the index of animated cells valid.
+     */
+    void invalidateAnimatedCells(const QRegion &region);
+
+    /**
+     * Repaints the given \a rect (in item coordinates), dropping its cached
+     * rendering.
+     */
+    void repaint(const QRectF &rect);
+
+    /**
+     * Repaints the whole layer, dropping its cached rendering.
+     */
+    void repaint();
+
     // QGraphicsItem
     QRectF boundingRect() const override;
     void paint(QPainter *painter,
@@ -61,8 +89,26 @@ public:
                QWidget *widget = nullptr) override;
 
 private:
+    void indexAnimatedCells();
+    void indexAnimatedCells(const QRect &rect);
+
+    void paintCached(QPainter *painter, const QRectF &exposed, qreal scale);
+    QPixmap renderBlock(const QRectF &blockRect, qreal scale,
+                        qreal devicePixelRatio, QPainter::RenderHints hints) const;
+    void clearCache();
+
     MapDocument *mMapDocument;
     QRectF mBoundingRect;
+
+    // Blocks of the rendered layer that may be in the raster cache, which
+    // are only valid for the device scale they were rendered at
+    QSet<quint64> mCachedBlocks;
+    qreal mCacheScale = 0;
+
+    // Positions of cells referring to animated tiles, by tile
+    QHash<const Tile*, QVector<QPoint>> mAnimatedCells;
+    QHash<const Tileset*, QVector<Tile*>> mIndexedAnimatedTiles;
+    bool mAnimatedCellsDirty = true;
 };
 
 inline TileLayer *TileLayerItem::tileLayer() const
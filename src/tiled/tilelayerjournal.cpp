@@ -0,0 +1,151 @@
+/*
+ * tilelayerjournal.cpp
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tilelayerjournal.h"
+
+#include "regionbuilder.h"
+#include "tilelayer.h"
+
+#include "qtcompat_p.h"
+
+using namespace Tiled;
+
+static quint64 chunkKey(QPoint chunk)
+{
+    return (quint64(quint32(chunk.x())) << 32) | quint32(chunk.y());
+}
+
+void TileLayerJournal::recordCell(TileLayer *layer, int x, int y)
+{
+    LayerRecord &layerRecord = record(layer);
+    const QPoint chunk(x >> CHUNK_BITS, y >> CHUNK_BITS);
+
+    if (!layerRecord.recordedChunks.contains(chunkKey(chunk)))
+        recordChunk(layerRecord, *layer, chunk);
+}
+
+void TileLayerJournal::recordRegion(TileLayer *layer, const QRegion &region)
+{
+    LayerRecord &layerRecord = record(layer);
+
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        for (int y = rect.top() >> CHUNK_BITS; y <= rect.bottom() >> CHUNK_BITS; ++y) {
+            for (int x = rect.left() >> CHUNK_BITS; x <= rect.right() >> CHUNK_BITS; ++x) {
+                const QPoint chunk(x, y);
+                if (!layerRecord.recordedChunks.contains(chunkKey(chunk)))
+                    recordChunk(layerRecord, *layer, chunk);
+            }
+        }
+    }
+}
+
+std::vector<TileLayerJournal::Change> TileLayerJournal::changes() const
+{
+    std::vector<Change> result;
+
+    for (TileLayer *layer : mLayers) {
+        const LayerRecord &layerRecord = mRecords.at(layer);
+        const TileLayer &before = *layerRecord.before;
+
+        RegionBuilder builder;
+
+        for (const QPoint &chunk : layerRecord.chunks) {
+            const QRect r(chunk * CHUNK_SIZE, QSize(CHUNK_SIZE, CHUNK_SIZE));
+
+            for (int y = r.top(); y <= r.bottom(); ++y) {
+                for (int x = r.left(); x <= r.right(); ++x) {
+                    if (before.cellAt(x, y) != layer->cellAt(x, y)) {
+                        const int rangeStart = x;
+                        while (x <= r.right() && before.cellAt(x, y) != layer->cellAt(x, y))
+                            ++x;
+                        builder.addSpan(y, rangeStart, x - 1);
+                    }
+                }
+            }
+        }
+
+        if (builder.isEmpty())
+            continue;
+
+        const QRegion region = builder.region();
+
+        const QPoint topLeft = region.boundingRect().topLeft();
+
+        Change change;
+        change.layer = layer;
+        change.region = region.translated(layer->position());
+        change.before = before.copy(region);
+        change.after = layer->copy(region);
+        change.before->setPosition(topLeft + layer->position());
+        change.after->setPosition(topLeft + layer->position());
+        change.before->setName(layer->name());
+        change.after->setName(layer->name());
+        change.drawMarginsBefore = layerRecord.drawMargins;
+        change.boundsBefore = layerRecord.bounds;
+
+        result.push_back(std::move(change));
+    }
+
+    return result;
+}
+
+void TileLayerJournal::clear()
+{
+    mRecords.clear();
+    mLayers.clear();
+}
+
+TileLayerJournal::LayerRecord &TileLayerJournal::record(TileLayer *layer)
+{
+    auto it = mRecords.find(layer);
+    if (it != mRecords.end())
+        return it->second;
+
+    LayerRecord &layerRecord = mRecords[layer];
+    layerRecord.before = std::make_unique<TileLayer>(QString(), 0, 0, 0, 0);
+    layerRecord.drawMargins = layer->drawMargins();
+    layerRecord.bounds = layer->bounds();
+
+    mLayers.append(layer);
+    return layerRecord;
+}
+
+void TileLayerJournal::recordChunk(LayerRecord &layerRecord,
+                                   const TileLayer &layer,
+                                   QPoint chunk)
+{
+    layerRecord.recordedChunks.insert(chunkKey(chunk));
+    layerRecord.chunks.append(chunk);
+
+    const QPoint start = chunk * CHUNK_SIZE;
+
+    // Nothing to record when the chunk doesn't exist yet
+    if (!layer.findChunk(start.x(), start.y()))
+        return;
+
+    for (int y = start.y(); y < start.y() + CHUNK_SIZE; ++y)
+        for (int x = start.x(); x < start.x() + CHUNK_SIZE; ++x)
+            layerRecord.before->setCell(x, y, layer.cellAt(x, y));
+}
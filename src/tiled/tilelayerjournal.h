@@ -0,0 +1,96 @@
+/*
+ * tilelayerjournal.h
+ * Copyright 2020, Thorbjørn Lindeijer <bjorn@lindeijer.nl>
+ *
+ * This file is part of Tiled.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QMargins>
+#include <QRect>
+#include <QRegion>
+#include <QSet>
+#include <QVector>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Tiled {
+
+class TileLayer;
+
+/**
+ * Records the contents of tile layers before they are modified.
+ *
+ * The cells are recorded a chunk at a time, the first time a chunk is about
+ * to be modified. This way the cost of finding out what changed scales with
+ * the modified area rather than with the size of the layers.
+ */
+class TileLayerJournal
+{
+public:
+    /**
+     * The changes made to a single tile layer.
+     */
+    struct Change
+    {
+        TileLayer *layer;
+        QRegion region;                     // the changed cells, in map coordinates
+        std::unique_ptr<TileLayer> before;  // positioned at the region's bounds
+        std::unique_ptr<TileLayer> after;   // positioned at the region's bounds
+        QMargins drawMarginsBefore;
+        QRect boundsBefore;
+    };
+
+    /**
+     * Records the cell at \a x, \a y of the given \a layer, unless it was
+     * already recorded. Needs to be called before modifying the cell.
+     */
+    void recordCell(TileLayer *layer, int x, int y);
+
+    /**
+     * Records the cells of the given \a layer within \a region.
+     */
+    void recordRegion(TileLayer *layer, const QRegion &region);
+
+    /**
+     * Compares the recorded cells to the current contents of their layers.
+     * Only layers with changed cells are returned.
+     */
+    std::vector<Change> changes() const;
+
+    void clear();
+
+private:
+    struct LayerRecord
+    {
+        std::unique_ptr<TileLayer> before;
+        QSet<quint64> recordedChunks;
+        QVector<QPoint> chunks;             // in the order they were recorded
+        QMargins drawMargins;
+        QRect bounds;
+    };
+
+    LayerRecord &record(TileLayer *layer);
+    void recordChunk(LayerRecord &record, const TileLayer &layer, QPoint chunk);
+
+    std::unordered_map<TileLayer*, LayerRecord> mRecords;
+    QVector<TileLayer*> mLayers;            // in the order they were recorded
+};
+
+} // namespace Tiled
@@ -23,6 +23,7 @@
 
 #include "mapdocument.h"
 #include "map.h"
+#include "regionbuilder.h"
 
 #include <QQueue>
 
@@ -196,6 +197,42 @@ void TilePainter::erase(const QRegion &region)
     emit mMapDocument->regionChanged(paintable, mTileLayer);
 }
 
+namespace {
+
+/**
+ * Looks up the cells of a tile layer, remembering the last chunk that was
+ * accessed. The flood fill walks along rows, so most lookups end up in the
+ * same chunk as the previous one.
+ */
+class CellLookup
+{
+public:
+    explicit CellLookup(const TileLayer *layer)
+        : mLayer(layer)
+    {}
+
+    const Cell &cellAt(int x, int y)
+    {
+        const QPoint chunkCoordinates(x >> CHUNK_BITS, y >> CHUNK_BITS);
+        if (!mHasChunk || chunkCoordinates != mChunkCoordinates) {
+            mChunk = mLayer->findChunk(x, y);
+            mChunkCoordinates = chunkCoordinates;
+            mHasChunk = true;
+        }
+
+        return mChunk ? mChunk->cellAt(x & CHUNK_MASK, y & CHUNK_MASK)
+                      : Cell::empty;
+    }
+
+private:
+    const TileLayer *mLayer;
+    const Chunk *mChunk = nullptr;
+    QPoint mChunkCoordinates;
+    bool mHasChunk = false;
+};
+
+} // anonymous namespace
+
 static QRegion fillRegion(const TileLayer *layer,
                           const QRegion &region,
                           QPoint fillOrigin,
@@ -209,6 +246,7 @@ static QRegion fillRegion(const TileLayer *layer,
 
     // Cache cell that we will match other cells against
     const Cell matchCell = layer->cellAt(fillOrigin);
+    CellLookup cells(layer);
 
     const QRect bounds = region.boundingRect();
     const int width = bounds.width();
@@ -225,7 +263,7 @@ static QRegion fillRegion(const TileLayer *layer,
     // This is faster than checking if a given cell is in the region/list
     QVector<bool> processedCellsVec(width * height);
     bool *processedCells = processedCellsVec.data();
-    QRegion fillRegion;
+    RegionBuilder fillRegion;
 
     // Loop through queued positions and fill them, while at the same time
     // checking adjacent positions to see if they should be added
@@ -235,20 +273,20 @@ static QRegion fillRegion(const TileLayer *layer,
 
         // Seek as far left as we can
         int left = currentPoint.x();
-        while (left > bounds.left() && layer->cellAt(left - 1, currentPoint.y()) == matchCell) {
+        while (left > bounds.left() && cells.cellAt(left - 1, currentPoint.y()) == matchCell) {
             --left;
             processedCells[indexOffset + startOfLine + left] = true;
         }
 
         // Seek as far right as we can
         int right = currentPoint.x();
-        while (right < bounds.right() && layer->cellAt(right + 1, currentPoint.y()) == matchCell) {
+        while (right < bounds.right() && cells.cellAt(right + 1, currentPoint.y()) == matchCell) {
             ++right;
             processedCells[indexOffset + startOfLine + right] = true;
         }
 
         // Add cells between left and right to the region
-        fillRegion += QRegion(left, currentPoint.y(), right - left + 1, 1);
+        fillRegion.addSpan(currentPoint.y(), left, right);
 
         bool leftColumnIsStaggered = false;
         bool rightColumnIsStaggered = false;
@@ -269,13 +307,13 @@ static QRegion fillRegion(const TileLayer *layer,
 
         // Loop between left and right and check if cells above or below need
         // to be added to the queue.
-        auto findFillPositions = [=,&fillPositions](int left, int right, int y) {
+        auto findFillPositions = [=,&fillPositions,&cells](int left, int right, int y) {
             bool adjacentCellAdded = false;
 
             for (int x = left; x <= right; ++x) {
                 const int index = y * width + x;
 
-                if (!processedCells[indexOffset + index] && layer->cellAt(x, y) == matchCell) {
+                if (!processedCells[indexOffset + index] && cells.cellAt(x, y) == matchCell) {
                     // Do not add the cell to the queue if an adjacent cell was added.
                     if (!adjacentCellAdded) {
                         fillPositions.enqueue(QPoint(x, y));
@@ -318,7 +356,7 @@ static QRegion fillRegion(const TileLayer *layer,
         }
     }
 
-    return fillRegion;
+    return fillRegion.region();
 }
 
 QRegion TilePainter::computePaintableFillRegion(QPoint fillOrigin) const
@@ -20,6 +20,8 @@
 
 #include "undocommands.h"
 
+#include "tilelayer.h"
+
 #include <QUndoCommand>
 
 namespace Tiled {
@@ -40,4 +42,47 @@ bool cloneChildren(const QUndoCommand *command, QUndoCommand *parent)
     return true;
 }
 
+/**
+ * Returns the approximate number of bytes held by the given \a command and
+ * its children. Commands that don't implement MemoryReportingUndoCommand
+ * are assumed to hold a negligible amount of memory.
+ */
+qint64 undoCommandMemoryUsage(const QUndoCommand *command)
+{
+    qint64 usage = 0;
+
+    if (auto reporting = dynamic_cast<const MemoryReportingUndoCommand*>(command))
+        usage += reporting->memoryUsage();
+
+    for (int i = 0; i < command->childCount(); ++i)
+        usage += undoCommandMemoryUsage(command->child(i));
+
+    return usage;
+}
+
+/**
+ * Releases the memory held by the given \a command and its children.
+ */
+void releaseUndoCommandMemory(QUndoCommand *command)
+{
+    if (auto reporting = dynamic_cast<MemoryReportingUndoCommand*>(command))
+        reporting->releaseMemory();
+
+    for (int i = 0; i < command->childCount(); ++i)
+        releaseUndoCommandMemory(const_cast<QUndoCommand*>(command->child(i)));
+}
+
+/**
+ * Returns the approximate number of bytes held by the cells of the given
+ * \a tileLayer, for undo commands that keep a copy of tile layer contents.
+ */
+qint64 tileLayerMemoryUsage(const TileLayer *tileLayer)
+{
+    if (!tileLayer)
+        return 0;
+
+    const QRect bounds = tileLayer->localBounds();
+    return qint64(bounds.width()) * bounds.height() * qint64(sizeof(Cell));
+}
+
 } // namespace Tiled
@@ -20,10 +20,14 @@
 
 #pragma once
 
+#include <QtGlobal>
+
 class QUndoCommand;
 
 namespace Tiled {
 
+class TileLayer;
+
 /**
  * These undo command IDs are used by Qt to determine whether two undo commands
  * can be merged.
@@ -55,4 +59,30 @@ public:
 
 bool cloneChildren(const QUndoCommand *command, QUndoCommand *parent);
 
+/**
+ * Interface to be implemented by undo commands that hold on to a significant
+ * amount of memory, like the previous contents of tile layers.
+ */
+class MemoryReportingUndoCommand
+{
+public:
+    virtual ~MemoryReportingUndoCommand() = default;
+
+    /**
+     * Returns the approximate number of bytes held by this command,
+     * excluding its children.
+     */
+    virtual qint64 memoryUsage() const = 0;
+
+    /**
+     * Releases the memory held by this command, after which undoing or
+     * redoing it has no effect. Used for commands dropped from the history.
+     */
+    virtual void releaseMemory() = 0;
+};
+
+qint64 undoCommandMemoryUsage(const QUndoCommand *command);
+void releaseUndoCommandMemory(QUndoCommand *command);
+qint64 tileLayerMemoryUsage(const TileLayer *tileLayer);
+
 } // namespace Tiled
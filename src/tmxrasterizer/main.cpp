@@ -79,10 +79,13 @@ int main(int argc, char *argv[])
                             QCoreApplication::translate("main", "name") },
                           { "advance-animations",
                             QCoreApplication::translate("main", "If used tile animations are advanced by the specified duration."),
-                            QCoreApplication::translate("main", "duration") }
+                            QCoreApplication::translate("main", "duration") },
+                          { "tiles",
+                            QCoreApplication::translate("main", "Renders a world to a pyramid of SIZE x SIZE tiles, written to the output directory as z/x/y.png. Tiles of unchanged maps are skipped."),
+                            QCoreApplication::translate("main", "size") }
                       });
     parser.addPositionalArgument("map|world", QCoreApplication::translate("main", "Map or world file to render."));
-    parser.addPositionalArgument("image", QCoreApplication::translate("main", "Image file to output."));
+    parser.addPositionalArgument("image", QCoreApplication::translate("main", "Image file to output, or directory when using --tiles."));
     parser.process(app);
 
     const QStringList args = parser.positionalArguments();
@@ -138,5 +141,14 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(QLatin1String("tiles"))) {
+        bool ok;
+        w.setPyramidTileSize(parser.value(QLatin1String("tiles")).toInt(&ok));
+        if (!ok || w.pyramidTileSize() < 2) {
+            qWarning().noquote() << QCoreApplication::translate("main", "Invalid tile size specified: \"%1\"").arg(parser.value(QLatin1String("tiles")));
+            exit(1);
+        }
+    }
+
     return w.render(fileToOpen, fileToSave);
 }
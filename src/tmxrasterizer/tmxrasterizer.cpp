@@ -41,9 +41,20 @@
 #include "tilelayer.h"
 #include "worldmanager.h"
 
+#include <QAtomicInt>
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QImageWriter>
+#include <QRunnable>
+#include <QSet>
+#include <QThreadPool>
+#include <QtMath>
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 
 using namespace Tiled;
@@ -70,7 +81,8 @@ TmxRasterizer::TmxRasterizer():
     mAdvanceAnimations(0),
     mUseAntiAliasing(false),
     mSmoothImages(true),
-    mIgnoreVisibility(false)
+    mIgnoreVisibility(false),
+    mPyramidTileSize(0)
 {
 }
 
@@ -148,10 +160,19 @@ bool TmxRasterizer::shouldDrawLayer(const Layer *layer) const
 int TmxRasterizer::render(const QString &fileName,
                           const QString &imageFileName)
 {
-    if (fileName.endsWith(".world", Qt::CaseInsensitive))
+    if (fileName.endsWith(".world", Qt::CaseInsensitive)) {
+        if (mPyramidTileSize > 0)
+            return renderWorldTiles(fileName, imageFileName);
         return renderWorld(fileName, imageFileName);
-    else
-        return renderMap(fileName, imageFileName);
+    }
+
+    if (mPyramidTileSize > 0) {
+        qWarning("Error: Only worlds can be rendered to tiles: \"%s\"",
+                 qUtf8Printable(fileName));
+        return 1;
+    }
+
+    return renderMap(fileName, imageFileName);
 }
 
 int TmxRasterizer::renderMap(const QString &mapFileName,
@@ -303,3 +324,350 @@ int TmxRasterizer::renderWorld(const QString &worldFileName,
 
     return saveImage(imageFileName, image);
 }
+
+namespace {
+
+class FunctionRunnable : public QRunnable
+{
+public:
+    explicit FunctionRunnable(std::function<void()> function)
+        : mFunction(std::move(function))
+    {}
+
+    void run() override { mFunction(); }
+
+private:
+    std::function<void()> mFunction;
+};
+
+struct LoadedMap
+{
+    std::shared_ptr<Map> map;
+    QPoint position;    // position of the map in the world
+    QRect bounds;       // painted area in world coordinates
+};
+
+} // anonymous namespace
+
+static quint64 tileKey(int x, int y)
+{
+    return (quint64(quint32(x)) << 32) | quint32(y);
+}
+
+/**
+ * Renders the world to a tile pyramid, as used by slippy maps. The tiles are
+ * written to \a outputDirectory as z/x/y.png, where the highest zoom level
+ * renders the world at the requested scale and each lower level halves it,
+ * down to zoom level 0 at which the whole world fits in a single tile.
+ *
+ * The highest zoom level is rendered in blocks of tiles, loading only the
+ * maps intersecting each block. Lower zoom levels are built from the tiles
+ * of the level above. Tiles that are newer than the world and all maps
+ * intersecting them are skipped.
+ *
+ * The tiles of the highest zoom level are painted on the main thread and
+ * written by a thread pool, which also builds the lower zoom levels.
+ */
+int TmxRasterizer::renderWorldTiles(const QString &worldFileName,
+                                    const QString &outputDirectory)
+{
+    WorldManager &worldManager = WorldManager::instance();
+    QString errorString;
+    const World *world = worldManager.loadWorld(worldFileName, &errorString);
+    if (!world) {
+        qWarning("Error loading the world file \"%s\":\n%s",
+                 qUtf8Printable(worldFileName),
+                 qUtf8Printable(errorString));
+        return 1;
+    }
+
+    const auto maps = world->allMaps();
+    if (maps.isEmpty()) {
+        qWarning("Error: The world file to rasterize contains no maps : \"%s\"",
+                 qUtf8Printable(worldFileName));
+        return 1;
+    }
+
+    QRect worldRect;
+    for (const World::MapEntry &mapEntry : maps)
+        worldRect |= mapEntry.rect;
+
+    const int tileSize = mPyramidTileSize;
+    const qreal scale = mScale;
+    const qreal tileWorldSize = tileSize / scale;   // at the highest zoom level
+
+    // Zoom in until the world is shown at the requested scale
+    int maxZoom = 0;
+    while (qMax(worldRect.width(), worldRect.height()) > (tileWorldSize * (qint64(1) << maxZoom)))
+        ++maxZoom;
+
+    auto tileFileName = [&] (int z, int x, int y) {
+        return QStringLiteral("%1/%2/%3/%4.png").arg(outputDirectory).arg(z).arg(x).arg(y);
+    };
+    auto makeColumnPath = [&] (int z, int x) {
+        return QDir().mkpath(QStringLiteral("%1/%2/%3").arg(outputDirectory).arg(z).arg(x));
+    };
+    auto tileRect = [&] (int x, int y) {
+        return QRectF(worldRect.left() + x * tileWorldSize,
+                      worldRect.top() + y * tileWorldSize,
+                      tileWorldSize, tileWorldSize);
+    };
+
+    const QDateTime worldModified = QFileInfo(worldFileName).lastModified();
+    QHash<QString, QDateTime> mapModified;
+
+    QThreadPool threadPool;
+    QAtomicInt errors;
+
+    // Tiles that were written or removed at the current zoom level
+    QSet<quint64> changedTiles;
+
+    // Render the highest zoom level from the maps, in blocks of tiles to
+    // limit the amount of maps loaded at the same time
+    const int blockSize = 8;
+    const int columns = qCeil(worldRect.width() / tileWorldSize);
+    const int rows = qCeil(worldRect.height() / tileWorldSize);
+
+    // Maps may draw outside of their area in the world, for example due to
+    // large tiles or layer offsets
+    const qreal margin = tileWorldSize;
+
+    QHash<QString, LoadedMap> loadedMaps;
+    QSet<QString> failedMaps;
+
+    for (int blockY = 0; blockY < rows; blockY += blockSize) {
+        for (int blockX = 0; blockX < columns; blockX += blockSize) {
+            const QRect block(blockX, blockY,
+                              qMin(blockSize, columns - blockX),
+                              qMin(blockSize, rows - blockY));
+
+            const QRectF blockRect = tileRect(block.left(), block.top()) |
+                    tileRect(block.right(), block.bottom());
+            const auto blockMaps = world->mapsInRect(blockRect.adjusted(-margin, -margin,
+                                                                        margin, margin).toAlignedRect());
+
+            QVector<QPoint> tilesToRender;
+
+            for (int y = block.top(); y <= block.bottom(); ++y) {
+                for (int x = block.left(); x <= block.right(); ++x) {
+                    const QRect area = tileRect(x, y).adjusted(-margin, -margin,
+                                                               margin, margin).toAlignedRect();
+                    const QString fileName = tileFileName(maxZoom, x, y);
+                    const QFileInfo tileInfo(fileName);
+                    const QDateTime tileModified = tileInfo.exists() ? tileInfo.lastModified() : QDateTime();
+
+                    bool hasMaps = false;
+                    bool upToDate = tileModified.isValid() && tileModified >= worldModified;
+
+                    for (const World::MapEntry &mapEntry : blockMaps) {
+                        if (!mapEntry.rect.intersects(area))
+                            continue;
+
+                        hasMaps = true;
+
+                        auto modified = mapModified.find(mapEntry.fileName);
+                        if (modified == mapModified.end())
+                            modified = mapModified.insert(mapEntry.fileName, QFileInfo(mapEntry.fileName).lastModified());
+                        if (modified.value() > tileModified)
+                            upToDate = false;
+                    }
+
+                    if (!hasMaps) {
+                        // Remove tiles of maps that are no longer there
+                        if (tileModified.isValid() && QFile::remove(fileName))
+                            changedTiles.insert(tileKey(x, y));
+                    } else if (!upToDate) {
+                        tilesToRender.append(QPoint(x, y));
+                    }
+                }
+            }
+
+            if (tilesToRender.isEmpty())
+                continue;
+
+            // Load the maps of this block, releasing the ones no longer needed
+            QHash<QString, LoadedMap> blockLoadedMaps;
+            for (const World::MapEntry &mapEntry : blockMaps) {
+                auto it = loadedMaps.find(mapEntry.fileName);
+                if (it != loadedMaps.end()) {
+                    blockLoadedMaps.insert(mapEntry.fileName, it.value());
+                    continue;
+                }
+                if (failedMaps.contains(mapEntry.fileName))
+                    continue;
+
+                std::unique_ptr<Map> map { readMap(mapEntry.fileName, &errorString) };
+                if (!map) {
+                    qWarning("Error while reading \"%s\":\n%s",
+                             qUtf8Printable(mapEntry.fileName),
+                             qUtf8Printable(errorString));
+                    failedMaps.insert(mapEntry.fileName);
+                    errors.ref();
+                    continue;
+                }
+
+                std::unique_ptr<MapRenderer> renderer = createRenderer(*map);
+                QRect bounds = renderer->mapBoundingRect();
+                bounds += map->drawMargins();
+                bounds += map->computeLayerOffsetMargins();
+
+                LoadedMap &loadedMap = blockLoadedMaps[mapEntry.fileName];
+                loadedMap.map = std::move(map);
+                loadedMap.position = mapEntry.rect.topLeft();
+                loadedMap.bounds = bounds.translated(mapEntry.rect.topLeft());
+            }
+            loadedMaps.swap(blockLoadedMaps);
+
+            TilesetManager::instance()->resetTileAnimations();
+            if (mAdvanceAnimations > 0)
+                TilesetManager::instance()->advanceTileAnimations(mAdvanceAnimations);
+
+            for (int x = block.left(); x <= block.right(); ++x)
+                makeColumnPath(maxZoom, x);
+
+            QVector<QRect> failedAreas;
+            for (const World::MapEntry &mapEntry : blockMaps)
+                if (failedMaps.contains(mapEntry.fileName))
+                    failedAreas.append(mapEntry.rect);
+
+            for (const QPoint &tile : qAsConst(tilesToRender)) {
+                const QRectF rect = tileRect(tile.x(), tile.y());
+                const QString fileName = tileFileName(maxZoom, tile.x(), tile.y());
+
+                // Tiles that may show a map that failed to load are removed,
+                // so that they are rendered again by the next run
+                const QRect area = rect.adjusted(-margin, -margin,
+                                                 margin, margin).toAlignedRect();
+                const bool showsFailedMap = std::any_of(failedAreas.cbegin(), failedAreas.cend(),
+                                                        [&] (const QRect &failedArea) {
+                    return failedArea.intersects(area);
+                });
+                if (showsFailedMap) {
+                    if (QFile::remove(fileName))
+                        changedTiles.insert(tileKey(tile.x(), tile.y()));
+                    continue;
+                }
+
+                QVector<const LoadedMap*> tileMaps;
+                for (const LoadedMap &loadedMap : qAsConst(loadedMaps))
+                    if (rect.intersects(loadedMap.bounds))
+                        tileMaps.append(&loadedMap);
+
+                // The margin may have included maps that don't paint here
+                if (tileMaps.isEmpty()) {
+                    if (QFile::remove(fileName))
+                        changedTiles.insert(tileKey(tile.x(), tile.y()));
+                    continue;
+                }
+
+                changedTiles.insert(tileKey(tile.x(), tile.y()));
+
+                // The tile images of the maps are pixmaps, which may only be
+                // used on the main thread, so only the writing is done by
+                // the thread pool
+                QImage image(tileSize, tileSize, QImage::Format_ARGB32_Premultiplied);
+                image.fill(Qt::transparent);
+
+                QPainter painter(&image);
+                painter.setRenderHint(QPainter::Antialiasing, mUseAntiAliasing);
+                painter.setRenderHint(QPainter::SmoothPixmapTransform, mSmoothImages);
+                painter.setTransform(QTransform::fromScale(scale, scale));
+                painter.translate(-rect.topLeft());
+
+                for (const LoadedMap *loadedMap : qAsConst(tileMaps)) {
+                    std::unique_ptr<MapRenderer> renderer = createRenderer(*loadedMap->map);
+                    drawMapLayers(*renderer, painter, *loadedMap->map, loadedMap->position);
+                }
+
+                painter.end();
+
+                threadPool.start(new FunctionRunnable([=, &errors] {
+                    if (saveImage(fileName, image) != 0)
+                        errors.ref();
+                }));
+            }
+
+            // Wait for the tiles to be written, to limit the amount of
+            // images held in memory
+            threadPool.waitForDone();
+        }
+    }
+
+    loadedMaps.clear();
+
+    // Build the lower zoom levels by scaling down the tiles of the level above
+    int levelColumns = columns;
+    int levelRows = rows;
+
+    for (int z = maxZoom - 1; z >= 0; --z) {
+        const QSet<quint64> changedChildren = changedTiles;
+        changedTiles.clear();
+
+        levelColumns = (levelColumns + 1) / 2;
+        levelRows = (levelRows + 1) / 2;
+
+        for (int x = 0; x < levelColumns; ++x) {
+            bool columnPathCreated = false;
+
+            for (int y = 0; y < levelRows; ++y) {
+                QStringList childFileNames;
+                QVector<QPoint> childOffsets;
+                bool childChanged = false;
+
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const int childX = x * 2 + dx;
+                        const int childY = y * 2 + dy;
+                        childChanged |= changedChildren.contains(tileKey(childX, childY));
+
+                        const QString childFileName = tileFileName(z + 1, childX, childY);
+                        if (QFile::exists(childFileName)) {
+                            childFileNames.append(childFileName);
+                            childOffsets.append(QPoint(dx, dy) * (tileSize / 2));
+                        }
+                    }
+                }
+
+                const QString fileName = tileFileName(z, x, y);
+                const bool exists = QFile::exists(fileName);
+
+                if (childFileNames.isEmpty()) {
+                    if (exists && QFile::remove(fileName))
+                        changedTiles.insert(tileKey(x, y));
+                    continue;
+                }
+
+                if (exists && !childChanged)
+                    continue;
+
+                if (!columnPathCreated)
+                    columnPathCreated = makeColumnPath(z, x);
+
+                changedTiles.insert(tileKey(x, y));
+
+                threadPool.start(new FunctionRunnable([=, &errors] {
+                    QImage image(tileSize, tileSize, QImage::Format_ARGB32_Premultiplied);
+                    image.fill(Qt::transparent);
+
+                    QPainter painter(&image);
+                    painter.setRenderHint(QPainter::SmoothPixmapTransform, mSmoothImages);
+
+                    for (int i = 0; i < childFileNames.size(); ++i) {
+                        const QImage child(childFileNames.at(i));
+                        painter.drawImage(QRect(childOffsets.at(i), QSize(tileSize / 2, tileSize / 2)),
+                                          child);
+                    }
+
+                    painter.end();
+
+                    if (saveImage(fileName, image) != 0)
+                        errors.ref();
+                }));
+            }
+        }
+
+        threadPool.waitForDone();
+    }
+
+    return errors.load() > 0 ? 1 : 0;
+}
@@ -53,6 +53,7 @@ public:
     bool useAntiAliasing() const { return mUseAntiAliasing; }
     bool smoothImages() const { return mSmoothImages; }
     bool ignoreVisibility() const { return mIgnoreVisibility; }
+    int pyramidTileSize() const { return mPyramidTileSize; }
 
     void setScale(qreal scale) { mScale = scale; }
     void setTileSize(int tileSize) { mTileSize = tileSize; }
@@ -61,6 +62,7 @@ public:
     void setAntiAliasing(bool useAntiAliasing) { mUseAntiAliasing = useAntiAliasing; }
     void setSmoothImages(bool smoothImages) { mSmoothImages = smoothImages; }
     void setIgnoreVisibility(bool IgnoreVisibility) { mIgnoreVisibility = IgnoreVisibility; }
+    void setPyramidTileSize(int tileSize) { mPyramidTileSize = tileSize; }
 
     void setLayersToHide(QStringList layersToHide) { mLayersToHide = layersToHide; }
     void setLayersToShow(QStringList layersToShow) { mLayersToShow = layersToShow; }
@@ -75,12 +77,14 @@ private:
     bool mUseAntiAliasing;
     bool mSmoothImages;
     bool mIgnoreVisibility;
+    int mPyramidTileSize;
     QStringList mLayersToHide;
     QStringList mLayersToShow;
 
     void drawMapLayers(MapRenderer &renderer, QPainter &painter, Map &map, QPoint mapOffset = QPoint(0, 0)) const;
     int renderMap(const QString &mapFileName, const QString &imageFileName);
     int renderWorld(const QString &worldFileName, const QString &imageFileName);
+    int renderWorldTiles(const QString &worldFileName, const QString &outputDirectory);
     int saveImage(const QString &imageFileName, const QImage &image) const;
     bool shouldDrawLayer(const Layer *layer) const;
 };
@@ -0,0 +1,188 @@
+#include "map.h"
+#include "orthogonalrenderer.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QPaintEngine>
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <random>
+
+using namespace Tiled;
+
+/**
+ * A paint engine that doesn't paint anything, but counts the number of
+ * pixmap batches the CellRenderer would have submitted.
+ *
+ * Since this engine is not a QPaintEngineEx, QPainter splits up each
+ * drawPixmapFragments call into a drawPixmap call per fragment. A new batch
+ * is counted whenever the source pixmap changes.
+ */
+class BatchCountingEngine : public QPaintEngine
+{
+public:
+    BatchCountingEngine() : QPaintEngine(AllFeatures) {}
+
+    bool begin(QPaintDevice *) override { return true; }
+    bool end() override { return true; }
+    void updateState(const QPaintEngineState &) override {}
+    Type type() const override { return User; }
+
+    void drawPixmap(const QRectF &, const QPixmap &pixmap, const QRectF &) override
+    {
+        if (pixmap.cacheKey() != mLastCacheKey) {
+            mLastCacheKey = pixmap.cacheKey();
+            ++batches;
+        }
+    }
+
+    int batches = 0;
+
+private:
+    qint64 mLastCacheKey = 0;
+};
+
+class BatchCountingDevice : public QPaintDevice
+{
+public:
+    explicit BatchCountingDevice(QSize size) : mSize(size) {}
+
+    QPaintEngine *paintEngine() const override { return &mEngine; }
+    int batches() const { return mEngine.batches; }
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmWidth:              return mSize.width();
+        case PdmHeight:             return mSize.height();
+        case PdmDepth:              return 32;
+        case PdmDpiX:
+        case PdmDpiY:
+        case PdmPhysicalDpiX:
+        case PdmPhysicalDpiY:       return 96;
+        case PdmDevicePixelRatio:   return 1;
+        default:                    return QPaintDevice::metric(metric);
+        }
+    }
+
+private:
+    QSize mSize;
+    mutable BatchCountingEngine mEngine;
+};
+
+class test_CellRenderer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void batchCount();
+
+    void renderFrame_data();
+    void renderFrame();
+
+private:
+    std::unique_ptr<Map> mMap;
+    SharedTileset mTileset;
+};
+
+static const int mapSize = 512;
+static const int tileSize = 16;
+static const qreal frameScale = 0.25;
+
+void test_CellRenderer::initTestCase()
+{
+    // A 32x32 tile tileset where each tile has its own color
+    QImage image(32 * tileSize, 32 * tileSize, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    for (int y = 0; y < 32; ++y)
+        for (int x = 0; x < 32; ++x)
+            painter.fillRect(x * tileSize, y * tileSize, tileSize, tileSize,
+                             QColor(x * 8, y * 8, (x + y) * 4));
+    painter.end();
+
+    mTileset = Tileset::create(QStringLiteral("Terrain"), tileSize, tileSize);
+    QVERIFY(mTileset->loadFromImage(image, QUrl(QStringLiteral("qrc:/terrain.png"))));
+    QCOMPARE(mTileset->tileCount(), 32 * 32);
+    QVERIFY(!mTileset->atlasImage().isNull());
+
+    mMap.reset(new Map(Map::Orthogonal, mapSize, mapSize, tileSize, tileSize));
+    mMap->addTileset(mTileset);
+
+    auto layer = new TileLayer(QStringLiteral("Ground"), 0, 0, mapSize, mapSize);
+
+    // Varied terrain, so that consecutive cells rarely share a tile
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<int> tileIds(0, mTileset->tileCount() - 1);
+
+    for (int y = 0; y < mapSize; ++y)
+        for (int x = 0; x < mapSize; ++x)
+            layer->setCell(x, y, Cell(mTileset->findTile(tileIds(generator))));
+
+    mMap->addLayer(layer);
+}
+
+void test_CellRenderer::cleanupTestCase()
+{
+    mMap.reset();
+    mTileset.reset();
+}
+
+static int countBatches(const Map *map, bool useAtlas)
+{
+    OrthogonalRenderer renderer(map);
+    renderer.setFlag(UseTileAtlas, useAtlas);
+
+    BatchCountingDevice device(renderer.mapBoundingRect().size() * frameScale);
+    QPainter painter(&device);
+    painter.scale(frameScale, frameScale);
+    renderer.drawTileLayer(&painter, map->layerAt(0)->asTileLayer());
+    painter.end();
+
+    return device.batches();
+}
+
+void test_CellRenderer::batchCount()
+{
+    const int perTileBatches = countBatches(mMap.get(), false);
+    const int atlasBatches = countBatches(mMap.get(), true);
+
+    QVERIFY(perTileBatches > mapSize * mapSize / 2);
+    // All cells use tiles from the same tileset
+    QCOMPARE(atlasBatches, 1);
+}
+
+void test_CellRenderer::renderFrame_data()
+{
+    QTest::addColumn<bool>("useAtlas");
+
+    QTest::newRow("per tile") << false;
+    QTest::newRow("atlas") << true;
+}
+
+void test_CellRenderer::renderFrame()
+{
+    QFETCH(bool, useAtlas);
+
+    OrthogonalRenderer renderer(mMap.get());
+    renderer.setFlag(UseTileAtlas, useAtlas);
+
+    const TileLayer *layer = mMap->layerAt(0)->asTileLayer();
+    QImage frame(renderer.mapBoundingRect().size() * frameScale,
+                 QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        frame.fill(Qt::transparent);
+
+        QPainter painter(&frame);
+        painter.scale(frameScale, frameScale);
+        renderer.drawTileLayer(&painter, layer);
+    }
+}
+
+QTEST_MAIN(test_CellRenderer)
+#include "test_cellrenderer.moc"
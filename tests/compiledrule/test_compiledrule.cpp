@@ -0,0 +1,356 @@
+#include "compiledrule.h"
+#include "map.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <random>
+
+using namespace Tiled;
+
+class test_CompiledRule : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesReference_data();
+    void matchesReference();
+    void parallelMatching();
+
+    void matchRulesBenchmark_data();
+    void matchRulesBenchmark();
+};
+
+static int wrap(int value, int bound)
+{
+    return (value % bound + bound) % bound;
+}
+
+/*
+ * Straight-forward implementation of the rule matching, as it was done by
+ * the AutoMapper before rules got compiled.
+ */
+static bool layerMatchesConditions(const TileLayer &setLayer,
+                                   const InputConditions &conditions,
+                                   const QRegion &ruleRegion,
+                                   const QPoint offset,
+                                   const CompiledRule::MatchOptions &options)
+{
+    const auto &listYes = conditions.listYes;
+    const auto &listNo = conditions.listNo;
+    if (listYes.isEmpty() && listNo.isEmpty())
+        return false;
+
+    QVector<Cell> cells;
+    if (listNo.isEmpty()) {
+        for (const InputLayer &inputLayer : listYes) {
+            for (const QRect &rect : ruleRegion) {
+                for (int x = rect.left(); x <= rect.right(); ++x) {
+                    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                        const Cell &cell = inputLayer.tileLayer->cellAt(x, y);
+                        if (!cells.contains(cell))
+                            cells.append(cell);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const QRect &rect : ruleRegion) {
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                int xd = x + offset.x();
+                int yd = y + offset.y();
+
+                if (!options.matchOutsideMap && !setLayer.contains(xd, yd))
+                    return false;
+
+                if (options.wrapBorder) {
+                    xd = wrap(xd, setLayer.width());
+                    yd = wrap(yd, setLayer.height());
+                } else if (options.overflowBorder) {
+                    xd = qBound(0, xd, setLayer.width() - 1);
+                    yd = qBound(0, yd, setLayer.height() - 1);
+                }
+
+                const Cell &setCell = setLayer.cellAt(xd, yd);
+
+                for (const InputLayer &inputNotLayer : listNo) {
+                    const Cell &noCell = inputNotLayer.tileLayer->cellAt(x, y);
+                    if ((inputNotLayer.strictEmpty || !noCell.isEmpty()) && setCell == noCell)
+                        return false;
+                }
+
+                bool ruleDefinedListYes = false;
+                bool matchListYes = false;
+
+                for (const InputLayer &inputLayer : listYes) {
+                    const Cell &yesCell = inputLayer.tileLayer->cellAt(x, y);
+                    if (inputLayer.strictEmpty || !yesCell.isEmpty()) {
+                        ruleDefinedListYes = true;
+                        if (setCell == yesCell) {
+                            matchListYes = true;
+                            break;
+                        }
+                    }
+                }
+
+                if (!ruleDefinedListYes) {
+                    if (listNo.isEmpty() && cells.contains(setCell))
+                        return false;
+                } else if (!matchListYes) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool referenceMatches(const InputLayers &inputLayers,
+                             const QRegion &ruleRegion,
+                             const Map &map,
+                             const TileLayer &emptyLayer,
+                             const QPoint offset,
+                             const CompiledRule::MatchOptions &options)
+{
+    for (const InputIndex &inputIndex : inputLayers) {
+        bool allLayerNamesMatch = true;
+
+        for (auto it = inputIndex.begin(), end = inputIndex.end(); it != end; ++it) {
+            const int i = map.indexOfLayer(it.key(), Layer::TileLayerType);
+            const TileLayer &setLayer = (i >= 0) ? *map.layerAt(i)->asTileLayer() : emptyLayer;
+
+            if (!layerMatchesConditions(setLayer, it.value(), ruleRegion, offset, options)) {
+                allLayerNamesMatch = false;
+                break;
+            }
+        }
+
+        if (allLayerNamesMatch)
+            return true;
+    }
+
+    return false;
+}
+
+static std::unique_ptr<TileLayer> randomLayer(const QString &name,
+                                              int width, int height,
+                                              Tileset *tileset,
+                                              int tileCount,
+                                              std::mt19937 &generator)
+{
+    std::unique_ptr<TileLayer> layer(new TileLayer(name, 0, 0, width, height));
+
+    // Negative numbers leave the cell empty
+    std::uniform_int_distribution<int> tileIds(-tileCount, tileCount - 1);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int tileId = tileIds(generator);
+            if (tileId >= 0)
+                layer->setCell(x, y, Cell(tileset, tileId));
+        }
+    }
+
+    return layer;
+}
+
+void test_CompiledRule::matchesReference_data()
+{
+    QTest::addColumn<bool>("matchOutsideMap");
+    QTest::addColumn<bool>("overflowBorder");
+    QTest::addColumn<bool>("wrapBorder");
+    QTest::addColumn<bool>("strictEmpty");
+
+    QTest::newRow("default") << true << false << false << false;
+    QTest::newRow("strict empty") << true << false << false << true;
+    QTest::newRow("inside map") << false << false << false << false;
+    QTest::newRow("overflow border") << true << true << false << false;
+    QTest::newRow("wrap border") << true << false << true << false;
+}
+
+void test_CompiledRule::matchesReference()
+{
+    QFETCH(bool, matchOutsideMap);
+    QFETCH(bool, overflowBorder);
+    QFETCH(bool, wrapBorder);
+    QFETCH(bool, strictEmpty);
+
+    CompiledRule::MatchOptions options;
+    options.matchOutsideMap = matchOutsideMap;
+    options.overflowBorder = overflowBorder;
+    options.wrapBorder = wrapBorder;
+
+    std::mt19937 generator(42);
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const int mapSize = 24;
+    const int ruleCount = 32;
+
+    Map map(Map::Orthogonal, mapSize, mapSize, 16, 16);
+    map.addLayer(randomLayer(QStringLiteral("Ground"), mapSize, mapSize,
+                             tileset.data(), 2, generator).release());
+    map.addLayer(randomLayer(QStringLiteral("Walls"), mapSize, mapSize,
+                             tileset.data(), 1, generator).release());
+
+    const TileLayer emptyLayer(QString(), 0, 0, mapSize, mapSize);
+
+    // Each rule is 3x3 in size, one next to the other
+    auto yesGround = randomLayer(QStringLiteral("input_Ground"), ruleCount * 4, 3,
+                                 tileset.data(), 2, generator);
+    auto yesGround2 = randomLayer(QStringLiteral("input2_Ground"), ruleCount * 4, 3,
+                                  tileset.data(), 2, generator);
+    auto noWalls = randomLayer(QStringLiteral("inputnot2_Walls"), ruleCount * 4, 3,
+                               tileset.data(), 1, generator);
+    auto yesMissing = randomLayer(QStringLiteral("input3_Missing"), ruleCount * 4, 3,
+                                  tileset.data(), 1, generator);
+
+    InputLayers inputLayers;
+    inputLayers[QStringLiteral("1")][QStringLiteral("Ground")]
+            .listYes.append(InputLayer { yesGround.get(), strictEmpty });
+
+    InputIndex &index2 = inputLayers[QStringLiteral("2")];
+    index2[QStringLiteral("Ground")].listYes.append(InputLayer { yesGround2.get(), strictEmpty });
+    index2[QStringLiteral("Walls")].listNo.append(InputLayer { noWalls.get(), strictEmpty });
+
+    inputLayers[QStringLiteral("3")][QStringLiteral("Missing")]
+            .listYes.append(InputLayer { yesMissing.get(), strictEmpty });
+
+    int matchCount = 0;
+
+    for (int i = 0; i < ruleCount; ++i) {
+        QRegion ruleRegion(i * 4, 0, 3, 3);
+        if (i % 2)  // make every other rule L-shaped
+            ruleRegion -= QRegion(i * 4 + 1, 0, 2, 2);
+
+        const CompiledRule rule(inputLayers, ruleRegion, map, &emptyLayer, options);
+
+        for (int y = -4; y < mapSize + 1; ++y) {
+            for (int x = -i * 4 - 4; x < mapSize - i * 4 + 1; ++x) {
+                const QPoint offset(x, y);
+                const bool expected = referenceMatches(inputLayers, ruleRegion, map,
+                                                       emptyLayer, offset, options);
+                if (rule.matches(offset) != expected)
+                    QFAIL(qPrintable(QStringLiteral("Rule %1 mismatch at %2,%3").arg(i).arg(x).arg(y)));
+                if (expected)
+                    ++matchCount;
+            }
+        }
+    }
+
+    QVERIFY(matchCount > 0);
+}
+
+void test_CompiledRule::parallelMatching()
+{
+    std::mt19937 generator(7);
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const int mapSize = 100;
+    const int ruleCount = 16;
+
+    Map map(Map::Orthogonal, mapSize, mapSize, 16, 16);
+    map.addLayer(randomLayer(QStringLiteral("Ground"), mapSize, mapSize,
+                             tileset.data(), 2, generator).release());
+
+    const TileLayer emptyLayer(QString(), 0, 0, mapSize, mapSize);
+
+    auto yesGround = randomLayer(QStringLiteral("input_Ground"), ruleCount * 3, 2,
+                                 tileset.data(), 2, generator);
+
+    InputLayers inputLayers;
+    inputLayers[QStringLiteral("1")][QStringLiteral("Ground")]
+            .listYes.append(InputLayer { yesGround.get(), false });
+
+    // Regions consisting of multiple rects per row, to check the ordering
+    const QRegion where = QRegion(0, 0, 40, 70) + QRegion(50, 20, 50, 80);
+
+    QVector<CompiledRule> rules;
+    QVector<QRegion> offsets;
+    QVector<QVector<QPoint>> expected;
+    int matchCount = 0;
+
+    for (int i = 0; i < ruleCount; ++i) {
+        rules.append(CompiledRule(inputLayers, QRegion(i * 3, 0, 2, 2), map,
+                                  &emptyLayer, CompiledRule::MatchOptions()));
+        offsets.append(where.translated(-i * 3, 0));
+
+        QVector<QPoint> ruleMatches;
+        for (int y = 0; y < mapSize; ++y)
+            for (int x = -i * 3; x < mapSize - i * 3; ++x)
+                if (offsets.last().contains(QPoint(x, y)) && rules.last().matches(QPoint(x, y)))
+                    ruleMatches.append(QPoint(x, y));
+
+        QCOMPARE(rules.last().matchesIn(offsets.last()), ruleMatches);
+        expected.append(ruleMatches);
+        matchCount += ruleMatches.size();
+    }
+
+    QVERIFY(matchCount > 0);
+    QCOMPARE(CompiledRule::matchesIn(rules, offsets), expected);
+}
+
+void test_CompiledRule::matchRulesBenchmark_data()
+{
+    QTest::addColumn<bool>("compiled");
+
+    QTest::newRow("reference") << false;
+    QTest::newRow("compiled") << true;
+}
+
+void test_CompiledRule::matchRulesBenchmark()
+{
+    QFETCH(bool, compiled);
+
+    std::mt19937 generator(1234);
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const int mapSize = 256;
+    const int ruleCount = 64;
+    const int tileCount = 8;
+
+    Map map(Map::Orthogonal, mapSize, mapSize, 16, 16);
+    map.addLayer(randomLayer(QStringLiteral("Ground"), mapSize, mapSize,
+                             tileset.data(), tileCount, generator).release());
+
+    const TileLayer emptyLayer(QString(), 0, 0, mapSize, mapSize);
+
+    auto yesGround = randomLayer(QStringLiteral("input_Ground"), ruleCount * 4, 3,
+                                 tileset.data(), tileCount, generator);
+
+    InputLayers inputLayers;
+    inputLayers[QStringLiteral("1")][QStringLiteral("Ground")]
+            .listYes.append(InputLayer { yesGround.get(), false });
+
+    QVector<QRegion> ruleRegions;
+    for (int i = 0; i < ruleCount; ++i)
+        ruleRegions.append(QRegion(i * 4, 0, 3, 3));
+
+    const CompiledRule::MatchOptions options;
+
+    QBENCHMARK {
+        int matchCount = 0;
+
+        for (int i = 0; i < ruleCount; ++i) {
+            const QRegion &ruleRegion = ruleRegions.at(i);
+
+            if (compiled) {
+                const CompiledRule rule(inputLayers, ruleRegion, map, &emptyLayer, options);
+                for (int y = 0; y < mapSize; ++y)
+                    for (int x = -i * 4; x < mapSize - i * 4; ++x)
+                        matchCount += rule.matches(QPoint(x, y));
+            } else {
+                for (int y = 0; y < mapSize; ++y)
+                    for (int x = -i * 4; x < mapSize - i * 4; ++x)
+                        matchCount += referenceMatches(inputLayers, ruleRegion, map,
+                                                       emptyLayer, QPoint(x, y), options);
+            }
+        }
+
+        Q_UNUSED(matchCount)
+    }
+}
+
+QTEST_MAIN(test_CompiledRule)
+#include "test_compiledrule.moc"
@@ -0,0 +1,240 @@
+#include "imagecache.h"
+
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_ImageCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanupTestCase();
+
+    void hitsAndMisses();
+    void failedLoads();
+    void imageMovedToPixmap();
+    void tilesheet();
+    void leastRecentlyUsedEviction();
+    void usedEntriesNotEvicted();
+    void fileChanged();
+    void fileChangedWhileDecoding();
+
+private:
+    QString saveImage(const QString &name, QSize size, QColor color);
+
+    QTemporaryDir mDir;
+    qint64 mDefaultBudget = 0;
+};
+
+QString test_ImageCache::saveImage(const QString &name, QSize size, QColor color)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    image.fill(color);
+
+    const QString fileName = mDir.filePath(name);
+    if (!image.save(fileName, "PNG"))
+        return QString();
+
+    return fileName;
+}
+
+void test_ImageCache::initTestCase()
+{
+    QVERIFY(mDir.isValid());
+    mDefaultBudget = ImageCache::memoryBudget();
+}
+
+void test_ImageCache::init()
+{
+    ImageCache::clear();
+    ImageCache::setMemoryBudget(mDefaultBudget);
+}
+
+void test_ImageCache::cleanupTestCase()
+{
+    ImageCache::clear();
+}
+
+void test_ImageCache::hitsAndMisses()
+{
+    const QString fileName = saveImage(QStringLiteral("hits.png"), QSize(64, 64), Qt::red);
+    QVERIFY(!fileName.isEmpty());
+
+    const ImageCacheStatistics before = ImageCache::statistics();
+
+    QPixmap first = ImageCache::loadPixmap(fileName);
+    QPixmap second = ImageCache::loadPixmap(fileName);
+
+    QCOMPARE(first.size(), QSize(64, 64));
+    QCOMPARE(first.cacheKey(), second.cacheKey());
+
+    const ImageCacheStatistics after = ImageCache::statistics();
+    QCOMPARE(after.misses - before.misses, quint64(1));
+    QCOMPARE(after.hits - before.hits, quint64(1));
+
+    // Pixmaps in use are not counted, since dropping them frees nothing
+    QCOMPARE(after.residentBytes, qint64(0));
+
+    const qint64 bytes = qint64(64 * 64) * first.depth() / 8;
+    first = QPixmap();
+    second = QPixmap();
+    QCOMPARE(ImageCache::statistics().residentBytes, bytes);
+}
+
+void test_ImageCache::failedLoads()
+{
+    const QString fileName = mDir.filePath(QStringLiteral("missing.png"));
+
+    QVERIFY(ImageCache::loadPixmap(fileName).isNull());
+
+    // Failing loads are cached until the file is modified
+    const ImageCacheStatistics before = ImageCache::statistics();
+    QVERIFY(ImageCache::loadPixmap(fileName).isNull());
+    QCOMPARE(ImageCache::statistics().hits - before.hits, quint64(1));
+    QCOMPARE(ImageCache::statistics().misses, before.misses);
+
+    QCOMPARE(saveImage(QStringLiteral("missing.png"), QSize(8, 8), Qt::red), fileName);
+    QCOMPARE(ImageCache::loadPixmap(fileName).size(), QSize(8, 8));
+}
+
+void test_ImageCache::imageMovedToPixmap()
+{
+    const QString fileName = saveImage(QStringLiteral("moved.png"), QSize(32, 32), Qt::green);
+    QVERIFY(!fileName.isEmpty());
+
+    const QImage image(fileName);
+
+    QCOMPARE(ImageCache::loadImage(fileName).image.size(), QSize(32, 32));
+    QCOMPARE(ImageCache::statistics().residentBytes,
+             qint64(image.bytesPerLine()) * image.height());
+
+    // The image is no longer kept once it was turned into a pixmap
+    const int depth = ImageCache::loadPixmap(fileName).depth();
+    QCOMPARE(ImageCache::statistics().residentBytes, qint64(32 * 32) * depth / 8);
+}
+
+void test_ImageCache::tilesheet()
+{
+    const QString fileName = saveImage(QStringLiteral("sheet.png"), QSize(64, 32), Qt::blue);
+    QVERIFY(!fileName.isEmpty());
+
+    TilesheetParameters parameters {};
+    parameters.fileName = fileName;
+    parameters.tileWidth = 16;
+    parameters.tileHeight = 16;
+
+    ImageCache::preloadTilesheet(parameters);
+
+    QSize imageSize;
+    QVector<QPixmap> tiles = ImageCache::cutTiles(parameters, &imageSize);
+
+    QCOMPARE(tiles.size(), 8);
+    QCOMPARE(tiles.first().size(), QSize(16, 16));
+    QCOMPARE(imageSize, QSize(64, 32));
+    QCOMPARE(tiles.at(5).toImage().pixelColor(8, 8), QColor(Qt::blue));
+
+    // Only the tiles are kept, not the whole sheet
+    const qint64 bytes = qint64(tiles.size()) * 16 * 16 * tiles.first().depth() / 8;
+    tiles.clear();
+    QCOMPARE(ImageCache::statistics().residentBytes, bytes);
+}
+
+void test_ImageCache::leastRecentlyUsedEviction()
+{
+    const QString a = saveImage(QStringLiteral("a.png"), QSize(64, 64), Qt::red);
+    const QString b = saveImage(QStringLiteral("b.png"), QSize(64, 64), Qt::green);
+    const QString c = saveImage(QStringLiteral("c.png"), QSize(64, 64), Qt::blue);
+
+    const qint64 pixmapBytes = qint64(64 * 64) * ImageCache::loadPixmap(a).depth() / 8;
+    ImageCache::clear();
+
+    // Room for two of the three pixmaps
+    ImageCache::setMemoryBudget(pixmapBytes * 2);
+
+    ImageCache::loadPixmap(a);
+    ImageCache::loadPixmap(b);
+    ImageCache::loadPixmap(a);      // b is now the least recently used
+
+    const ImageCacheStatistics before = ImageCache::statistics();
+
+    ImageCache::loadPixmap(c);
+
+    ImageCacheStatistics after = ImageCache::statistics();
+    QCOMPARE(after.evictions - before.evictions, quint64(1));
+    QCOMPARE(after.residentBytes, pixmapBytes * 2);
+
+    ImageCache::loadPixmap(a);
+    QCOMPARE(ImageCache::statistics().hits - after.hits, quint64(1));
+
+    after = ImageCache::statistics();
+    ImageCache::loadPixmap(b);
+    QCOMPARE(ImageCache::statistics().misses - after.misses, quint64(1));
+
+    QVERIFY(ImageCache::statistics().residentBytes <= ImageCache::memoryBudget());
+}
+
+void test_ImageCache::usedEntriesNotEvicted()
+{
+    const QString a = saveImage(QStringLiteral("used-a.png"), QSize(64, 64), Qt::red);
+    const QString b = saveImage(QStringLiteral("used-b.png"), QSize(64, 64), Qt::green);
+
+    const QPixmap pixmap = ImageCache::loadPixmap(a);
+    const qint64 pixmapBytes = qint64(64 * 64) * pixmap.depth() / 8;
+
+    // Room for only one pixmap, but the one in use can't be dropped
+    ImageCache::setMemoryBudget(pixmapBytes);
+
+    const ImageCacheStatistics before = ImageCache::statistics();
+
+    QVERIFY(!ImageCache::loadPixmap(b).isNull());
+    QCOMPARE(ImageCache::statistics().evictions, before.evictions);
+
+    // Loading it again does not decode it a second time
+    QCOMPARE(ImageCache::loadPixmap(a).cacheKey(), pixmap.cacheKey());
+    QCOMPARE(ImageCache::statistics().misses - before.misses, quint64(1));
+}
+
+void test_ImageCache::fileChanged()
+{
+    const QString fileName = saveImage(QStringLiteral("changed.png"), QSize(16, 16), Qt::red);
+    QVERIFY(!fileName.isEmpty());
+
+    QCOMPARE(ImageCache::loadPixmap(fileName).size(), QSize(16, 16));
+
+    QCOMPARE(saveImage(QStringLiteral("changed.png"), QSize(24, 24), Qt::red), fileName);
+
+    // The cached pixmap is dropped by the file system watcher
+    QTRY_COMPARE(ImageCache::statistics().residentBytes, qint64(0));
+    QCOMPARE(ImageCache::loadPixmap(fileName).size(), QSize(24, 24));
+}
+
+void test_ImageCache::fileChangedWhileDecoding()
+{
+#if QT_VERSION < 0x050A00
+    QSKIP("Setting the modification time requires Qt 5.10");
+#else
+    const QString fileName = saveImage(QStringLiteral("decoding.png"), QSize(16, 16), Qt::red);
+    QVERIFY(!fileName.isEmpty());
+
+    ImageCache::preloadImage(fileName);
+    QThreadPool::globalInstance()->waitForDone();
+
+    // Make sure the modification time differs, even on coarse file systems
+    QCOMPARE(saveImage(QStringLiteral("decoding.png"), QSize(24, 24), Qt::red), fileName);
+    QFile file(fileName);
+    QVERIFY(file.open(QFile::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(60),
+                             QFileDevice::FileModificationTime));
+    file.close();
+
+    // The outdated result of the background decoder is not used
+    QCOMPARE(ImageCache::loadImage(fileName).image.size(), QSize(24, 24));
+#endif
+}
+
+QTEST_MAIN(test_ImageCache)
+#include "test_imagecache.moc"
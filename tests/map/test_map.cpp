@@ -0,0 +1,213 @@
+#include "grouplayer.h"
+#include "map.h"
+#include "mapobject.h"
+#include "objectgroup.h"
+#include "objecttemplate.h"
+
+#include <QtTest/QtTest>
+
+#include <memory>
+
+using namespace Tiled;
+
+class test_Map : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void findObjectById();
+    void findObjectByIdAfterChanges();
+    void findObjectByDuplicateId();
+    void findLayerById();
+    void templateInstances();
+
+    void resolveObjectRefsBenchmark();
+};
+
+static ObjectGroup *addObjectGroup(Map &map, int objectCount)
+{
+    auto objectGroup = new ObjectGroup(QStringLiteral("Objects"), 0, 0);
+    map.addLayer(objectGroup);
+
+    for (int i = 0; i < objectCount; ++i)
+        objectGroup->addObject(new MapObject);
+
+    return objectGroup;
+}
+
+void test_Map::findObjectById()
+{
+    Map map;
+    ObjectGroup *objectGroup = addObjectGroup(map, 10);
+
+    for (MapObject *object : objectGroup->objects())
+        QCOMPARE(map.findObjectById(object->id()), object);
+
+    QCOMPARE(map.findObjectById(0), static_cast<MapObject*>(nullptr));
+    QCOMPARE(map.findObjectById(1000), static_cast<MapObject*>(nullptr));
+}
+
+void test_Map::findObjectByIdAfterChanges()
+{
+    Map map;
+    ObjectGroup *objectGroup = addObjectGroup(map, 10);
+    MapObject *object = objectGroup->objectAt(3);
+    const int id = object->id();
+
+    QCOMPARE(map.findObjectById(id), object);
+
+    // Removing an object
+    objectGroup->removeObject(object);
+    QCOMPARE(map.findObjectById(id), static_cast<MapObject*>(nullptr));
+
+    // Adding it back
+    objectGroup->addObject(object);
+    QCOMPARE(map.findObjectById(id), object);
+
+    // Changing its ID
+    object->setId(500);
+    QCOMPARE(map.findObjectById(id), static_cast<MapObject*>(nullptr));
+    QCOMPARE(map.findObjectById(500), object);
+
+    // Objects added without an ID get one assigned
+    auto newObject = new MapObject;
+    objectGroup->addObject(newObject);
+    QVERIFY(newObject->id() != 0);
+    QCOMPARE(map.findObjectById(newObject->id()), newObject);
+
+    // Moving the object group to a group layer
+    std::unique_ptr<Layer> layer(map.takeLayerAt(0));
+    QCOMPARE(map.findObjectById(500), static_cast<MapObject*>(nullptr));
+
+    auto groupLayer = new GroupLayer(QStringLiteral("Group"), 0, 0);
+    map.addLayer(groupLayer);
+    groupLayer->addLayer(std::move(layer));
+    QCOMPARE(map.findObjectById(500), object);
+
+    // Moving the group layer to another map
+    Map otherMap;
+    otherMap.addLayer(map.takeLayerAt(0));
+    QCOMPARE(map.findObjectById(500), static_cast<MapObject*>(nullptr));
+    QCOMPARE(otherMap.findObjectById(500), object);
+}
+
+void test_Map::findObjectByDuplicateId()
+{
+    Map map;
+    ObjectGroup *objectGroup = addObjectGroup(map, 4);
+    MapObject *first = objectGroup->objectAt(1);
+    MapObject *second = objectGroup->objectAt(2);
+
+    second->setId(first->id());
+    QCOMPARE(map.findObjectById(first->id()), first);
+
+    // The first object in the map is found, which changes when reordering
+    objectGroup->moveObjects(2, 1, 1);
+    QCOMPARE(map.findObjectById(first->id()), second);
+
+    objectGroup->removeObject(second);
+    QCOMPARE(map.findObjectById(first->id()), first);
+
+    delete second;
+}
+
+void test_Map::findLayerById()
+{
+    Map map;
+    auto groupLayer = new GroupLayer(QStringLiteral("Group"), 0, 0);
+    map.addLayer(groupLayer);
+    ObjectGroup *objectGroup = addObjectGroup(map, 0);
+
+    auto nested = new ObjectGroup(QStringLiteral("Nested"), 0, 0);
+    groupLayer->addLayer(std::unique_ptr<Layer>(nested));
+
+    QCOMPARE(map.findLayerById(groupLayer->id()), static_cast<Layer*>(groupLayer));
+    QCOMPARE(map.findLayerById(objectGroup->id()), static_cast<Layer*>(objectGroup));
+    QCOMPARE(map.findLayerById(nested->id()), static_cast<Layer*>(nested));
+
+    nested->setId(100);
+    QCOMPARE(map.findLayerById(100), static_cast<Layer*>(nested));
+
+    std::unique_ptr<Layer> taken(groupLayer->takeLayerAt(0));
+    QCOMPARE(map.findLayerById(100), static_cast<Layer*>(nullptr));
+}
+
+static QSet<MapObject*> toSet(const QList<MapObject*> &objects)
+{
+    QSet<MapObject*> set;
+    for (MapObject *object : objects)
+        set.insert(object);
+    return set;
+}
+
+void test_Map::templateInstances()
+{
+    ObjectTemplate first;
+    ObjectTemplate second;
+
+    Map map;
+    ObjectGroup *objectGroup = addObjectGroup(map, 4);
+    MapObject *a = objectGroup->objectAt(0);
+    MapObject *b = objectGroup->objectAt(1);
+
+    a->setObjectTemplate(&first);
+    b->setObjectTemplate(&first);
+
+    QCOMPARE(toSet(map.templateInstances(&first)), QSet<MapObject*>({ a, b }));
+    QVERIFY(map.templateInstances(&second).isEmpty());
+    QCOMPARE(map.usedTemplates(), QList<const ObjectTemplate*>({ &first }));
+
+    // Changing the template of an object
+    b->setObjectTemplate(&second);
+    QCOMPARE(map.templateInstances(&first), QList<MapObject*>({ a }));
+    QCOMPARE(map.templateInstances(&second), QList<MapObject*>({ b }));
+
+    // Adding and removing instances
+    auto c = new MapObject;
+    c->setObjectTemplate(&second);
+    objectGroup->addObject(c);
+    QCOMPARE(toSet(map.templateInstances(&second)), QSet<MapObject*>({ b, c }));
+
+    objectGroup->removeObject(a);
+    QVERIFY(map.templateInstances(&first).isEmpty());
+    QCOMPARE(map.usedTemplates(), QList<const ObjectTemplate*>({ &second }));
+    delete a;
+
+    // Replacing a template
+    const QList<MapObject*> changed = map.replaceObjectTemplate(&second, &first);
+    QCOMPARE(toSet(changed), QSet<MapObject*>({ b, c }));
+    QCOMPARE(toSet(map.templateInstances(&first)), QSet<MapObject*>({ b, c }));
+
+    // Removing the layer from the map
+    std::unique_ptr<Layer> taken(map.takeLayerAt(0));
+    QVERIFY(map.usedTemplates().isEmpty());
+}
+
+void test_Map::resolveObjectRefsBenchmark()
+{
+    const int objectCount = 100000;
+
+    Map map;
+    ObjectGroup *objectGroup = addObjectGroup(map, objectCount);
+
+    // Each object refers to another object
+    for (int i = 0; i < objectCount; ++i) {
+        MapObject *object = objectGroup->objectAt(i);
+        const int target = objectGroup->objectAt((i * 7919) % objectCount)->id();
+        object->setProperty(QStringLiteral("target"),
+                            QVariant::fromValue(ObjectRef { target }));
+    }
+
+    QBENCHMARK {
+        int resolved = 0;
+        for (MapObject *object : objectGroup->objects()) {
+            const ObjectRef ref = object->property(QStringLiteral("target")).value<ObjectRef>();
+            if (map.findObjectById(ref.id))
+                ++resolved;
+        }
+        QCOMPARE(resolved, objectCount);
+    }
+}
+
+QTEST_MAIN(test_Map)
+#include "test_map.moc"
@@ -1,11 +1,21 @@
+#include "imagecache.h"
 #include "map.h"
 #include "mapobject.h"
 #include "objectgroup.h"
 #include "tilelayer.h"
+#include "tileset.h"
 #include "mapreader.h"
+#include "mapwriter.h"
 
+#include <QBuffer>
+#include <QDir>
+#include <QPainter>
+#include <QTemporaryDir>
 #include <QtTest/QtTest>
 
+#include <memory>
+#include <random>
+
 using namespace Tiled;
 
 class test_MapReader : public QObject
@@ -14,8 +24,150 @@ class test_MapReader : public QObject
 
 private slots:
     void loadMap();
+
+    void layerDataRoundTrip_data();
+    void layerDataRoundTrip();
+
+    void loadLargeMap_data();
+    void loadLargeMap();
+
+    void loadTilesetImages();
+    void loadTilesetImagesBenchmark();
 };
 
+static void addLayerDataFormats()
+{
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("XML") << int(Map::XML);
+    QTest::newRow("CSV") << int(Map::CSV);
+    QTest::newRow("Base64") << int(Map::Base64);
+    QTest::newRow("Base64Zlib") << int(Map::Base64Zlib);
+    QTest::newRow("Base64Gzip") << int(Map::Base64Gzip);
+}
+
+/**
+ * Creates a map with a single tile layer filled with random tiles, of which
+ * some are flipped and some are left empty.
+ */
+static std::unique_ptr<Map> createRandomMap(int width, int height)
+{
+    auto map = std::make_unique<Map>(Map::Orthogonal, width, height, 32, 32);
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 32, 32);
+    map->addTileset(tileset);
+
+    auto layer = new TileLayer(QStringLiteral("Ground"), 0, 0, width, height);
+
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<int> tileIds(-1, 999);
+    std::uniform_int_distribution<int> flips(0, 7);
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const int tileId = tileIds(generator);
+            if (tileId == -1)
+                continue;
+
+            Cell cell(tileset.data(), tileId);
+            const int flip = flips(generator);
+            cell.setFlippedHorizontally(flip & 1);
+            cell.setFlippedVertically(flip & 2);
+            cell.setFlippedAntiDiagonally(flip & 4);
+            layer->setCell(x, y, cell);
+        }
+    }
+
+    map->addLayer(layer);
+    return map;
+}
+
+/**
+ * Returns a color that is unique for each \a index.
+ */
+static QColor tileColor(int index)
+{
+    return QColor((index * 67) % 256, (index * 29) % 256, index % 128 + 64);
+}
+
+/**
+ * Saves a tilesheet of \a columns by \a rows tiles of 32x32 pixels, each
+ * filled with its tileColor() and with a magenta top-left pixel.
+ */
+static bool saveTilesheet(const QString &fileName, int columns, int rows)
+{
+    QImage image(columns * 32, rows * 32, QImage::Format_RGB32);
+
+    QPainter painter(&image);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            painter.fillRect(x * 32, y * 32, 32, 32, tileColor(y * columns + x));
+            painter.fillRect(x * 32, y * 32, 1, 1, Qt::magenta);
+        }
+    }
+    painter.end();
+
+    return image.save(fileName);
+}
+
+/**
+ * Writes a map referring to \a sheetCount tilesheets named sheet<n>.png,
+ * followed by an image collection tileset using the same images.
+ */
+static bool saveTilesheetMap(const QString &fileName, int sheetCount, int columns, int rows)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    const int tileCount = columns * rows;
+    QString tilesets;
+
+    for (int i = 0; i < sheetCount; ++i) {
+        tilesets += QStringLiteral(
+                    "<tileset firstgid=\"%1\" name=\"sheet%2\" tilewidth=\"32\" tileheight=\"32\""
+                    " tilecount=\"%3\" columns=\"%4\">\n"
+                    " <image source=\"sheet%2.png\" trans=\"ff00ff\" width=\"%5\" height=\"%6\"/>\n"
+                    "</tileset>\n")
+                .arg(1 + i * tileCount).arg(i).arg(tileCount).arg(columns)
+                .arg(columns * 32).arg(rows * 32);
+    }
+
+    tilesets += QStringLiteral("<tileset firstgid=\"%1\" name=\"collection\" tilewidth=\"%2\""
+                               " tileheight=\"%3\" tilecount=\"%4\" columns=\"0\">\n")
+            .arg(1 + sheetCount * tileCount).arg(columns * 32).arg(rows * 32).arg(sheetCount);
+
+    for (int i = 0; i < sheetCount; ++i) {
+        tilesets += QStringLiteral(" <tile id=\"%1\">\n"
+                                   "  <image width=\"%2\" height=\"%3\" source=\"sheet%1.png\"/>\n"
+                                   " </tile>\n")
+                .arg(i).arg(columns * 32).arg(rows * 32);
+    }
+
+    tilesets += QStringLiteral("</tileset>\n");
+
+    const QString map = QStringLiteral(
+                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<map version=\"1.4\" orientation=\"orthogonal\" renderorder=\"right-down\""
+                " width=\"1\" height=\"1\" tilewidth=\"32\" tileheight=\"32\" infinite=\"0\""
+                " nextlayerid=\"1\" nextobjectid=\"1\">\n"
+                "%1"
+                "</map>\n").arg(tilesets);
+
+    return file.write(map.toUtf8()) != -1;
+}
+
+static QByteArray writeToBuffer(const Map *map)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    MapWriter writer;
+    writer.writeMap(map, &buffer);
+
+    return buffer.data();
+}
+
 void test_MapReader::loadMap()
 {
     MapReader reader;
@@ -53,5 +205,154 @@ void test_MapReader::loadMap()
     QCOMPARE(mapObject->height(), qreal(64));
 }
 
+void test_MapReader::layerDataRoundTrip_data()
+{
+    addLayerDataFormats();
+}
+
+void test_MapReader::layerDataRoundTrip()
+{
+    QFETCH(int, format);
+
+    // A size that isn't a multiple of the chunk size
+    auto map = createRandomMap(70, 37);
+    map->setLayerDataFormat(static_cast<Map::LayerDataFormat>(format));
+
+    QByteArray data = writeToBuffer(map.get());
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+
+    MapReader reader;
+    auto readMap = reader.readMap(&buffer);
+    QVERIFY2(readMap, qPrintable(reader.errorString()));
+
+    const TileLayer *expected = map->layerAt(0)->asTileLayer();
+    const TileLayer *actual = readMap->layerAt(0)->asTileLayer();
+    QVERIFY(actual);
+
+    for (int y = 0; y < expected->height(); ++y) {
+        for (int x = 0; x < expected->width(); ++x) {
+            const Cell &expectedCell = expected->cellAt(x, y);
+            const Cell &actualCell = actual->cellAt(x, y);
+
+            QCOMPARE(actualCell.isEmpty(), expectedCell.isEmpty());
+            QCOMPARE(actualCell.tileId(), expectedCell.tileId());
+            QCOMPARE(actualCell.flippedHorizontally(), expectedCell.flippedHorizontally());
+            QCOMPARE(actualCell.flippedVertically(), expectedCell.flippedVertically());
+            QCOMPARE(actualCell.flippedAntiDiagonally(), expectedCell.flippedAntiDiagonally());
+        }
+    }
+
+    QCOMPARE(actual->usedTilesets().size(), 1);
+}
+
+void test_MapReader::loadLargeMap_data()
+{
+    addLayerDataFormats();
+}
+
+void test_MapReader::loadLargeMap()
+{
+    QFETCH(int, format);
+
+    if (format == Map::XML)
+        QSKIP("Layer data in XML format is too large for this benchmark");
+
+    const int mapSize = 4096;
+
+    QByteArray data;
+    {
+        auto map = createRandomMap(mapSize, mapSize);
+        map->setLayerDataFormat(static_cast<Map::LayerDataFormat>(format));
+        data = writeToBuffer(map.get());
+    }
+
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+
+        MapReader reader;
+        auto map = reader.readMap(&buffer);
+        QVERIFY(map);
+        QCOMPARE(map->width(), mapSize);
+    }
+}
+
+void test_MapReader::loadTilesetImages()
+{
+    const int sheetCount = 3;
+    const int columns = 4;
+    const int rows = 2;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    for (int i = 0; i < sheetCount; ++i)
+        QVERIFY(saveTilesheet(dir.filePath(QStringLiteral("sheet%1.png").arg(i)), columns, rows));
+
+    const QString mapFileName = dir.filePath(QStringLiteral("tilesheets.tmx"));
+    QVERIFY(saveTilesheetMap(mapFileName, sheetCount, columns, rows));
+
+    MapReader reader;
+    auto map = reader.readMap(mapFileName);
+    QVERIFY2(map, qPrintable(reader.errorString()));
+    QCOMPARE(map->tilesetCount(), sheetCount + 1);
+
+    for (int i = 0; i < sheetCount; ++i) {
+        const Tileset *tileset = map->tilesetAt(i).data();
+        QCOMPARE(tileset->imageStatus(), LoadingReady);
+        QCOMPARE(tileset->tileCount(), columns * rows);
+        QCOMPARE(tileset->atlasImage().size(), QSize(columns * 32, rows * 32));
+
+        for (const Tile *tile : tileset->tiles()) {
+            const QImage image = tile->image().toImage();
+            QCOMPARE(image.size(), QSize(32, 32));
+            QCOMPARE(QColor(image.pixel(16, 16)), tileColor(tile->id()));
+            QCOMPARE(qAlpha(image.pixel(0, 0)), 0);
+        }
+    }
+
+    const Tileset *collection = map->tilesetAt(sheetCount).data();
+    QVERIFY(collection->isCollection());
+    QCOMPARE(collection->tileCount(), sheetCount);
+
+    for (const Tile *tile : collection->tiles()) {
+        QCOMPARE(tile->image().size(), QSize(columns * 32, rows * 32));
+        QCOMPARE(tile->imageStatus(), LoadingReady);
+    }
+
+    for (int i = 0; i < sheetCount; ++i)
+        ImageCache::remove(dir.filePath(QStringLiteral("sheet%1.png").arg(i)));
+}
+
+void test_MapReader::loadTilesetImagesBenchmark()
+{
+    const int sheetCount = 16;
+    const int columns = 32;
+    const int rows = 32;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QStringList sheetFileNames;
+    for (int i = 0; i < sheetCount; ++i) {
+        sheetFileNames.append(dir.filePath(QStringLiteral("sheet%1.png").arg(i)));
+        QVERIFY(saveTilesheet(sheetFileNames.last(), columns, rows));
+    }
+
+    const QString mapFileName = dir.filePath(QStringLiteral("tilesheets.tmx"));
+    QVERIFY(saveTilesheetMap(mapFileName, sheetCount, columns, rows));
+
+    QBENCHMARK {
+        for (const QString &fileName : qAsConst(sheetFileNames))
+            ImageCache::remove(fileName);
+
+        MapReader reader;
+        auto map = reader.readMap(mapFileName);
+        QVERIFY(map);
+        QCOMPARE(map->tilesetCount(), sheetCount + 1);
+    }
+}
+
 QTEST_MAIN(test_MapReader)
 #include "test_mapreader.moc"
@@ -0,0 +1,141 @@
+#include "map.h"
+#include "mapwriter.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QBuffer>
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <random>
+
+using namespace Tiled;
+
+class test_MapWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void parallelChunkEncoding_data();
+    void parallelChunkEncoding();
+
+    void saveInfiniteMap_data();
+    void saveInfiniteMap();
+
+private:
+    std::unique_ptr<Map> mMap;
+};
+
+static const int mapSize = 1024;
+
+void test_MapWriter::initTestCase()
+{
+    mMap.reset(new Map(Map::Orthogonal, mapSize, mapSize, 32, 32, true));
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 32, 32);
+    mMap->addTileset(tileset);
+
+    auto layer = new TileLayer(QStringLiteral("Ground"), 0, 0, mapSize, mapSize);
+
+    // Mostly uniform terrain with some variation, so that compression has
+    // some work to do
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<int> tileIds(-12, 15);
+
+    for (int y = 0; y < mapSize; ++y)
+        for (int x = 0; x < mapSize; ++x)
+            layer->setCell(x, y, Cell(tileset.data(), qMax(0, tileIds(generator))));
+
+    mMap->addLayer(layer);
+}
+
+void test_MapWriter::cleanupTestCase()
+{
+    mMap.reset();
+}
+
+static void addLayerDataFormats()
+{
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("CSV") << int(Map::CSV);
+    QTest::newRow("Base64") << int(Map::Base64);
+    QTest::newRow("Base64Zlib") << int(Map::Base64Zlib);
+    QTest::newRow("Base64Gzip") << int(Map::Base64Gzip);
+}
+
+static QByteArray writeToBuffer(const Map *map, int threadCount)
+{
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+
+    MapWriter writer;
+    writer.setThreadCount(threadCount);
+    writer.writeMap(map, &buffer);
+
+    return buffer.data();
+}
+
+void test_MapWriter::parallelChunkEncoding_data()
+{
+    addLayerDataFormats();
+}
+
+void test_MapWriter::parallelChunkEncoding()
+{
+    QFETCH(int, format);
+
+    mMap->setLayerDataFormat(static_cast<Map::LayerDataFormat>(format));
+
+    const QByteArray serial = writeToBuffer(mMap.get(), 1);
+    const QByteArray parallel = writeToBuffer(mMap.get(), 4);
+
+    QVERIFY(serial.contains("<chunk "));
+    QCOMPARE(parallel, serial);
+}
+
+void test_MapWriter::saveInfiniteMap_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("threadCount");
+
+    const struct {
+        const char *name;
+        Map::LayerDataFormat format;
+    } formats[] = {
+        { "CSV", Map::CSV },
+        { "Base64", Map::Base64 },
+        { "Base64Zlib", Map::Base64Zlib },
+    };
+
+    for (const auto &f : formats) {
+        for (int threadCount : { 1, 2, 4, 8 }) {
+            QTest::newRow(qPrintable(QStringLiteral("%1, %2 threads")
+                                     .arg(QLatin1String(f.name)).arg(threadCount)))
+                    << int(f.format) << threadCount;
+        }
+    }
+}
+
+void test_MapWriter::saveInfiniteMap()
+{
+    QFETCH(int, format);
+    QFETCH(int, threadCount);
+
+    mMap->setLayerDataFormat(static_cast<Map::LayerDataFormat>(format));
+
+    QBENCHMARK {
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+
+        MapWriter writer;
+        writer.setThreadCount(threadCount);
+        writer.writeMap(mMap.get(), &buffer);
+    }
+}
+
+QTEST_MAIN(test_MapWriter)
+#include "test_mapwriter.moc"
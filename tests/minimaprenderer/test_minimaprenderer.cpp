@@ -0,0 +1,90 @@
+#include "map.h"
+#include "minimaprenderer.h"
+#include "orthogonalrenderer.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QPainter>
+#include <QtTest/QtTest>
+
+#include <memory>
+
+using namespace Tiled;
+
+class test_MiniMapRenderer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void renderRegion_data();
+    void renderRegion();
+};
+
+static const int tileSize = 16;
+
+static SharedTileset createTileset()
+{
+    QImage image(4 * tileSize, 4 * tileSize, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    for (int y = 0; y < 4; ++y)
+        for (int x = 0; x < 4; ++x)
+            painter.fillRect(x * tileSize, y * tileSize, tileSize, tileSize,
+                             QColor(x * 64, y * 64, 128));
+    painter.end();
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Colors"), tileSize, tileSize);
+    tileset->loadFromImage(image, QUrl(QStringLiteral("qrc:/colors.png")));
+    return tileset;
+}
+
+void test_MiniMapRenderer::renderRegion_data()
+{
+    QTest::addColumn<QSize>("imageSize");
+    QTest::addColumn<QRect>("changedArea");
+
+    QTest::newRow("whole pixels") << QSize(256, 256) << QRect(10, 12, 5, 3);
+    QTest::newRow("fractional scale") << QSize(100, 77) << QRect(30, 0, 7, 9);
+    QTest::newRow("map edge") << QSize(123, 123) << QRect(60, 60, 4, 4);
+}
+
+void test_MiniMapRenderer::renderRegion()
+{
+    QFETCH(QSize, imageSize);
+    QFETCH(QRect, changedArea);
+
+    const int mapSize = 64;
+    SharedTileset tileset = createTileset();
+
+    Map map(Map::Orthogonal, mapSize, mapSize, tileSize, tileSize);
+    map.addTileset(tileset);
+
+    auto layer = new TileLayer(QStringLiteral("Ground"), 0, 0, mapSize, mapSize);
+    for (int y = 0; y < mapSize; ++y)
+        for (int x = 0; x < mapSize; ++x)
+            layer->setCell(x, y, Cell(tileset->findTile((x + y) % tileset->tileCount())));
+    map.addLayer(layer);
+
+    const MiniMapRenderer::RenderFlags renderFlags(MiniMapRenderer::DrawTileLayers |
+                                                   MiniMapRenderer::DrawBackground);
+
+    QImage partial(imageSize, QImage::Format_ARGB32_Premultiplied);
+    MiniMapRenderer(&map).renderToImage(partial, renderFlags);
+
+    for (int y = changedArea.top(); y <= changedArea.bottom(); ++y)
+        for (int x = changedArea.left(); x <= changedArea.right(); ++x)
+            layer->setCell(x, y, Cell(tileset->findTile(15)));
+
+    OrthogonalRenderer renderer(&map);
+    const QRegion mapRegion = renderer.boundingRect(changedArea);
+
+    MiniMapRenderer miniMapRenderer(&map);
+    miniMapRenderer.renderToImage(partial, renderFlags, mapRegion);
+
+    QImage full(imageSize, QImage::Format_ARGB32_Premultiplied);
+    miniMapRenderer.renderToImage(full, renderFlags);
+
+    QCOMPARE(partial, full);
+}
+
+QTEST_MAIN(test_MiniMapRenderer)
+#include "test_minimaprenderer.moc"
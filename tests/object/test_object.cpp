@@ -0,0 +1,138 @@
+#include "mapobject.h"
+#include "object.h"
+#include "tile.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_Object : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanupTestCase();
+
+    void resolvedProperty();
+    void resolvedProperties();
+    void objectTypesChanged();
+
+    void resolvedPropertiesBenchmark();
+};
+
+static Properties makeProperties(const QString &name, const QVariant &value)
+{
+    Properties properties;
+    properties.insert(name, value);
+    return properties;
+}
+
+void test_Object::init()
+{
+    Properties enemy;
+    enemy.insert(QStringLiteral("health"), 10);
+    enemy.insert(QStringLiteral("speed"), 2);
+
+    ObjectTypes types;
+    types.append(ObjectType(QStringLiteral("Enemy"), Qt::red, enemy));
+    types.append(ObjectType(QStringLiteral("Door"), Qt::blue,
+                            makeProperties(QStringLiteral("locked"), true)));
+
+    // A second type with the same name, the first one takes precedence
+    types.append(ObjectType(QStringLiteral("Enemy"), Qt::red,
+                            makeProperties(QStringLiteral("health"), 20)));
+
+    Object::setObjectTypes(types);
+}
+
+void test_Object::cleanupTestCase()
+{
+    Object::setObjectTypes(ObjectTypes());
+}
+
+void test_Object::resolvedProperty()
+{
+    MapObject object;
+    object.setType(QStringLiteral("Enemy"));
+
+    QCOMPARE(object.resolvedProperty(QStringLiteral("health")), QVariant(10));
+    QCOMPARE(object.resolvedProperty(QStringLiteral("speed")), QVariant(2));
+    QCOMPARE(object.resolvedProperty(QStringLiteral("locked")), QVariant());
+
+    object.setProperty(QStringLiteral("health"), 5);
+    QCOMPARE(object.resolvedProperty(QStringLiteral("health")), QVariant(5));
+
+    // The type can be inherited from the tile
+    SharedTileset tileset = Tileset::create(QStringLiteral("Tiles"), 16, 16);
+    Tile *tile = tileset->findOrCreateTile(0);
+    tile->setType(QStringLiteral("Door"));
+
+    MapObject tileObject;
+    tileObject.setCell(Cell(tile));
+    QCOMPARE(tileObject.resolvedProperty(QStringLiteral("locked")), QVariant(true));
+    QCOMPARE(tile->resolvedProperty(QStringLiteral("locked")), QVariant(true));
+}
+
+void test_Object::resolvedProperties()
+{
+    MapObject object;
+    object.setType(QStringLiteral("Enemy"));
+    object.setProperty(QStringLiteral("name"), QStringLiteral("Bob"));
+
+    Properties expected;
+    expected.insert(QStringLiteral("health"), 10);
+    expected.insert(QStringLiteral("speed"), 2);
+    expected.insert(QStringLiteral("name"), QStringLiteral("Bob"));
+
+    QCOMPARE(object.resolvedProperties(), expected);
+
+    object.setType(QStringLiteral("Unknown"));
+    QCOMPARE(object.resolvedProperties(),
+             makeProperties(QStringLiteral("name"), QStringLiteral("Bob")));
+}
+
+void test_Object::objectTypesChanged()
+{
+    MapObject object;
+    object.setType(QStringLiteral("Enemy"));
+    QCOMPARE(object.resolvedProperty(QStringLiteral("health")), QVariant(10));
+
+    ObjectTypes types;
+    types.append(ObjectType(QStringLiteral("Enemy"), Qt::red,
+                            makeProperties(QStringLiteral("health"), 30)));
+    Object::setObjectTypes(types);
+
+    QCOMPARE(object.resolvedProperty(QStringLiteral("health")), QVariant(30));
+    QCOMPARE(object.resolvedProperty(QStringLiteral("speed")), QVariant());
+}
+
+void test_Object::resolvedPropertiesBenchmark()
+{
+    const int typeCount = 300;
+
+    ObjectTypes types;
+    for (int i = 0; i < typeCount; ++i) {
+        types.append(ObjectType(QStringLiteral("Type%1").arg(i), Qt::gray,
+                                makeProperties(QStringLiteral("index"), i)));
+    }
+    Object::setObjectTypes(types);
+
+    QVector<MapObject*> objects;
+    for (int i = 0; i < 10000; ++i) {
+        auto object = new MapObject;
+        object->setType(QStringLiteral("Type%1").arg(i % typeCount));
+        objects.append(object);
+    }
+
+    QBENCHMARK {
+        for (const MapObject *object : qAsConst(objects))
+            QVERIFY(!object->resolvedProperties().isEmpty());
+    }
+
+    qDeleteAll(objects);
+}
+
+QTEST_MAIN(test_Object)
+#include "test_object.moc"
@@ -0,0 +1,172 @@
+#include "packedtilelayer.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <random>
+
+using namespace Tiled;
+
+class test_PackedTileLayer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void merge();
+    void memoryUsage();
+
+    void mergeBenchmark();
+};
+
+static std::unique_ptr<TileLayer> createNoisyLayer(int size, Tileset *tileset, unsigned seed)
+{
+    std::unique_ptr<TileLayer> layer(new TileLayer(QStringLiteral("Ground"),
+                                                   0, 0, size, size));
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> tileIds(-1, 3);
+    std::uniform_int_distribution<int> flags(0, 15);
+
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const int tileId = tileIds(generator);
+            if (tileId == -1)
+                continue;
+
+            const int flag = flags(generator);
+            Cell cell(tileset, tileId);
+            cell.setFlippedHorizontally(flag & 1);
+            cell.setFlippedVertically(flag & 2);
+            cell.setFlippedAntiDiagonally(flag & 4);
+            cell.setRotatedHexagonal120(flag & 8);
+            layer->setCell(x, y, cell);
+        }
+    }
+
+    return layer;
+}
+
+static void compareCells(const TileLayer &actual, QPoint actualOffset,
+                         const TileLayer &expected, QPoint expectedOffset,
+                         const QRegion &region)
+{
+#if QT_VERSION < 0x050800
+    const auto rects = region.rects();
+    for (const QRect &rect : rects) {
+#else
+    for (const QRect &rect : region) {
+#endif
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            for (int x = rect.left(); x <= rect.right(); ++x) {
+                const Cell &a = actual.cellAt(x - actualOffset.x(), y - actualOffset.y());
+                const Cell &e = expected.cellAt(x - expectedOffset.x(), y - expectedOffset.y());
+                QCOMPARE(a, e);
+            }
+        }
+    }
+}
+
+void test_PackedTileLayer::roundTrip_data()
+{
+    QTest::addColumn<QPoint>("offset");
+    QTest::addColumn<QRegion>("region");
+
+    QRegion shape(3, 5, 40, 20);
+    shape += QRect(-10, -17, 5, 60);
+    shape -= QRect(10, 10, 4, 4);
+
+    QTest::newRow("origin") << QPoint(0, 0) << QRegion(0, 0, 64, 64);
+    QTest::newRow("offset") << QPoint(-7, 12) << QRegion(-7, 12, 50, 50);
+    QTest::newRow("shape") << QPoint(13, -2) << shape;
+}
+
+void test_PackedTileLayer::roundTrip()
+{
+    QFETCH(QPoint, offset);
+    QFETCH(QRegion, region);
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const auto layer = createNoisyLayer(64, tileset.data(), 1);
+
+    PackedTileLayer packed;
+    packed.setCells(*layer, offset, region);
+
+    const auto unpacked = packed.unpack();
+    compareCells(*unpacked, QPoint(), *layer, offset, region);
+
+    // Cells outside of the region were not stored
+    QVERIFY(unpacked->region().subtracted(region).isEmpty());
+}
+
+void test_PackedTileLayer::merge()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const auto first = createNoisyLayer(64, tileset.data(), 1);
+    const auto second = createNoisyLayer(64, tileset.data(), 2);
+
+    const QRegion firstRegion(0, 0, 40, 40);
+    const QRegion secondRegion(20, 30, 44, 34);
+
+    PackedTileLayer packed;
+    packed.setCells(*first, QPoint(), firstRegion);
+
+    PackedTileLayer other;
+    other.setCells(*second, QPoint(), secondRegion);
+
+    PackedTileLayer copy = packed;
+    packed.setCells(other, secondRegion);
+
+    const auto unpacked = packed.unpack();
+    compareCells(*unpacked, QPoint(), *first, QPoint(), firstRegion.subtracted(secondRegion));
+    compareCells(*unpacked, QPoint(), *second, QPoint(), secondRegion);
+
+    // The copy is not affected
+    const auto unpackedCopy = copy.unpack();
+    compareCells(*unpackedCopy, QPoint(), *first, QPoint(), firstRegion);
+}
+
+void test_PackedTileLayer::memoryUsage()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+
+    TileLayer filled(QStringLiteral("Filled"), 0, 0, 1024, 1024);
+    for (int y = 0; y < 1024; ++y)
+        for (int x = 0; x < 1024; ++x)
+            filled.setCell(x, y, Cell(tileset.data(), 1));
+
+    PackedTileLayer packed;
+    packed.setCells(filled, QPoint(), filled.rect());
+
+    // A chunk filled with the same tile is stored as a single run
+    const qint64 unpackedSize = qint64(1024) * 1024 * sizeof(Cell);
+    QVERIFY(packed.memoryUsage() * 50 < unpackedSize);
+
+    // Empty chunks are not stored
+    PackedTileLayer empty;
+    empty.setCells(TileLayer(), QPoint(), QRegion(0, 0, 1024, 1024));
+    QVERIFY(empty.memoryUsage() < 64);
+}
+
+void test_PackedTileLayer::mergeBenchmark()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    const auto layer = createNoisyLayer(256, tileset.data(), 1);
+
+    QBENCHMARK {
+        // Simulates a long brush stroke, merging one small stamp at a time
+        PackedTileLayer packed;
+        for (int i = 0; i < 240; ++i) {
+            PackedTileLayer stamp;
+            const QRegion region(i, i / 2, 3, 3);
+            stamp.setCells(*layer, QPoint(), region);
+            packed.setCells(stamp, region);
+        }
+    }
+}
+
+QTEST_MAIN(test_PackedTileLayer)
+#include "test_packedtilelayer.moc"
@@ -1,4 +1,17 @@
 TEMPLATE=subdirs
 SUBDIRS = \
+    cellrenderer \
+    compiledrule \
+    imagecache \
+    map \
     mapreader \
-    staggeredrenderer
+    mapwriter \
+    minimaprenderer \
+    object \
+    packedtilelayer \
+    staggeredrenderer \
+    tilelayer \
+    tilelayerjournal \
+    tileset \
+    wangset \
+    worldmanager
@@ -0,0 +1,161 @@
+#include "regionbuilder.h"
+#include "tilelayer.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+#include <random>
+
+using namespace Tiled;
+
+class test_TileLayer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void regionBuilder();
+    void region();
+    void computeDiffRegion_data();
+    void computeDiffRegion();
+
+    void regionBenchmark();
+    void computeDiffRegionBenchmark();
+
+private:
+    std::unique_ptr<TileLayer> noisyLayer(int size, unsigned seed) const;
+
+    SharedTileset mTileset;
+};
+
+/**
+ * The region as it was computed before, by uniting single-row rectangles.
+ */
+static QRegion referenceRegion(const TileLayer &layer)
+{
+    QRegion region;
+    for (int y = 0; y < layer.height(); ++y)
+        for (int x = 0; x < layer.width(); ++x)
+            if (!layer.cellAt(x, y).isEmpty())
+                region += QRect(x + layer.x(), y + layer.y(), 1, 1);
+    return region;
+}
+
+void test_TileLayer::initTestCase()
+{
+    mTileset = Tileset::create(QStringLiteral("tileset"), 32, 32);
+    for (int i = 0; i < 4; ++i)
+        mTileset->findOrCreateTile(i);
+}
+
+std::unique_ptr<TileLayer> test_TileLayer::noisyLayer(int size, unsigned seed) const
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> tileId(-1, mTileset->tileCount() - 1);
+
+    std::unique_ptr<TileLayer> layer(new TileLayer(QStringLiteral("layer"), 0, 0, size, size));
+    for (int cy = 0; cy < size; ++cy) {
+        for (int cx = 0; cx < size; ++cx) {
+            const int id = tileId(random);
+            if (id >= 0)
+                layer->setCell(cx, cy, Cell(mTileset->findTile(id)));
+        }
+    }
+    return layer;
+}
+
+void test_TileLayer::regionBuilder()
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> coordinate(-20, 20);
+    std::uniform_int_distribution<int> length(0, 8);
+
+    RegionBuilder builder;
+    QRegion expected;
+
+    for (int i = 0; i < 500; ++i) {
+        const int y = coordinate(random);
+        const int left = coordinate(random);
+        const int right = left + length(random);
+        builder.addSpan(y, left, right);
+        expected += QRect(QPoint(left, y), QPoint(right, y));
+    }
+
+    builder.addRect(QRect(-40, -40, 10, 10));
+    expected += QRect(-40, -40, 10, 10);
+
+    const QRegion region = builder.region();
+    QCOMPARE(region, expected);
+
+    QVERIFY(RegionBuilder().region().isEmpty());
+}
+
+void test_TileLayer::region()
+{
+    const auto layer = noisyLayer(100, 1);
+    layer->setPosition(3, -7);
+    QCOMPARE(layer->region(), referenceRegion(*layer));
+
+    const Chunk &chunk = *layer->findChunk(0, 0);
+    QRegion chunkRegion;
+    for (int y = 0; y < CHUNK_SIZE; ++y)
+        for (int x = 0; x < CHUNK_SIZE; ++x)
+            if (!chunk.cellAt(x, y).isEmpty())
+                chunkRegion += QRect(x, y, 1, 1);
+    QCOMPARE(chunk.region([] (const Cell &cell) { return !cell.isEmpty(); }), chunkRegion);
+}
+
+void test_TileLayer::computeDiffRegion_data()
+{
+    QTest::addColumn<QPoint>("otherPosition");
+
+    QTest::newRow("aligned") << QPoint(0, 0);
+    QTest::newRow("offset") << QPoint(5, -3);
+}
+
+void test_TileLayer::computeDiffRegion()
+{
+    QFETCH(QPoint, otherPosition);
+
+    const auto layer = noisyLayer(64, 2);
+    std::unique_ptr<TileLayer> other(layer->clone());
+    other->setPosition(otherPosition);
+
+    // Change some cells and clear a whole chunk
+    other->setCell(1, 1, Cell(mTileset->findTile(0)));
+    other->setCell(40, 2, Cell());
+    other->setCell(70, 70, Cell(mTileset->findTile(1)));
+    other->erase(QRegion(16, 16, CHUNK_SIZE, CHUNK_SIZE));
+
+    QRegion expected;
+    const QRect r = layer->bounds().united(other->bounds()).translated(-layer->position());
+    for (int y = r.top(); y <= r.bottom(); ++y)
+        for (int x = r.left(); x <= r.right(); ++x)
+            if (layer->cellAt(x, y) != other->cellAt(x - otherPosition.x(), y - otherPosition.y()))
+                expected += QRect(x, y, 1, 1);
+
+    QCOMPARE(layer->computeDiffRegion(other.get()), expected);
+}
+
+void test_TileLayer::regionBenchmark()
+{
+    const auto layer = noisyLayer(2000, 3);
+
+    QBENCHMARK {
+        layer->region();
+    }
+}
+
+void test_TileLayer::computeDiffRegionBenchmark()
+{
+    const auto layer = noisyLayer(2000, 4);
+    const auto other = noisyLayer(2000, 5);
+
+    QBENCHMARK {
+        layer->computeDiffRegion(other.get());
+    }
+}
+
+QTEST_MAIN(test_TileLayer)
+#include "test_tilelayer.moc"
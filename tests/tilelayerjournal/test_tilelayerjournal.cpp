@@ -0,0 +1,137 @@
+#include "tilelayer.h"
+#include "tilelayerjournal.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+#include <memory>
+#include <random>
+
+using namespace Tiled;
+
+class test_TileLayerJournal : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void changes_data();
+    void changes();
+
+    void smallChangeBenchmark_data();
+    void smallChangeBenchmark();
+};
+
+static std::unique_ptr<TileLayer> createLayer(int size, Tileset *tileset)
+{
+    std::unique_ptr<TileLayer> layer(new TileLayer(QStringLiteral("Ground"),
+                                                   0, 0, size, size));
+
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+            layer->setCell(x, y, Cell(tileset, (x / 8 + y / 8) % 4));
+
+    return layer;
+}
+
+void test_TileLayerJournal::changes_data()
+{
+    QTest::addColumn<QPoint>("position");
+
+    QTest::newRow("origin") << QPoint(0, 0);
+    QTest::newRow("offset") << QPoint(-7, 12);
+}
+
+void test_TileLayerJournal::changes()
+{
+    QFETCH(QPoint, position);
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    auto layer = createLayer(100, tileset.data());
+    layer->setPosition(position);
+
+    std::unique_ptr<TileLayer> original(layer->clone());
+    std::unique_ptr<TileLayer> patched(layer->clone());
+
+    TileLayerJournal journal;
+    std::mt19937 generator(3);
+    std::uniform_int_distribution<int> coordinates(-20, 119);
+    std::uniform_int_distribution<int> tileIds(0, 4);
+
+    // Cells set outside of the layer and cells set to their current value
+    // are included on purpose
+    for (int i = 0; i < 500; ++i) {
+        const int x = coordinates(generator);
+        const int y = coordinates(generator);
+        journal.recordCell(layer.get(), x, y);
+        layer->setCell(x, y, Cell(tileset.data(), tileIds(generator)));
+    }
+
+    const QRegion erased = QRegion(10, 10, 30, 5) + QRegion(60, 0, 3, 80);
+    journal.recordRegion(layer.get(), erased);
+    layer->erase(erased);
+
+    const auto changes = journal.changes();
+    QCOMPARE(int(changes.size()), 1);
+
+    const TileLayerJournal::Change &change = changes.front();
+    QCOMPARE(change.layer, layer.get());
+    QCOMPARE(change.boundsBefore, original->bounds());
+    QCOMPARE(change.region, original->computeDiffRegion(layer.get()).translated(position));
+
+    // Patching the original with the changed cells gives the current layer
+    const QRect b = change.after->rect();
+    patched->setCells(b.left() - position.x(), b.top() - position.y(),
+                      change.after.get(), change.region.translated(-position));
+    QVERIFY(patched->computeDiffRegion(layer.get()).isEmpty());
+
+    // And the other way around
+    layer->setCells(b.left() - position.x(), b.top() - position.y(),
+                    change.before.get(), change.region.translated(-position));
+    QVERIFY(original->computeDiffRegion(layer.get()).isEmpty());
+
+    journal.clear();
+    QVERIFY(journal.changes().empty());
+}
+
+void test_TileLayerJournal::smallChangeBenchmark_data()
+{
+    QTest::addColumn<bool>("journal");
+
+    QTest::newRow("full clone") << false;
+    QTest::newRow("journal") << true;
+}
+
+void test_TileLayerJournal::smallChangeBenchmark()
+{
+    QFETCH(bool, journal);
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 16, 16);
+    auto layer = createLayer(2048, tileset.data());
+
+    const QRect stroke(1000, 1000, 5, 5);
+    int tileId = 0;
+
+    QBENCHMARK {
+        tileId = (tileId + 1) % 4;
+
+        if (journal) {
+            TileLayerJournal tileLayerJournal;
+            for (int y = stroke.top(); y <= stroke.bottom(); ++y) {
+                for (int x = stroke.left(); x <= stroke.right(); ++x) {
+                    tileLayerJournal.recordCell(layer.get(), x, y);
+                    layer->setCell(x, y, Cell(tileset.data(), tileId));
+                }
+            }
+            tileLayerJournal.changes();
+        } else {
+            std::unique_ptr<TileLayer> before(layer->clone());
+            for (int y = stroke.top(); y <= stroke.bottom(); ++y)
+                for (int x = stroke.left(); x <= stroke.right(); ++x)
+                    layer->setCell(x, y, Cell(tileset.data(), tileId));
+            before->computeDiffRegion(layer.get());
+        }
+    }
+}
+
+QTEST_MAIN(test_TileLayerJournal)
+#include "test_tilelayerjournal.moc"
@@ -0,0 +1,148 @@
+#include "tile.h"
+#include "tileset.h"
+
+#include <QtTest/QtTest>
+
+#include <random>
+
+using namespace Tiled;
+
+class test_Tileset : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void findTileDense();
+    void findTileSparse();
+    void findTileAfterClone();
+    void animatedTiles();
+
+    void findTileBenchmark_data();
+    void findTileBenchmark();
+};
+
+void test_Tileset::findTileDense()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Dense"), 32, 32);
+
+    for (int id = 0; id < 100; ++id)
+        tileset->findOrCreateTile(id);
+
+    // An image collection tileset with a hole
+    tileset->deleteTile(50);
+
+    QCOMPARE(tileset->tileCount(), 99);
+    QVERIFY(tileset->findTile(49));
+    QCOMPARE(tileset->findTile(49)->id(), 49);
+    QVERIFY(!tileset->findTile(50));
+    QVERIFY(!tileset->findTile(100));
+    QVERIFY(!tileset->findTile(-1));
+
+    Tile *tile = tileset->findOrCreateTile(50);
+    QCOMPARE(tileset->findTile(50), tile);
+    QCOMPARE(tileset->tiles().value(50), tile);
+}
+
+void test_Tileset::findTileSparse()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Sparse"), 32, 32);
+
+    Tile *first = tileset->findOrCreateTile(0);
+    Tile *distant = tileset->findOrCreateTile(100000);
+    Tile *negative = tileset->findOrCreateTile(-5);
+
+    QCOMPARE(tileset->tileCount(), 3);
+    QCOMPARE(tileset->findTile(0), first);
+    QCOMPARE(tileset->findTile(100000), distant);
+    QCOMPARE(tileset->findTile(-5), negative);
+    QVERIFY(!tileset->findTile(1));
+
+    tileset->removeTiles({ distant });
+    QVERIFY(!tileset->findTile(100000));
+    QCOMPARE(tileset->findTile(0), first);
+    delete distant;
+}
+
+void test_Tileset::findTileAfterClone()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Original"), 32, 32);
+    for (int id = 0; id < 10; ++id)
+        tileset->findOrCreateTile(id);
+
+    SharedTileset clone = tileset->clone();
+    for (int id = 0; id < 10; ++id) {
+        QVERIFY(clone->findTile(id));
+        QCOMPARE(clone->findTile(id)->tileset(), clone.data());
+    }
+}
+
+void test_Tileset::animatedTiles()
+{
+    SharedTileset tileset = Tileset::create(QStringLiteral("Animated"), 32, 32);
+    for (int id = 0; id < 10; ++id)
+        tileset->findOrCreateTile(id);
+
+    QVERIFY(tileset->animatedTiles().isEmpty());
+
+    const QVector<Frame> frames { { 0, 100 }, { 1, 100 } };
+    tileset->findTile(3)->setFrames(frames);
+    tileset->findTile(7)->setFrames(frames);
+
+    QCOMPARE(tileset->animatedTiles(),
+             QVector<Tile*>({ tileset->findTile(3), tileset->findTile(7) }));
+
+    tileset->findTile(3)->setFrames(QVector<Frame>());
+    QCOMPARE(tileset->animatedTiles(), QVector<Tile*>({ tileset->findTile(7) }));
+
+    SharedTileset clone = tileset->clone();
+    QCOMPARE(clone->animatedTiles(), QVector<Tile*>({ clone->findTile(7) }));
+
+    tileset->deleteTile(7);
+    QVERIFY(tileset->animatedTiles().isEmpty());
+}
+
+void test_Tileset::findTileBenchmark_data()
+{
+    QTest::addColumn<bool>("useLookup");
+
+    QTest::newRow("QMap") << false;
+    QTest::newRow("lookup") << true;
+}
+
+void test_Tileset::findTileBenchmark()
+{
+    QFETCH(bool, useLookup);
+
+    const int tileCount = 4096;
+
+    SharedTileset tileset = Tileset::create(QStringLiteral("Terrain"), 32, 32);
+    for (int id = 0; id < tileCount; ++id)
+        tileset->findOrCreateTile(id);
+
+    std::mt19937 generator(1234);
+    std::uniform_int_distribution<int> tileIds(0, tileCount - 1);
+
+    QVector<int> ids(1 << 20);
+    for (int &id : ids)
+        id = tileIds(generator);
+
+    const Tileset &t = *tileset;
+    quintptr sum = 0;
+
+    if (useLookup) {
+        QBENCHMARK {
+            for (int id : qAsConst(ids))
+                sum += reinterpret_cast<quintptr>(t.findTile(id));
+        }
+    } else {
+        QBENCHMARK {
+            for (int id : qAsConst(ids))
+                sum += reinterpret_cast<quintptr>(t.tiles().value(id));
+        }
+    }
+
+    QVERIFY(sum != 0);
+}
+
+QTEST_MAIN(test_Tileset)
+#include "test_tileset.moc"
@@ -0,0 +1,146 @@
+#include "tilelayer.h"
+#include "tileset.h"
+#include "wangfiller.h"
+#include "wangset.h"
+
+#include <QtTest/QtTest>
+
+#include <algorithm>
+#include <random>
+
+using namespace Tiled;
+
+class test_WangSet : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void wildcardMatching_data();
+    void wildcardMatching();
+
+    void fillRegionBenchmark();
+};
+
+static WangId randomWangId(std::mt19937 &generator, int edgeColors, int cornerColors,
+                           bool allowWildcards)
+{
+    std::uniform_int_distribution<int> edges(allowWildcards ? 0 : 1, edgeColors);
+    std::uniform_int_distribution<int> corners(allowWildcards ? 0 : 1, cornerColors);
+
+    WangId wangId;
+    for (int i = 0; i < 4; ++i) {
+        if (edgeColors > 1)
+            wangId.setEdgeColor(i, edges(generator));
+        if (cornerColors > 1)
+            wangId.setCornerColor(i, corners(generator));
+    }
+    return wangId;
+}
+
+static void fillWangSet(WangSet &wangSet, int tileCount, std::mt19937 &generator)
+{
+    Tileset *tileset = wangSet.tileset();
+    for (int i = 0; i < tileCount; ++i) {
+        wangSet.addTile(tileset->findOrCreateTile(i),
+                        randomWangId(generator,
+                                     wangSet.edgeColorCount(),
+                                     wangSet.cornerColorCount(),
+                                     false));
+    }
+}
+
+static bool lessThan(const WangTile &a, const WangTile &b)
+{
+    if (a.tile()->id() != b.tile()->id())
+        return a.tile()->id() < b.tile()->id();
+    return a.wangId() < b.wangId();
+}
+
+static QList<WangTile> sorted(QList<WangTile> wangTiles)
+{
+    std::sort(wangTiles.begin(), wangTiles.end(), lessThan);
+    return wangTiles;
+}
+
+static QList<WangTile> matchingVariations(const WangSet &wangSet, WangId wangId)
+{
+    QList<WangTile> list;
+    for (WangId id : wangId.variations(wangSet.edgeColorCount(), wangSet.cornerColorCount()))
+        list.append(wangSet.wangTilesByWangId().values(id));
+    return sorted(list);
+}
+
+void test_WangSet::wildcardMatching_data()
+{
+    QTest::addColumn<int>("edgeColors");
+    QTest::addColumn<int>("cornerColors");
+
+    QTest::newRow("edges") << 3 << 1;
+    QTest::newRow("corners") << 1 << 4;
+    QTest::newRow("mixed") << 2 << 3;
+}
+
+void test_WangSet::wildcardMatching()
+{
+    QFETCH(int, edgeColors);
+    QFETCH(int, cornerColors);
+
+    std::mt19937 generator(11);
+    SharedTileset tileset = Tileset::create(QStringLiteral("Wang"), 16, 16);
+
+    WangSet wangSet(tileset.data(), QStringLiteral("Set"), -1);
+    wangSet.setEdgeColorCount(edgeColors);
+    wangSet.setCornerColorCount(cornerColors);
+
+    fillWangSet(wangSet, 40, generator);
+
+    auto check = [&] {
+        for (int i = 0; i < 200; ++i) {
+            const WangId wangId = randomWangId(generator, edgeColors, cornerColors, true);
+            if (!wangId)
+                continue;
+
+            const QList<WangTile> expected = matchingVariations(wangSet, wangId);
+            QCOMPARE(sorted(wangSet.findMatchingWangTiles(wangId)), expected);
+            QCOMPARE(wangSet.wildWangIdIsUsed(wangId), !expected.isEmpty());
+        }
+    };
+
+    check();
+
+    // The index is kept up to date when tiles are changed or removed
+    for (int i = 0; i < 40; i += 3) {
+        Tile *tile = tileset->findTile(i);
+        if (i % 2)
+            wangSet.addTile(tile, randomWangId(generator, edgeColors, cornerColors, false));
+        else
+            wangSet.addTile(tile, WangId());
+    }
+
+    check();
+}
+
+void test_WangSet::fillRegionBenchmark()
+{
+    std::mt19937 generator(5);
+    SharedTileset tileset = Tileset::create(QStringLiteral("Wang"), 16, 16);
+
+    // A mixed set with 8 colors, which is far from complete
+    WangSet wangSet(tileset.data(), QStringLiteral("Mixed"), -1);
+    wangSet.setEdgeColorCount(4);
+    wangSet.setCornerColorCount(4);
+
+    fillWangSet(wangSet, 1024, generator);
+
+    const TileLayer back(QString(), 0, 0, 256, 256);
+    const QRegion region(0, 0, 256, 256);
+
+    WangFiller wangFiller(&wangSet);
+
+    QBENCHMARK {
+        wangFiller.fillRegion(back, region);
+    }
+}
+
+QTEST_MAIN(test_WangSet)
+#include "test_wangset.moc"
@@ -0,0 +1,147 @@
+#include "worldmanager.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest/QtTest>
+
+using namespace Tiled;
+
+class test_WorldManager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void mapsInRect_data();
+    void mapsInRect();
+    void contextMaps();
+    void directoryChanged();
+
+    void contextMapsBenchmark();
+
+private:
+    QString mapFileName(int x, int y) const;
+
+    QTemporaryDir mDir;
+    const World *mWorld = nullptr;
+};
+
+static const int gridSize = 100;   // 10k maps
+static const int mapSize = 100;
+
+static bool touch(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly);
+}
+
+QString test_WorldManager::mapFileName(int x, int y) const
+{
+    // World::allMaps refers to the maps by their canonical path
+    const QDir dir(QFileInfo(mDir.path()).canonicalFilePath());
+    return dir.filePath(QStringLiteral("map_%1_%2.tmx").arg(x).arg(y));
+}
+
+void test_WorldManager::initTestCase()
+{
+    QVERIFY(mDir.isValid());
+
+    for (int y = 0; y < gridSize; ++y)
+        for (int x = 0; x < gridSize; ++x)
+            QVERIFY(touch(mapFileName(x, y)));
+
+    const QString worldFileName = QDir(mDir.path()).filePath(QStringLiteral("test.world"));
+    QFile worldFile(worldFileName);
+    QVERIFY(worldFile.open(QIODevice::WriteOnly | QIODevice::Text));
+    worldFile.write(R"({
+        "type": "world",
+        "onlyShowAdjacentMaps": true,
+        "patterns": [{
+            "regexp": "map_(\\d+)_(\\d+)\\.tmx",
+            "multiplierX": 100,
+            "multiplierY": 100,
+            "mapWidth": 100,
+            "mapHeight": 100
+        }]
+    })");
+    worldFile.close();
+
+    QString errorString;
+    mWorld = WorldManager::instance().loadWorld(worldFileName, &errorString);
+    QVERIFY2(mWorld, qPrintable(errorString));
+    QCOMPARE(mWorld->allMaps().size(), gridSize * gridSize);
+}
+
+void test_WorldManager::cleanupTestCase()
+{
+    WorldManager::deleteInstance();
+    mWorld = nullptr;
+}
+
+void test_WorldManager::mapsInRect_data()
+{
+    QTest::addColumn<QRect>("rect");
+
+    QTest::newRow("single map") << QRect(250, 250, 10, 10);
+    QTest::newRow("map corner") << QRect(199, 199, 2, 2);
+    QTest::newRow("large area") << QRect(-500, 1000, 3000, 450);
+    QTest::newRow("everything") << QRect(-1000, -1000, 100000, 100000);
+    QTest::newRow("outside") << QRect(-300, -300, 200, 200);
+    QTest::newRow("empty") << QRect(250, 250, 0, 0);
+}
+
+void test_WorldManager::mapsInRect()
+{
+    QFETCH(QRect, rect);
+
+    QVector<World::MapEntry> expected;
+    for (const World::MapEntry &entry : mWorld->allMaps())
+        if (entry.rect.intersects(rect))
+            expected.append(entry);
+
+    QCOMPARE(mWorld->mapsInRect(rect), expected);
+}
+
+void test_WorldManager::contextMaps()
+{
+    const QString fileName = mapFileName(5, 5);
+
+    QVERIFY(mWorld->containsMap(fileName));
+    QCOMPARE(mWorld->mapRect(fileName), QRect(500, 500, mapSize, mapSize));
+    QCOMPARE(mWorld->contextMaps(fileName).size(), 9);
+    QCOMPARE(mWorld->contextMaps(mapFileName(0, 0)).size(), 4);
+}
+
+void test_WorldManager::directoryChanged()
+{
+    QSignalSpy spy(&WorldManager::instance(), &WorldManager::worldsChanged);
+
+    const QString fileName = mapFileName(gridSize, 0);
+    QVERIFY(touch(fileName));
+
+    QTRY_VERIFY(spy.count() > 0);
+
+    const World *world = WorldManager::instance().worldForMap(fileName);
+    QVERIFY(world);
+    QCOMPARE(world->allMaps().size(), gridSize * gridSize + 1);
+    QCOMPARE(world->contextMaps(mapFileName(gridSize - 1, 0)).size(), 6);
+
+    mWorld = world;
+}
+
+void test_WorldManager::contextMapsBenchmark()
+{
+    const QString fileName = mapFileName(gridSize / 2, gridSize / 2);
+
+    QBENCHMARK {
+        mWorld->contextMaps(fileName);
+    }
+}
+
+QTEST_MAIN(test_WorldManager)
+#include "test_worldmanager.moc"